@@ -0,0 +1,52 @@
+
+#include "calibration.hpp"
+
+using namespace CScore;
+using CSdrivers::PowerSupplyId;
+
+namespace CScontrol {
+
+    namespace {
+        constexpr int32_t MAX_ADC_INPUT_COUNTS = 32767;     // ADS1115 full scale.
+        constexpr int32_t MAX_SETPOINT_MILLIVOLTS = 1000000;  // Bounds the setpoint transforms. Well past any supply.
+        constexpr double MILLI = 1000.0;
+    }
+
+    bool Calibration::load(CSdrivers::EeProm0 &eeProm) {
+        auto retCode = true;
+
+        for (size_t i = 0; i < CSdrivers::POWER_SUPPLY_COUNT; i++) {
+            CSdrivers::ControlData controlData;
+            if (eeProm.getControlDataFromStorage(static_cast<PowerSupplyId>(i), controlData)) {
+                sets_[i] = compile(controlData);
+            } else {
+                sets_[i] = CalibrationSet{};
+            }
+            retCode &= sets_[i].isValid();
+        }
+
+        loaded_ = true;
+        return retCode;
+    }
+
+    CalibrationSet Calibration::compile(const CSdrivers::ControlData &controlData) {
+        const auto& page1 = controlData.page1;
+        CalibrationSet set{};
+
+        // Voltage read. Volts -> millivolts folds the 1000 into both coefficients.
+        const auto vrcSlope = static_cast<double>(page1.vrcMVoltageSlope) * page1.vrcVConversionCoeff;
+        set.adcCountsToMillivolts = ScaledTransform::fromFloat(vrcSlope * MILLI,
+                                                               static_cast<double>(page1.vrcBVoltageOffset) * MILLI,
+                                                               MAX_ADC_INPUT_COUNTS);
+
+        // The inverse only exists for a non-zero slope. A zero slope leaves it invalid.
+        if (0.0 != vrcSlope) {
+            set.millivoltsToAdcCounts = ScaledTransform::fromFloat(1.0 / (vrcSlope * MILLI),
+                                                                   -static_cast<double>(page1.vrcBVoltageOffset) / vrcSlope,
+                                                                   MAX_SETPOINT_MILLIVOLTS);
+        }
+
+        return set;
+    }
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef CALIBRATION_HPP_
+#define CALIBRATION_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "eeprom0.hpp"
+#include "fixed-point.hpp"
+
+namespace CScontrol {
+
+    /**
+     * @brief The precompiled transforms for one power supply.
+     * The stored chain of float coefficients is collapsed into one affine map per direction:
+     *   voltage read:  volts     = vrcMVoltageSlope * (counts * vrcVConversionCoeff) + vrcBVoltageOffset
+     * and its inverse for setpoints. Outputs are integers in millivolts and ADC counts.
+     * The PID drives the DAC in counts, so the stored voltage write and current read coefficients have no user here.
+     */
+    struct CalibrationSet {
+        CScore::ScaledTransform adcCountsToMillivolts{};
+        CScore::ScaledTransform millivoltsToAdcCounts{};    // Inverse of the voltage read. Turns a setpoint into PID units.
+
+        [[nodiscard]] bool isValid () const {
+            return adcCountsToMillivolts.valid && millivoltsToAdcCounts.valid;
+        }
+    };
+
+    /**
+     * @brief Loads the control data pages once and serves integer-only conversions from then on.
+     */
+    class Calibration final {
+
+    public:
+        Calibration () = default;
+        ~Calibration () = default;
+
+        /**
+         * @brief Reads both control data pages for every supply and builds the transforms.
+         * @return true if every supply produced a valid set.
+         */
+        bool load (CSdrivers::EeProm0& eeProm);
+
+        /**
+         * @brief Builds the transforms for one supply from its stored pages.
+         */
+        static CalibrationSet compile (const CSdrivers::ControlData& controlData);
+
+        [[nodiscard]] const CalibrationSet& getSet (CSdrivers::PowerSupplyId psId) const {
+            return sets_[index(psId)];
+        }
+        [[nodiscard]] bool isLoaded () const {return loaded_;}
+
+        [[nodiscard]] int32_t toMillivolts (const CSdrivers::PowerSupplyId psId, const int32_t counts) const {
+            return getSet(psId).adcCountsToMillivolts.apply(counts);
+        }
+        // A block of samples from one supply at once, as telemetry batches them. millivolts may be counts.
+        void toMillivolts (const CSdrivers::PowerSupplyId psId, const int32_t* counts, int32_t* millivolts,
+                           const size_t count) const {
+            getSet(psId).adcCountsToMillivolts.apply(counts, millivolts, count);
+        }
+        [[nodiscard]] int32_t millivoltsToAdcCounts (const CSdrivers::PowerSupplyId psId, const int32_t mV) const {
+            return getSet(psId).millivoltsToAdcCounts.apply(mV);
+        }
+
+    private:
+        static constexpr size_t index (const CSdrivers::PowerSupplyId psId) {
+            const auto ix = static_cast<size_t>(psId);
+            return ix < CSdrivers::POWER_SUPPLY_COUNT ? ix : 0;
+        }
+
+        std::array<CalibrationSet, CSdrivers::POWER_SUPPLY_COUNT> sets_{};
+        bool loaded_ = false;
+    };
+
+}
+
+#endif  // CALIBRATION_HPP_
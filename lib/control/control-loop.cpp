@@ -0,0 +1,308 @@
+
+#include <algorithm>
+
+#include "binary-log.hpp"
+#include "control-loop.hpp"
+#include "dac-declarations.hpp"
+#include "logger.hpp"
+
+using namespace CScore;
+using CSdrivers::PowerSupplyId;
+
+namespace CScontrol {
+
+    bool ControlLoop::addBlock(const ControlBinding &binding) {
+        if (nullptr == binding.adc || nullptr == binding.dac ||
+            PowerSupplyId::NOT_A_SUPPLY == binding.psId ||
+            CSdevices::DacChannelIds::NOT_A_CHANNEL == binding.dacChannel ||
+            blockCount_ >= blocks_.size() ||
+            nullptr != findBlock(binding.psId)) {
+            return false;
+        }
+
+        // The DAC uses the stored channel id for addressing. Make sure it's filled in.
+        if (CSdevices::DacChannelIds::NOT_A_CHANNEL ==
+                binding.dac->getDacChannelIdFromChannelArray(binding.dacChannel)) {
+            CSdevices::DacChannelConfig config;
+            config.channelId = binding.dacChannel;
+            binding.dac->setChannelConfig(binding.dacChannel, config);
+        }
+
+        // One ADS1115 converts one channel at a time. Blocks that share one take turns.
+        uint8_t share = 0;
+        for (uint8_t i = 0; i < blockCount_; i++) {
+            share += blocks_[i].binding.adc == binding.adc ? 1 : 0;
+        }
+        for (uint8_t i = 0; i < blockCount_; i++) {
+            if (blocks_[i].binding.adc == binding.adc) {
+                blocks_[i].adcShare = share + 1;
+            }
+        }
+
+        blocks_[blockCount_] = ControlBlock{};
+        blocks_[blockCount_].binding = binding;
+        blocks_[blockCount_].adcSlot = share;
+        blocks_[blockCount_].adcShare = share + 1;
+        ++blockCount_;
+
+        return true;
+    }
+
+    bool ControlLoop::loadGains(CSdrivers::EeProm0 &eeProm) {
+        auto retCode = true;
+
+        for (uint8_t i = 0; i < blockCount_; i++) {
+            auto& block = blocks_[i];
+
+            if (CSdrivers::ControlData controlData; eeProm.getControlDataFromStorage(block.binding.psId, controlData)) {
+                block.storedGains = controlData.page2;
+                applyGains(block);
+            } else {
+                block.gainsValid = false;
+            }
+
+            // New calibration moves what a millivolt is in counts.
+            block.setpointSet = block.setpointSet && applySetpoint(block, block.setpointMv);
+            block.enabled = block.gainsValid && block.setpointSet;
+            if (!block.gainsValid) {
+                logger_.log(LogLevel::Warn, getClassName(), __func__,
+                            "No usable gains for power supply " +
+                            std::to_string(static_cast<int>(block.binding.psId)) + "; block disabled.");
+            }
+            retCode &= block.gainsValid;
+        }
+
+        return retCode;
+    }
+
+    void ControlLoop::applyGains(ControlBlock &block) const {
+        auto gains = PidController::gainsFromControlData(block.storedGains, periodUs_ * block.adcShare);
+
+        // The output drives a DAC directly, so the limits can't go past what it accepts.
+        gains.outputMin = std::clamp<int32_t>(gains.outputMin, 0, CSdevices::MAX_DAC_COUNTS);
+        gains.outputMax = std::clamp<int32_t>(gains.outputMax, 0, CSdevices::MAX_DAC_COUNTS);
+
+        block.gainsValid = gains.isValid();
+        block.pid.setGains(gains);
+    }
+
+    bool ControlLoop::setSetpoint(const PowerSupplyId psId, const int32_t millivolts) {
+        auto* block = findBlock(psId);
+        if (nullptr == block || !applySetpoint(*block, millivolts)) {
+            return false;
+        }
+
+        block->setpointSet = true;
+        if (block->gainsValid) {
+            setBlockEnabled(psId, true);
+        }
+        return true;
+    }
+
+    bool ControlLoop::applySetpoint(ControlBlock &block, const int32_t millivolts) const {
+        const auto psId = block.binding.psId;
+        if (nullptr == calibration_ || !calibration_->getSet(psId).millivoltsToAdcCounts.valid) {
+            return false;
+        }
+
+        // The PID works in ADC counts, so the setpoint goes the way the measurement comes back.
+        const auto counts = calibration_->millivoltsToAdcCounts(psId, millivolts);
+        if (counts < 0 || counts > MAX_SETPOINT_COUNTS) {
+            return false;
+        }
+
+        block.pid.setSetpoint(counts);
+        block.setpointMv = millivolts;
+        return true;
+    }
+
+    bool ControlLoop::setBlockEnabled(const PowerSupplyId psId, const bool enabled) {
+        auto* block = findBlock(psId);
+        if (nullptr == block || (enabled && (!block->gainsValid || !block->setpointSet))) {
+            return false;
+        }
+        if (enabled && !block->enabled) {
+            block->pid.reset();     // Don't resume with a stale integrator.
+        }
+        block->enabled = enabled;
+        return true;
+    }
+
+    bool ControlLoop::isBlockEnabled(const PowerSupplyId psId) const {
+        const auto* block = findBlock(psId);
+        return nullptr != block && block->enabled;
+    }
+
+    bool ControlLoop::hasSetpoint(const PowerSupplyId psId) const {
+        const auto* block = findBlock(psId);
+        return nullptr != block && block->setpointSet;
+    }
+
+    int32_t ControlLoop::getMeasurement(const PowerSupplyId psId) const {
+        const auto* block = findBlock(psId);
+        return nullptr == block ? 0 : block->measurement;
+    }
+
+    int32_t ControlLoop::getOutput(const PowerSupplyId psId) const {
+        const auto* block = findBlock(psId);
+        return nullptr == block ? 0 : block->pid.getLastOutput();
+    }
+
+    int32_t ControlLoop::getSetpoint(const PowerSupplyId psId) const {
+        const auto* block = findBlock(psId);
+        return nullptr == block ? 0 : block->pid.getSetpoint();
+    }
+
+    int32_t ControlLoop::getSetpointMillivolts(const PowerSupplyId psId) const {
+        const auto* block = findBlock(psId);
+        return nullptr == block ? 0 : block->setpointMv;
+    }
+
+    bool ControlLoop::start(const uint32_t periodUs) {
+        stop();
+
+        periodUs_ = std::max(periodUs, MIN_CONTROL_PERIOD_US);
+        for (uint8_t i = 0; i < blockCount_; i++) {
+            applyGains(blocks_[i]);
+        }
+
+        releases_ = 0;
+        serviced_ = 0;
+        phase_ = 0;
+        resetStats();
+
+        running_ = true;
+        startUs_ = time_us_64();
+        // A negative delay makes the timer fixed-rate: it's measured from the previous release, not the callback end.
+        if (!add_repeating_timer_us(-static_cast<int64_t>(periodUs_), onAlarm, this, &timer_)) {
+            running_ = false;
+            logger_.log(LogLevel::Error, getClassName(), __func__, "No alarm available for the control loop.");
+        }
+
+        return running_;
+    }
+
+    void ControlLoop::stop() {
+        if (running_) {
+            running_ = false;
+            cancel_repeating_timer(&timer_);
+        }
+    }
+
+    bool ControlLoop::onAlarm(repeating_timer_t *timer) {
+        auto* self = static_cast<ControlLoop*>(timer->user_data);
+        self->releases_ = self->releases_ + 1;
+        return self->running_;
+    }
+
+    bool ControlLoop::service() {
+        const uint32_t releases = releases_;    // Single word read; atomic on the M0+.
+
+        if (releases == serviced_) {
+            return false;
+        }
+
+        const auto nowUs = time_us_64();
+        const auto pending = releases - serviced_;
+        serviced_ = releases;
+
+        const auto nominalUs = startUs_ + static_cast<uint64_t>(releases) * periodUs_;
+        const auto jitterUs = nowUs > nominalUs ? static_cast<uint32_t>(nowUs - nominalUs) : 0U;
+
+        stats_.deadlineMisses += pending - 1;   // Every release but the newest was never run.
+        if (pending > 1) {
+            binaryLog_.record(LogLevel::Warn, LogFormatId::CONTROL_DEADLINE_MISS, pending - 1, jitterUs);
+        }
+        stats_.lastJitterUs = jitterUs;
+        stats_.maxJitterUs = std::max(stats_.maxJitterUs, jitterUs);
+
+        if (!step()) {
+            ++stats_.stepErrors;
+        }
+        ++stats_.iterations;
+
+        const auto executionUs = static_cast<uint32_t>(time_us_64() - nowUs);
+        stats_.lastExecutionUs = executionUs;
+        stats_.maxExecutionUs = std::max(stats_.maxExecutionUs, executionUs);
+
+        return true;
+    }
+
+    bool ControlLoop::step() {
+        auto retCode = true;
+
+        // The conversions the last step started. A period is longer than a conversion, so they don't wait.
+        for (uint8_t i = 0; i < blockCount_; i++) {
+            auto& block = blocks_[i];
+            if (!block.converting) {
+                continue;
+            }
+            block.converting = false;
+
+            const auto& binding = block.binding;
+            // A failed read is not a zero reading. Fed to the PID it would wind the output up to its limit.
+            if (int16_t counts = 0; binding.adc->completeConversion(binding.adcChannel, counts)) {
+                block.measurement = counts;
+            } else {
+                binaryLog_.record(LogLevel::Error, LogFormatId::CONTROL_ADC_FAILED, binding.psId);
+                retCode = false;
+                continue;
+            }
+            if (!block.enabled) {
+                continue;       // Stopped since the conversion started.
+            }
+
+            const auto output = block.pid.update(block.measurement);
+            if (!binding.dac->writeDacInputRegister(binding.dacChannel, static_cast<uint16_t>(output))) {
+                binaryLog_.record(LogLevel::Error, LogFormatId::CONTROL_DAC_FAILED, binding.psId, output);
+                retCode = false;
+            }
+        }
+
+        // Then the next conversion on each ADC, for whichever of its blocks has the turn.
+        for (uint8_t i = 0; i < blockCount_; i++) {
+            auto& block = blocks_[i];
+            if (!block.enabled || phase_ % block.adcShare != block.adcSlot) {
+                continue;
+            }
+            block.converting = block.binding.adc->startConversion(block.binding.adcChannel);
+            if (!block.converting) {
+                binaryLog_.record(LogLevel::Error, LogFormatId::CONTROL_ADC_FAILED, block.binding.psId);
+                retCode = false;
+            }
+        }
+        ++phase_;
+
+        return retCode;
+    }
+
+    LoopStats ControlLoop::getStats() const {
+        auto stats = stats_;
+        stats.periodUs = periodUs_;
+        stats.releases = releases_;
+        return stats;
+    }
+
+    void ControlLoop::resetStats() {
+        stats_ = LoopStats{};
+    }
+
+    ControlLoop::ControlBlock * ControlLoop::findBlock(const PowerSupplyId psId) {
+        for (uint8_t i = 0; i < blockCount_; i++) {
+            if (blocks_[i].binding.psId == psId) {
+                return &blocks_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const ControlLoop::ControlBlock * ControlLoop::findBlock(const PowerSupplyId psId) const {
+        for (uint8_t i = 0; i < blockCount_; i++) {
+            if (blocks_[i].binding.psId == psId) {
+                return &blocks_[i];
+            }
+        }
+        return nullptr;
+    }
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+#ifndef CONTROL_LOOP_HPP_
+#define CONTROL_LOOP_HPP_
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "pico/time.h"
+
+#include "ads1115.hpp"
+#include "calibration.hpp"
+#include "component.hpp"
+#include "eeprom0.hpp"
+#include "mcp4728.hpp"
+#include "pid-controller.hpp"
+
+namespace CScontrol {
+
+    constexpr uint32_t DEFAULT_CONTROL_PERIOD_US = 10000;   // 100 Hz
+    // A conversion started in one step is read in the next, so a period has to cover one, plus the step's I2C.
+    constexpr uint32_t MIN_CONTROL_PERIOD_US = CSdevices::CONVERSION_TIME_860us + 500;
+    constexpr uint8_t MAX_CONTROL_BLOCKS = CSdrivers::POWER_SUPPLY_COUNT;
+    constexpr int32_t MAX_SETPOINT_COUNTS = 32767;          // ADS1115 full scale, single ended.
+
+    // Indexed by PowerSupplyId. Lower case, as commands arrive.
+    constexpr std::string_view POWER_SUPPLY_LABELS[] {"g1", "g2", "g3", "heater", "hv"};
+    static_assert(std::size(POWER_SUPPLY_LABELS) == CSdrivers::POWER_SUPPLY_COUNT, "Every supply needs a label");
+
+    constexpr CSdrivers::PowerSupplyId labelToPowerSupplyId (const std::string_view label) {
+        for (uint8_t ix = 0; ix < CSdrivers::POWER_SUPPLY_COUNT; ix++) {
+            if (label == POWER_SUPPLY_LABELS[ix]) {
+                return static_cast<CSdrivers::PowerSupplyId>(ix);
+            }
+        }
+        return CSdrivers::PowerSupplyId::NOT_A_SUPPLY;
+    }
+
+    /**
+     * @brief Ties one ADC input to one DAC output through a PID block.
+     * The power supply id selects the control data pages the gains come from.
+     */
+    struct ControlBinding {
+        CSdrivers::PowerSupplyId        psId        = CSdrivers::PowerSupplyId::NOT_A_SUPPLY;
+        CSdevices::Ads1115*             adc         = nullptr;
+        CSdevices::Ads1115Channel_t     adcChannel  = CSdevices::Ads1115Channel::AIN0_SINGLE_SHOT;
+        CSdevices::Mcp4728*             dac         = nullptr;
+        CSdevices::DacChannelIds        dacChannel  = CSdevices::DacChannelIds::NOT_A_CHANNEL;
+    };
+
+    /**
+     * @brief Timing statistics for the loop. All times in microseconds.
+     * Jitter is how late a step started relative to its nominal release time.
+     * A deadline miss is a release that was swallowed because the previous step had not been serviced yet.
+     */
+    struct LoopStats {
+        uint32_t periodUs           = 0;
+        uint32_t releases           = 0;    // Alarm firings.
+        uint32_t iterations         = 0;    // Steps actually run.
+        uint32_t deadlineMisses     = 0;
+        uint32_t stepErrors         = 0;    // Steps where an ADC or DAC transfer failed.
+        uint32_t lastJitterUs       = 0;
+        uint32_t maxJitterUs        = 0;
+        uint32_t lastExecutionUs    = 0;
+        uint32_t maxExecutionUs     = 0;
+    };
+
+    /**
+     * @brief Fixed-rate control engine.
+     * A repeating hardware alarm releases the loop at a fixed rate. The alarm callback only counts the release;
+     * the step itself (I2C conversions, PID math, DAC writes) runs from service(), which the main loop calls.
+     * That keeps blocking I2C traffic out of interrupt context while the rate stays locked to the alarm.
+     * Late service shows up as jitter; a release that arrives before the previous one was serviced is a deadline miss.
+     * A step never waits on a conversion. It reads the ones the previous step started, which are done a period
+     * later, then starts the next. Blocks that share an ADS1115 take turns, so each of them runs every
+     * (blocks on that ADC) periods, and its gains are derived for that longer period.
+     */
+    class ControlLoop final : public CSdevices::Component {
+
+    public:
+        ControlLoop () {
+            setClassName("ControlLoop");
+            setLabel("PID Control Loop");
+        }
+
+        ControlLoop (const ControlLoop& other) = delete;
+        ControlLoop& operator=(const ControlLoop& other) = delete;
+        ~ControlLoop () override {stop();}
+
+        /**
+         * @brief Adds a block. The DAC channel is configured if it has not been already.
+         * @return false if the binding is incomplete, duplicates a power supply, or there is no room.
+         */
+        bool addBlock (const ControlBinding& binding);
+
+        /**
+         * @brief Reads control data for every bound block from the EEPROM and derives its gains.
+         * A block runs once it has both usable gains and a setpoint. Until then it leaves its DAC channel alone.
+         * Setpoints are converted again, so load the calibration first.
+         * @return true if every block got valid gains.
+         */
+        bool loadGains (CSdrivers::EeProm0& eeProm);
+
+        // Setpoints are converted through it. Without one, setSetpoint fails.
+        void setCalibration (const Calibration* calibration) {calibration_ = calibration;}
+
+        /**
+         * @brief Converts a setpoint in millivolts to ADC counts through Calibration::millivoltsToAdcCounts and
+         * hands it to the block's PID. A block with usable gains starts running.
+         * @return false if there is no such block, no valid voltage calibration, or the setpoint is past the ADC.
+         */
+        bool setSetpoint (CSdrivers::PowerSupplyId psId, int32_t millivolts);
+        // Disabling keeps the setpoint. Enabling needs usable gains and a setpoint.
+        bool setBlockEnabled (CSdrivers::PowerSupplyId psId, bool enabled);
+
+        [[nodiscard]] bool hasBlock (const CSdrivers::PowerSupplyId psId) const {return nullptr != findBlock(psId);}
+        [[nodiscard]] bool isBlockEnabled (CSdrivers::PowerSupplyId psId) const;
+        [[nodiscard]] bool hasSetpoint (CSdrivers::PowerSupplyId psId) const;
+
+        [[nodiscard]] int32_t getMeasurement (CSdrivers::PowerSupplyId psId) const;
+        [[nodiscard]] int32_t getOutput (CSdrivers::PowerSupplyId psId) const;
+        [[nodiscard]] int32_t getSetpoint (CSdrivers::PowerSupplyId psId) const;            // ADC counts.
+        [[nodiscard]] int32_t getSetpointMillivolts (CSdrivers::PowerSupplyId psId) const;
+
+        /**
+         * @brief Starts the alarm. Gains are re-derived for the period since Ki and Kd depend on it.
+         * @param periodUs Loop period. Clamped to MIN_CONTROL_PERIOD_US.
+         * @return true if the alarm was armed.
+         */
+        bool start (uint32_t periodUs = DEFAULT_CONTROL_PERIOD_US);
+        void stop ();
+        [[nodiscard]] bool isRunning () const {return running_;}
+        [[nodiscard]] uint32_t getPeriodUs () const {return periodUs_;}
+
+        /**
+         * @brief Runs one step if the alarm has released one. Call this from the main loop.
+         * @return true if a step ran.
+         */
+        bool service ();
+
+        [[nodiscard]] LoopStats getStats () const;
+        void resetStats ();
+
+    private:
+        struct ControlBlock {
+            ControlBinding              binding{};
+            PidController               pid{};
+            CSdrivers::ControlDataPage2 storedGains{};
+            int32_t                     measurement = 0;
+            int32_t                     setpointMv  = 0;
+            uint8_t                     adcShare    = 1;        // Blocks on this block's ADC.
+            uint8_t                     adcSlot     = 0;        // Its turn among them.
+            bool                        gainsValid  = false;
+            bool                        setpointSet = false;
+            bool                        enabled     = false;
+            bool                        converting  = false;    // Started in the last step; read in the next.
+        };
+
+        static bool onAlarm (repeating_timer_t* timer);
+
+        bool step ();
+        void applyGains (ControlBlock& block) const;
+        bool applySetpoint (ControlBlock& block, int32_t millivolts) const;
+        ControlBlock* findBlock (CSdrivers::PowerSupplyId psId);
+        [[nodiscard]] const ControlBlock* findBlock (CSdrivers::PowerSupplyId psId) const;
+
+        std::array<ControlBlock, MAX_CONTROL_BLOCKS> blocks_{};
+        uint8_t             blockCount_     = 0;
+        const Calibration*  calibration_    = nullptr;
+
+        repeating_timer_t   timer_{};
+        bool                running_        = false;
+        uint32_t            periodUs_       = DEFAULT_CONTROL_PERIOD_US;
+        uint64_t            startUs_        = 0;    // Release n is nominally at startUs_ + n * periodUs_.
+        uint32_t            phase_          = 0;    // Steps run. Picks the turn on shared ADCs.
+
+        volatile uint32_t   releases_       = 0;    // Written only by the alarm callback.
+        uint32_t            serviced_       = 0;    // Releases already accounted for by service().
+
+        LoopStats           stats_{};
+    };
+
+}
+
+#endif  // CONTROL_LOOP_HPP_
@@ -0,0 +1,74 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include "pid-controller.hpp"
+
+using namespace CScore;
+
+namespace CScontrol {
+
+    PidGains PidController::gainsFromControlData(const CSdrivers::ControlDataPage2 &page2, const uint32_t periodUs) {
+        PidGains gains{};   // Defaults are invalid (min == max), so a bad page leaves the block disabled.
+
+        const auto allFinite = std::isfinite(page2.pdcKpValue) &&
+                               std::isfinite(page2.pdcKiValue) &&
+                               std::isfinite(page2.pdcKdValue) &&
+                               std::isfinite(page2.pdcMinControlVariable) &&
+                               std::isfinite(page2.pdcMaxControlVariable);
+
+        if (!allFinite || 0 == periodUs) {
+            return gains;
+        }
+
+        const auto dtSeconds = static_cast<float>(periodUs) / 1.0e6f;
+
+        gains.kp = floatToQ16(page2.pdcKpValue);
+        gains.ki = floatToQ16(page2.pdcKiValue * dtSeconds);
+        gains.kd = floatToQ16(page2.pdcKdValue / dtSeconds);
+        gains.outputMin = static_cast<int32_t>(std::lround(page2.pdcMinControlVariable));
+        gains.outputMax = static_cast<int32_t>(std::lround(page2.pdcMaxControlVariable));
+
+        return gains;
+    }
+
+    int32_t PidController::update(const int32_t measurement) {
+        const auto minQ = intToQ16(gains_.outputMin);
+        const auto maxQ = intToQ16(gains_.outputMax);
+        const auto error = setpoint_ - measurement;
+
+        const auto proportional = q16MultiplyInt(gains_.kp, error);
+
+        // Derivative on measurement. The first sample has no history, so it contributes nothing.
+        Q16_16_t derivative = 0;
+        if (primed_) {
+            derivative = -q16MultiplyInt(gains_.kd, measurement - previousMeasurement_);
+        }
+        previousMeasurement_ = measurement;
+        primed_ = true;
+
+        const auto candidateIntegrator = std::clamp(saturateToInt32(static_cast<int64_t>(integrator_) +
+                                                                    q16MultiplyInt(gains_.ki, error)),
+                                                    minQ, maxQ);
+
+        const auto unclamped = static_cast<int64_t>(proportional) + candidateIntegrator + derivative;
+
+        // Conditional integration: only take the new integrator value if it does not push further into saturation.
+        if (unclamped > maxQ) {
+            saturated_ = true;
+            if (candidateIntegrator < integrator_) integrator_ = candidateIntegrator;
+        } else if (unclamped < minQ) {
+            saturated_ = true;
+            if (candidateIntegrator > integrator_) integrator_ = candidateIntegrator;
+        } else {
+            saturated_ = false;
+            integrator_ = candidateIntegrator;
+        }
+
+        const auto output = static_cast<Q16_16_t>(std::clamp<int64_t>(unclamped, minQ, maxQ));
+        lastOutput_ = std::clamp(q16ToInt(output), gains_.outputMin, gains_.outputMax);
+
+        return lastOutput_;
+    }
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+#ifndef PID_CONTROLLER_HPP_
+#define PID_CONTROLLER_HPP_
+
+#include <cstdint>
+
+#include "eeprom0-page-declarations.hpp"
+#include "fixed-point.hpp"
+
+namespace CScontrol {
+
+    /**
+     * @brief Gains and output limits for a PidController.
+     * The gains are already discretized for the loop period: ki is per sample (Ki * dt), kd is (Kd / dt).
+     * Units: input is ADC counts, output is DAC counts.
+     */
+    struct PidGains {
+        CScore::Q16_16_t    kp          = 0;
+        CScore::Q16_16_t    ki          = 0;
+        CScore::Q16_16_t    kd          = 0;
+        int32_t             outputMin   = 0;
+        int32_t             outputMax   = 0;
+
+        [[nodiscard]] bool isValid () const {
+            return kp >= 0 && ki >= 0 && kd >= 0 && outputMin < outputMax;
+        }
+    };
+
+    /**
+     * @brief Fixed-point PID block.
+     * All math in update() is integer: three 32x32->64 multiplies, a few adds and clamps.
+     * Anti-windup is by clamping the integrator to the output limits and by not integrating further
+     * into saturation (conditional integration).
+     * The derivative acts on the measurement, not the error, so setpoint changes do not kick the output.
+     */
+    class PidController final {
+
+    public:
+        PidController () = default;
+        ~PidController () = default;
+
+        /**
+         * @brief Builds discretized gains from the control data page.
+         * The float values in storage are continuous-time gains. They are scaled by the loop period here,
+         * once, so update() never sees a float.
+         * @param page2 The stored page holding pdcKp/Ki/Kd and the control variable limits.
+         * @param periodUs The loop period in microseconds.
+         * @return The gains. Check isValid() before use; an unformatted page will produce garbage.
+         */
+        static PidGains gainsFromControlData (const CSdrivers::ControlDataPage2& page2, uint32_t periodUs);
+
+        void setGains (const PidGains& gains) {
+            gains_ = gains;
+            reset();
+        }
+        [[nodiscard]] const PidGains& getGains () const {return gains_;}
+
+        void setSetpoint (const int32_t setpoint) {setpoint_ = setpoint;}
+        [[nodiscard]] int32_t getSetpoint () const {return setpoint_;}
+
+        /**
+         * @brief Clears the integrator and derivative history. The next update() acts like the first.
+         */
+        void reset () {
+            integrator_ = 0;
+            previousMeasurement_ = 0;
+            primed_ = false;
+        }
+
+        /**
+         * @brief Runs one step of the controller.
+         * @param measurement The process value in ADC counts.
+         * @return The control output in DAC counts, clamped to [outputMin, outputMax].
+         */
+        int32_t update (int32_t measurement);
+
+        [[nodiscard]] int32_t getLastOutput () const {return lastOutput_;}
+        [[nodiscard]] bool isSaturated () const {return saturated_;}
+
+    private:
+        PidGains            gains_{};
+        int32_t             setpoint_               = 0;
+        CScore::Q16_16_t    integrator_             = 0;    // Q16.16, in output units.
+        int32_t             previousMeasurement_    = 0;
+        int32_t             lastOutput_             = 0;
+        bool                primed_                 = false;
+        bool                saturated_              = false;
+    };
+
+}
+
+#endif  // PID_CONTROLLER_HPP_
@@ -0,0 +1,142 @@
+#pragma once
+#ifndef BINARY_LOG_CODEC_HPP_
+#define BINARY_LOG_CODEC_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "binary-log-formats.hpp"
+#include "logger.hpp"
+
+/**
+ * The binary log record and its wire form. Nothing here touches the SDK, so the host decoder builds from the same
+ * header as the firmware.
+ * Wire form, little endian: timestamp (4), format id (2), level (1), argument count (1), arguments (4 each).
+ * In the serial stream a record is one line: BINARY_LOG_LINE_PREFIX then the bytes in hex.
+ */
+namespace CScore {
+
+    constexpr uint8_t BINARY_LOG_MAX_ARGS = 4;
+    constexpr uint8_t BINARY_LOG_HEADER_SIZE = 8;
+    constexpr uint8_t BINARY_LOG_MAX_RECORD_SIZE = BINARY_LOG_HEADER_SIZE + 4 * BINARY_LOG_MAX_ARGS;
+    constexpr auto BINARY_LOG_LINE_PREFIX = "BL:";
+
+    struct BinaryLogRecord {
+        uint32_t timestampUs = 0;
+        uint16_t formatId = 0;
+        uint8_t level = 0;
+        uint8_t argCount = 0;
+        uint32_t args[BINARY_LOG_MAX_ARGS]{};
+    };
+
+    /**
+     * @return Bytes written to buffer. It needs BINARY_LOG_MAX_RECORD_SIZE.
+     */
+    inline size_t encodeBinaryLogRecord (const BinaryLogRecord& record, uint8_t* buffer) {
+        const auto putLe = [&buffer](size_t& at, const uint32_t value, const uint8_t size) {
+            for (uint8_t i = 0; i < size; i++) {
+                buffer[at++] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        };
+
+        size_t length = 0;
+        const auto argCount = record.argCount < BINARY_LOG_MAX_ARGS ? record.argCount : BINARY_LOG_MAX_ARGS;
+        putLe(length, record.timestampUs, 4);
+        putLe(length, record.formatId, 2);
+        putLe(length, record.level, 1);
+        putLe(length, argCount, 1);
+        for (uint8_t i = 0; i < argCount; i++) {
+            putLe(length, record.args[i], 4);
+        }
+        return length;
+    }
+
+    /**
+     * @return false if the bytes aren't exactly one record.
+     */
+    inline bool decodeBinaryLogRecord (const uint8_t* buffer, const size_t length, BinaryLogRecord& record) {
+        const auto getLe = [buffer](const size_t at, const uint8_t size) {
+            uint32_t value = 0;
+            for (uint8_t i = 0; i < size; i++) {
+                value |= static_cast<uint32_t>(buffer[at + i]) << (8 * i);
+            }
+            return value;
+        };
+
+        if (length < BINARY_LOG_HEADER_SIZE) {
+            return false;
+        }
+        record.timestampUs = getLe(0, 4);
+        record.formatId = static_cast<uint16_t>(getLe(4, 2));
+        record.level = static_cast<uint8_t>(getLe(6, 1));
+        record.argCount = static_cast<uint8_t>(getLe(7, 1));
+        if (record.argCount > BINARY_LOG_MAX_ARGS || length != BINARY_LOG_HEADER_SIZE + 4u * record.argCount) {
+            return false;
+        }
+        for (uint8_t i = 0; i < record.argCount; i++) {
+            record.args[i] = getLe(BINARY_LOG_HEADER_SIZE + 4 * i, 4);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Expands the format text with the record's arguments. An unknown id prints the id and the raw words.
+     */
+    inline std::string formatBinaryLogRecord (const BinaryLogRecord& record) {
+        constexpr const char* LEVEL_LABELS[] {"Trace", "Debug", "Info", "Warn", "Error", "Fatal", "None"};
+        constexpr auto LEVEL_COUNT = sizeof(LEVEL_LABELS) / sizeof(LEVEL_LABELS[0]);
+        constexpr auto HEX_DIGITS = "0123456789abcdef";
+
+        const auto toHex = [HEX_DIGITS](uint32_t value) {
+            std::string digits;
+            do {
+                digits.insert(digits.begin(), HEX_DIGITS[value & 0x0F]);
+                value >>= 4;
+            } while (0 != value);
+            return "0x" + digits;
+        };
+
+        std::string line = "[" + std::to_string(record.timestampUs) + " us] " +
+                           (record.level < LEVEL_COUNT ? LEVEL_LABELS[record.level] : "?") + ": ";
+
+        const auto* text = getLogFormatText(record.formatId);
+        if (nullptr == text) {
+            line += "format " + std::to_string(record.formatId);
+            for (uint8_t i = 0; i < record.argCount && i < BINARY_LOG_MAX_ARGS; i++) {
+                line += " " + toHex(record.args[i]);
+            }
+            return line;
+        }
+
+        uint8_t argIndex = 0;
+        for (const auto* p = text; '\0' != *p; p++) {
+            if ('%' != *p || '\0' == p[1]) {
+                line += *p;
+                continue;
+            }
+
+            const auto conversion = *++p;
+            if ('%' == conversion) {
+                line += '%';
+                continue;
+            }
+            if (argIndex >= record.argCount || argIndex >= BINARY_LOG_MAX_ARGS) {
+                line += "?";
+                continue;
+            }
+
+            const auto arg = record.args[argIndex++];
+            switch (conversion) {
+                case 'd': line += std::to_string(static_cast<int32_t>(arg)); break;
+                case 'u': line += std::to_string(arg); break;
+                case 'x': line += toHex(arg); break;
+                default:  line += '%'; line += conversion; break;
+            }
+        }
+        return line;
+    }
+
+}   // namespace CScore
+
+#endif  // BINARY_LOG_CODEC_HPP_
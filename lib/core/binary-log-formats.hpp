@@ -0,0 +1,59 @@
+#pragma once
+#ifndef BINARY_LOG_FORMATS_HPP_
+#define BINARY_LOG_FORMATS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CScore {
+
+    /**
+     * @brief Format strings for the binary log. A record only carries the id; the text lives here, in flash, and
+     * in the host decoder, which includes this same header.
+     * Conversions are %d (signed), %u (unsigned), %x (hex) and %%. Each consumes one 32-bit argument.
+     * Add new ids at the end. The raw stream stores the number, so renumbering breaks old captures.
+     */
+    enum class LogFormatId : uint16_t {
+        DROPPED = 0,                // Generated by the drain, never recorded.
+        CONTROL_DEADLINE_MISS,
+        CONTROL_ADC_FAILED,
+        CONTROL_DAC_FAILED,
+        EEPROM_CRC_MISMATCH,
+        EEPROM_WRITE_FAILED,
+        FORMAT_COUNT                // Not a format.
+    };
+
+    struct LogFormat {
+        LogFormatId id;
+        const char* text;
+    };
+
+    constexpr LogFormat LOG_FORMATS[] {
+        {LogFormatId::DROPPED,                  "%u binary log records dropped"},
+        {LogFormatId::CONTROL_DEADLINE_MISS,    "Control loop missed %u releases; jitter %u us"},
+        {LogFormatId::CONTROL_ADC_FAILED,       "Control loop ADC conversion failed for supply %u"},
+        {LogFormatId::CONTROL_DAC_FAILED,       "Control loop DAC write failed for supply %u, output %d"},
+        {LogFormatId::EEPROM_CRC_MISMATCH,      "EEPROM CRC mismatch on page %u"},
+        {LogFormatId::EEPROM_WRITE_FAILED,      "EEPROM write to page %u failed after %u attempts"},
+    };
+
+    constexpr size_t LOG_FORMAT_COUNT = static_cast<size_t>(LogFormatId::FORMAT_COUNT);
+    static_assert(sizeof(LOG_FORMATS) / sizeof(LOG_FORMATS[0]) == LOG_FORMAT_COUNT, "Every format id needs text");
+
+    constexpr bool logFormatsInOrder () {
+        for (size_t i = 0; i < LOG_FORMAT_COUNT; i++) {
+            if (static_cast<size_t>(LOG_FORMATS[i].id) != i) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(logFormatsInOrder(), "LOG_FORMATS must be in LogFormatId order");
+
+    constexpr const char* getLogFormatText (const uint16_t formatId) {
+        return formatId < LOG_FORMAT_COUNT ? LOG_FORMATS[formatId].text : nullptr;
+    }
+
+}   // namespace CScore
+
+#endif  // BINARY_LOG_FORMATS_HPP_
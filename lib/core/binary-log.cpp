@@ -0,0 +1,93 @@
+
+#include "binary-log.hpp"
+#include "hardware/sync.h"
+#include "log-queue.hpp"
+#include "pico/time.h"
+#include "serial-comm.hpp"
+
+namespace CScore {
+
+    BinaryLog binaryLog_; // Global definition.
+
+    void BinaryLog::push(const LogLevel level, const LogFormatId formatId, const uint32_t *args, const uint8_t argCount) {
+        const auto timestampUs = time_us_32();
+
+        // Producers may be interrupt handlers. Interrupts are only off for the slot copy.
+        const auto interruptState = save_and_disable_interrupts();
+        if (count_ < BINARY_LOG_CAPACITY) {
+            auto& slot = ring_[head_];
+            slot.timestampUs = timestampUs;
+            slot.formatId = static_cast<uint16_t>(formatId);
+            slot.level = static_cast<uint8_t>(level);
+            slot.argCount = argCount;
+            for (uint8_t i = 0; i < argCount; i++) {
+                slot.args[i] = args[i];
+            }
+            head_ = (head_ + 1) & (BINARY_LOG_CAPACITY - 1);
+            count_ = count_ + 1;
+        } else {
+            dropped_ = dropped_ + 1;
+        }
+        restore_interrupts(interruptState);
+    }
+
+    bool BinaryLog::pop(BinaryLogRecord &record) {
+        const auto interruptState = save_and_disable_interrupts();
+        const auto retCode = count_ > 0;
+        if (retCode) {
+            record = ring_[(head_ - count_) & (BINARY_LOG_CAPACITY - 1)];
+            count_ = count_ - 1;
+        }
+        restore_interrupts(interruptState);
+        return retCode;
+    }
+
+    uint32_t BinaryLog::drain(const uint32_t maxRecords) {
+        uint32_t written = 0;
+
+        // Drops are reported ahead of the backlog, so a flood shows up straight away.
+        if (const uint32_t dropped = dropped_; dropped != droppedReported_ && written < maxRecords) {
+            BinaryLogRecord entry{};
+            entry.timestampUs = time_us_32();
+            entry.formatId = static_cast<uint16_t>(LogFormatId::DROPPED);
+            entry.level = static_cast<uint8_t>(LogLevel::Warn);
+            entry.argCount = 1;
+            entry.args[0] = dropped - droppedReported_;
+            droppedReported_ = dropped;
+            write(entry);
+            ++written;
+        }
+
+        BinaryLogRecord entry;
+        while (written < maxRecords && pop(entry)) {
+            write(entry);
+            ++written;
+        }
+        return written;
+    }
+
+    void BinaryLog::write(const BinaryLogRecord &record) const {
+        if (SerialComm::isFramed()) {
+            // The host decodes it. This is the cheapest form there is.
+            uint8_t bytes[BINARY_LOG_MAX_RECORD_SIZE];
+            SerialComm::queueFrame(FrameType::BINARY_LOG, bytes, encodeBinaryLogRecord(record, bytes));
+        } else if (BinaryLogMode::Raw == mode_) {
+            constexpr auto HEX_DIGITS = "0123456789ABCDEF";
+            uint8_t bytes[BINARY_LOG_MAX_RECORD_SIZE];
+            const auto length = encodeBinaryLogRecord(record, bytes);
+
+            std::string line = BINARY_LOG_LINE_PREFIX;
+            for (size_t i = 0; i < length; i++) {
+                line += HEX_DIGITS[bytes[i] >> 4];
+                line += HEX_DIGITS[bytes[i] & 0x0F];
+            }
+            line += "\n";
+            logQueue_.push(static_cast<LogLevel>(record.level), line.data(), line.size());
+        } else {
+            // Into the log queue like any Logger line, so it reaches the sinks without waiting on the port.
+            const auto line = formatBinaryLogRecord(record) + "\n";
+            logQueue_.push(static_cast<LogLevel>(record.level), line.data(), line.size());
+        }
+    }
+
+}   // namespace CScore
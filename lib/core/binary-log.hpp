@@ -0,0 +1,88 @@
+#pragma once
+#ifndef BINARY_LOG_HPP_
+#define BINARY_LOG_HPP_
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "binary-log-codec.hpp"
+#include "logger.hpp"
+
+namespace CScore {
+
+    constexpr uint8_t BINARY_LOG_CAPACITY = 64;    // Records. A power of two.
+    static_assert(0 == (BINARY_LOG_CAPACITY & (BINARY_LOG_CAPACITY - 1)), "BINARY_LOG_CAPACITY must be a power of 2");
+
+    enum class BinaryLogMode : uint8_t {
+        Off,        // record() returns straight away.
+        Text,       // drain() formats each record on the target.
+        Raw         // drain() writes each record as a hex line for the host decoder.
+    };
+
+    /**
+     * @brief Logging for code that can't afford Logger: the control loop, interrupt handlers.
+     * record() stores a format id, a timestamp and up to BINARY_LOG_MAX_ARGS raw 32-bit arguments in a ring.
+     * There is no formatting, no allocation and no I/O, and interrupts are off only for the copy into the slot.
+     * drain() is run from the main loop when there's time. It does the formatting and hands the lines to logQueue_,
+     * or queues frames when the link is framed.
+     * A full ring drops the new record and counts it. The next drain reports the count.
+     * Records honor the Logger's level.
+     */
+    class BinaryLog {
+
+    public:
+        BinaryLog () = default;
+
+        template <typename... Args>
+        void record (const LogLevel level, const LogFormatId formatId, const Args... args) {
+            static_assert(sizeof...(Args) <= BINARY_LOG_MAX_ARGS, "Too many binary log arguments");
+            static_assert(((std::is_integral_v<Args> || std::is_enum_v<Args>) && ...),
+                          "Binary log arguments are integers or enums. Scale a float to fixed point first.");
+
+            if (BinaryLogMode::Off == mode_ || level < logger_.getLogLevel()) {
+                return;
+            }
+            const uint32_t words[BINARY_LOG_MAX_ARGS] {toWord(args)...};
+            push(level, formatId, words, sizeof...(Args));
+        }
+
+        /**
+         * @brief Formats and writes up to maxRecords. Call from the main loop, never from an interrupt.
+         * @return Records written.
+         */
+        uint32_t drain (uint32_t maxRecords = BINARY_LOG_CAPACITY);
+
+        void setMode (const BinaryLogMode mode) {mode_ = mode;}
+        [[nodiscard]] BinaryLogMode getMode () const {return mode_;}
+
+        [[nodiscard]] uint8_t getPendingCount () const {return count_;}
+        [[nodiscard]] uint32_t getDroppedCount () const {return dropped_;}
+
+    private:
+        template <typename T>
+        static constexpr uint32_t toWord (const T value) {
+            if constexpr (std::is_enum_v<T>) {
+                return static_cast<uint32_t>(static_cast<std::underlying_type_t<T>>(value));
+            } else {
+                return static_cast<uint32_t>(value);
+            }
+        }
+
+        void push (LogLevel level, LogFormatId formatId, const uint32_t* args, uint8_t argCount);
+        bool pop (BinaryLogRecord& record);
+        void write (const BinaryLogRecord& record) const;
+
+        std::array<BinaryLogRecord, BINARY_LOG_CAPACITY> ring_{};
+        volatile uint8_t head_ = 0;     // Next slot to fill.
+        volatile uint8_t count_ = 0;
+        volatile uint32_t dropped_ = 0;
+        uint32_t droppedReported_ = 0;
+        BinaryLogMode mode_ = BinaryLogMode::Text;
+    };
+
+    extern BinaryLog binaryLog_;    // Global, like logger_.
+
+}   // namespace CScore
+
+#endif  // BINARY_LOG_HPP_
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef CRC_HPP_
+#define CRC_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace CScore {
+
+    // CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection, no final xor. Check value for "123456789": 0x29B1.
+    constexpr uint16_t CRC16_CCITT_POLYNOMIAL = 0x1021;
+    constexpr uint16_t CRC16_CCITT_INITIAL = 0xFFFF;
+
+    /**
+     * @brief Builds the byte-at-a-time lookup table. Runs at compile time; the table lands in flash.
+     */
+    constexpr std::array<uint16_t, 256> makeCrc16CcittTable () {
+        std::array<uint16_t, 256> table{};
+        for (uint16_t byte = 0; byte < 256; byte++) {
+            auto crc = static_cast<uint16_t>(byte << 8);
+            for (uint8_t bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ CRC16_CCITT_POLYNOMIAL)
+                                     : static_cast<uint16_t>(crc << 1);
+            }
+            table[byte] = crc;
+        }
+        return table;
+    }
+
+    inline constexpr auto CRC16_CCITT_TABLE = makeCrc16CcittTable();
+
+    /**
+     * @brief Computes (or continues) a CRC-16/CCITT-FALSE. One table lookup per byte.
+     * @param data The bytes.
+     * @param length How many.
+     * @param crc The running value. Pass the previous result to continue over several buffers.
+     * @return The updated CRC.
+     */
+    constexpr uint16_t crc16Ccitt (const uint8_t* data, const size_t length, uint16_t crc = CRC16_CCITT_INITIAL) {
+        for (size_t i = 0; i < length; i++) {
+            crc = static_cast<uint16_t>((crc << 8) ^ CRC16_CCITT_TABLE[((crc >> 8) ^ data[i]) & 0xFF]);
+        }
+        return crc;
+    }
+
+    namespace crc_check {
+        constexpr uint8_t CHECK_INPUT[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+        static_assert(0x29B1 == crc16Ccitt(CHECK_INPUT, sizeof(CHECK_INPUT)), "CRC-16/CCITT-FALSE check value");
+    }
+
+    // FNV-1a, 32 bit. Not a CRC, but it lives here with the other checksums. Cheap enough to run at compile time.
+    constexpr uint32_t FNV1A32_OFFSET_BASIS = 0x811C9DC5;
+    constexpr uint32_t FNV1A32_PRIME = 0x01000193;
+
+    /**
+     * @brief Folds the four bytes of value (low byte first) into a running FNV-1a hash.
+     */
+    constexpr uint32_t fnv1a32Append (uint32_t hash, const uint32_t value) {
+        for (uint8_t i = 0; i < 4; i++) {
+            hash ^= (value >> (8 * i)) & 0xFF;
+            hash *= FNV1A32_PRIME;
+        }
+        return hash;
+    }
+
+}   // namespace CScore
+
+#endif  // CRC_HPP_
@@ -4,6 +4,7 @@
 #include <sstream>
 #include <string>
 #include "errors.hpp"
+#include "post-mortem.hpp"
 
 namespace CScore {
 
@@ -20,6 +21,7 @@ namespace CScore {
                     std::string& file,
                     const int line,
                     std::string& message) {
+            PostMortem::recordError(code, component, function, line, message);    // Survives a reset.
             component_      = std::move(component);
             function_       = std::move(function);
             file_           = std::move(file);
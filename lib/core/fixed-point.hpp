@@ -0,0 +1,154 @@
+#pragma once
+#ifndef FIXED_POINT_HPP_
+#define FIXED_POINT_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Fixed-point helpers for code that runs in the control path.
+ * The RP2040 has no FPU, so a float multiply is a library call. These keep the hot path in integer math.
+ * Floats are converted once (at load time) and the loop only ever sees the integer forms.
+ */
+namespace CScore {
+
+    // Q16.16: 16 integer bits (signed), 16 fraction bits.
+    using Q16_16_t = int32_t;
+
+    constexpr uint8_t Q16_FRACTION_BITS = 16;
+    constexpr Q16_16_t Q16_ONE = static_cast<Q16_16_t>(1) << Q16_FRACTION_BITS;
+    constexpr Q16_16_t Q16_MAX = std::numeric_limits<Q16_16_t>::max();
+    constexpr Q16_16_t Q16_MIN = std::numeric_limits<Q16_16_t>::min();
+
+    /**
+     * @brief Clamps a 64-bit intermediate into the 32-bit range.
+     * @param value The wide value.
+     * @return value saturated to int32_t.
+     */
+    constexpr int32_t saturateToInt32 (const int64_t value) {
+        return static_cast<int32_t>(std::clamp<int64_t>(value,
+                                                        std::numeric_limits<int32_t>::min(),
+                                                        std::numeric_limits<int32_t>::max()));
+    }
+
+    /**
+     * @brief Converts a float to Q16.16, rounding to nearest and saturating.
+     * This is meant for load-time conversions. Not for the hot path.
+     * @param value The float value. NaN converts to 0.
+     * @return The Q16.16 representation.
+     */
+    inline Q16_16_t floatToQ16 (const float value) {
+        if (std::isnan(value)) {
+            return 0;
+        }
+        const double scaled = std::round(static_cast<double>(value) * Q16_ONE);
+        if (scaled >= static_cast<double>(Q16_MAX)) return Q16_MAX;
+        if (scaled <= static_cast<double>(Q16_MIN)) return Q16_MIN;
+        return static_cast<Q16_16_t>(scaled);
+    }
+
+    /**
+     * @brief Converts Q16.16 back to float. Display and diagnostics only.
+     */
+    constexpr float q16ToFloat (const Q16_16_t value) {
+        return static_cast<float>(value) / static_cast<float>(Q16_ONE);
+    }
+
+    /**
+     * @brief Converts an integer to Q16.16, saturating.
+     */
+    constexpr Q16_16_t intToQ16 (const int32_t value) {
+        return saturateToInt32(static_cast<int64_t>(value) * Q16_ONE);
+    }
+
+    /**
+     * @brief Rounds a Q16.16 value to the nearest integer.
+     */
+    constexpr int32_t q16ToInt (const Q16_16_t value) {
+        return static_cast<int32_t>((static_cast<int64_t>(value) + (Q16_ONE / 2)) >> Q16_FRACTION_BITS);
+    }
+
+    /**
+     * @brief Multiplies a Q16.16 coefficient by a plain integer. The result is Q16.16, saturated.
+     * This is the common case in the control loop: gain (Q16.16) * error (counts).
+     */
+    constexpr Q16_16_t q16MultiplyInt (const Q16_16_t coefficient, const int32_t value) {
+        return saturateToInt32(static_cast<int64_t>(coefficient) * value);
+    }
+
+    /**
+     * @brief Multiplies two Q16.16 values. The result is Q16.16, rounded and saturated.
+     */
+    constexpr Q16_16_t q16Multiply (const Q16_16_t a, const Q16_16_t b) {
+        return saturateToInt32((static_cast<int64_t>(a) * b + (Q16_ONE / 2)) >> Q16_FRACTION_BITS);
+    }
+
+    /**
+     * @brief An affine map y = slope * x + offset, precompiled to multiply/add/shift.
+     * The shift is chosen per transform so the multiplier keeps as many significant bits as fit in 32 bits.
+     * The offset is pre-shifted and carries the rounding half, so apply() is one multiply, one add, one shift.
+     */
+    struct ScaledTransform {
+        int32_t multiplier  = 0;
+        int64_t offset      = 0;    // (offset << shift) + rounding half.
+        uint8_t shift       = 0;
+        bool    valid       = false;
+
+        [[nodiscard]] constexpr int32_t apply (const int32_t x) const {
+            return saturateToInt32((static_cast<int64_t>(x) * multiplier + offset) >> shift);
+        }
+
+        /**
+         * @brief apply() over a block. The coefficients are loaded once for the whole block.
+         * @param output May be input, to convert in place.
+         */
+        constexpr void apply (const int32_t* input, int32_t* output, const size_t count) const {
+            const auto m = static_cast<int64_t>(multiplier);
+            const auto b = offset;
+            const auto s = shift;
+            for (size_t i = 0; i < count; i++) {
+                output[i] = saturateToInt32((input[i] * m + b) >> s);
+            }
+        }
+
+        /**
+         * @brief Builds the transform from float coefficients. Load time only.
+         * @param slope Output units per input unit.
+         * @param offset Output units.
+         * @param maxInput Largest magnitude of x that will be applied. Bounds the shift so the sum can't overflow.
+         * @return The transform. valid is false if a coefficient is not finite or the slope doesn't fit.
+         */
+        static ScaledTransform fromFloat (const double slope, const double offset, const int32_t maxInput) {
+            ScaledTransform transform{};
+            if (!std::isfinite(slope) || !std::isfinite(offset) ||
+                std::fabs(slope) >= static_cast<double>(std::numeric_limits<int32_t>::max())) {
+                return transform;
+            }
+
+            constexpr uint8_t MAX_SHIFT = 30;
+            constexpr auto INT32_LIMIT = static_cast<double>(std::numeric_limits<int32_t>::max());
+            constexpr auto SUM_LIMIT = static_cast<double>(int64_t{1} << 62);
+            const auto worstCase = std::fabs(slope) * std::max(maxInput, 1) + std::fabs(offset);
+
+            uint8_t shift = 0;
+            while (shift < MAX_SHIFT &&
+                   std::fabs(slope) * static_cast<double>(int64_t{1} << (shift + 1)) <= INT32_LIMIT &&
+                   worstCase * static_cast<double>(int64_t{1} << (shift + 1)) < SUM_LIMIT) {
+                ++shift;
+            }
+
+            const auto scale = static_cast<double>(int64_t{1} << shift);
+            transform.shift = shift;
+            transform.multiplier = static_cast<int32_t>(std::llround(slope * scale));
+            transform.offset = std::llround(offset * scale) + (shift > 0 ? (int64_t{1} << (shift - 1)) : 0);
+            transform.valid = true;
+            return transform;
+        }
+    };
+
+}   // namespace CScore
+
+#endif  // FIXED_POINT_HPP_
@@ -0,0 +1,223 @@
+#pragma once
+#ifndef FRAME_CODEC_HPP_
+#define FRAME_CODEC_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "crc.hpp"
+
+/**
+ * The framed binary protocol. Nothing here touches the SDK, so a host tool can build from the same header.
+ * A frame is: type (1), payload (0..FRAME_MAX_PAYLOAD), CRC-16/CCITT of type and payload (2, little endian).
+ * On the wire it is COBS encoded and followed by a single 0x00, so a receiver finds frame boundaries without
+ * looking inside, and resynchronizes at the next 0x00 after a bad frame.
+ * Sample series travel as zigzag varint deltas: a slowly moving signal costs about one byte a value.
+ */
+namespace CScore {
+
+    constexpr uint8_t FRAME_DELIMITER = 0x00;
+    constexpr size_t FRAME_MAX_PAYLOAD = 240;
+    constexpr size_t FRAME_MAX_RAW = 1 + FRAME_MAX_PAYLOAD + 2;
+    constexpr size_t FRAME_MAX_ENCODED = FRAME_MAX_RAW + FRAME_MAX_RAW / 254 + 1 + 1;  // COBS overhead, delimiter.
+
+    enum class FrameType : uint8_t {
+        // Host to device.
+        COMMANDS        = 0x01,     // ASCII commands, ';' separated. As many as fit.
+        TEXT_MODE       = 0x02,     // Leave framed mode.
+
+        // Device to host.
+        TEXT            = 0x81,     // Response text, as the text protocol would have sent it.
+        BINARY_LOG      = 0x82,     // One binary log record, in its wire form (binary-log-codec.hpp).
+        SAMPLES         = 0x83,     // A sample series. See encodeSampleSeries.
+        TELEMETRY       = 0x84,     // Sequence (2), first sample tick (4), both little endian, then a sample series.
+        FRAME_ERROR     = 0xFF      // The previous frame was rejected. Payload: FrameError.
+    };
+
+    enum class FrameError : uint8_t {
+        BAD_ENCODING = 1,
+        BAD_CRC,
+        TOO_LONG,
+        UNKNOWN_TYPE,
+        BUSY                // No room to queue it. Send it again.
+    };
+
+    /**
+     * @return Bytes written to destination: at most length + length / 254 + 1. No delimiter.
+     */
+    constexpr size_t cobsEncode (const uint8_t* source, const size_t length, uint8_t* destination) {
+        size_t codeAt = 0;
+        size_t out = 1;
+        uint8_t code = 1;
+
+        for (size_t i = 0; i < length; i++) {
+            if (0 == source[i]) {
+                destination[codeAt] = code;
+                codeAt = out++;
+                code = 1;
+                continue;
+            }
+            destination[out++] = source[i];
+            if (0xFF == ++code) {
+                destination[codeAt] = code;
+                codeAt = out++;
+                code = 1;
+            }
+        }
+        destination[codeAt] = code;
+        return out;
+    }
+
+    /**
+     * @param length Encoded bytes, without the delimiter.
+     * @return Bytes decoded, or 0 if the input isn't valid COBS or doesn't fit in capacity.
+     */
+    constexpr size_t cobsDecode (const uint8_t* source, const size_t length, uint8_t* destination,
+                                 const size_t capacity) {
+        size_t in = 0;
+        size_t out = 0;
+
+        while (in < length) {
+            const uint8_t code = source[in++];
+            if (0 == code || in + code - 1 > length) {
+                return 0;
+            }
+            for (uint8_t i = 1; i < code; i++) {
+                if (out == capacity || 0 == source[in]) {
+                    return 0;
+                }
+                destination[out++] = source[in++];
+            }
+            if (0xFF != code && in < length) {
+                if (out == capacity) {
+                    return 0;
+                }
+                destination[out++] = 0;
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @param destination Needs FRAME_MAX_ENCODED.
+     * @return Bytes written, delimiter included. 0 if the payload is too long.
+     */
+    inline size_t buildFrame (const FrameType type, const uint8_t* payload, const size_t length, uint8_t* destination) {
+        if (length > FRAME_MAX_PAYLOAD) {
+            return 0;
+        }
+
+        uint8_t raw[FRAME_MAX_RAW];
+        raw[0] = static_cast<uint8_t>(type);
+        for (size_t i = 0; i < length; i++) {
+            raw[1 + i] = payload[i];
+        }
+        const auto crc = crc16Ccitt(raw, 1 + length);
+        raw[1 + length] = static_cast<uint8_t>(crc);
+        raw[2 + length] = static_cast<uint8_t>(crc >> 8);
+
+        const auto encoded = cobsEncode(raw, 3 + length, destination);
+        destination[encoded] = FRAME_DELIMITER;
+        return encoded + 1;
+    }
+
+    /**
+     * @brief Decodes one frame in place.
+     * @param frame The bytes between delimiters. Overwritten with the decoded frame.
+     * @param payload Set to the payload, inside frame.
+     */
+    inline bool parseFrame (uint8_t* frame, const size_t length, FrameType& type, const uint8_t*& payload,
+                            size_t& payloadLength, FrameError& error) {
+        uint8_t raw[FRAME_MAX_RAW];
+        const auto decoded = cobsDecode(frame, length, raw, sizeof(raw));
+        if (decoded < 3) {
+            error = FrameError::BAD_ENCODING;
+            return false;
+        }
+        const uint16_t crc = raw[decoded - 2] | (raw[decoded - 1] << 8);
+        if (crc != crc16Ccitt(raw, decoded - 2)) {
+            error = FrameError::BAD_CRC;
+            return false;
+        }
+
+        for (size_t i = 0; i < decoded - 2; i++) {
+            frame[i] = raw[i];      // Decoded is never longer than encoded.
+        }
+        type = static_cast<FrameType>(frame[0]);
+        payload = frame + 1;
+        payloadLength = decoded - 3;
+        return true;
+    }
+
+    constexpr uint32_t zigzagEncode (const int32_t value) {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    constexpr int32_t zigzagDecode (const uint32_t value) {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    /**
+     * @brief Sample series payload: channel (1), count (1), then each value less the one before it (the first less
+     * zero) as a zigzag varint. Stops early rather than overrun capacity.
+     * @return Bytes written. The count byte says how many values made it.
+     */
+    inline size_t encodeSampleSeries (const uint8_t channel, const int32_t* values, const size_t count,
+                                      uint8_t* destination, const size_t capacity) {
+        constexpr size_t MAX_VARINT = 5;
+        if (capacity < 2) {
+            return 0;
+        }
+
+        size_t at = 2;
+        uint8_t written = 0;
+        int32_t previous = 0;
+        for (size_t i = 0; i < count && written < UINT8_MAX && at + MAX_VARINT <= capacity; i++) {
+            auto delta = zigzagEncode(static_cast<int32_t>(static_cast<uint32_t>(values[i]) -
+                                                           static_cast<uint32_t>(previous)));
+            while (delta >= 0x80) {
+                destination[at++] = static_cast<uint8_t>(delta | 0x80);
+                delta >>= 7;
+            }
+            destination[at++] = static_cast<uint8_t>(delta);
+            previous = values[i];
+            ++written;
+        }
+        destination[0] = channel;
+        destination[1] = written;
+        return at;
+    }
+
+    /**
+     * @return Values decoded, or -1 if the payload is malformed.
+     */
+    inline int decodeSampleSeries (const uint8_t* payload, const size_t length, uint8_t& channel, int32_t* values,
+                                   const size_t capacity) {
+        if (length < 2 || payload[1] > capacity) {
+            return -1;
+        }
+        channel = payload[0];
+
+        size_t at = 2;
+        int32_t previous = 0;
+        for (uint8_t i = 0; i < payload[1]; i++) {
+            uint32_t delta = 0;
+            for (uint8_t shift = 0; ; shift += 7) {
+                if (at == length || shift > 28) {
+                    return -1;
+                }
+                const auto byte = payload[at++];
+                delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                if (0 == (byte & 0x80)) {
+                    break;
+                }
+            }
+            previous = static_cast<int32_t>(static_cast<uint32_t>(previous) + static_cast<uint32_t>(zigzagDecode(delta)));
+            values[i] = previous;
+        }
+        return payload[1];
+    }
+
+}   // namespace CScore
+
+#endif  // FRAME_CODEC_HPP_
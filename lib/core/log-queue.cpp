@@ -0,0 +1,147 @@
+
+#include <cstring>
+
+#include "log-queue.hpp"
+
+namespace CScore {
+
+    LogQueue logQueue_; // Global definition.
+
+    LogQueue::LogQueue() {
+        for (size_t level = 0; level < LEVEL_COUNT; level++) {
+            policies_[level] = level < static_cast<size_t>(LogLevel::Warn) ? LogDropPolicy::DropNewest
+                                                                           : LogDropPolicy::DropOldest;
+        }
+    }
+
+    void LogQueue::push(const LogLevel level, const char *text, size_t length) {
+        if (head_ - tail_ >= LOG_QUEUE_DEPTH) {
+            ++dropped_;
+            if (LogDropPolicy::DropNewest == getDropPolicy(level)) {
+                for (uint8_t i = 0; i < sinkCount_; i++) {
+                    if (sinks_[i]->accepts(level)) {
+                        ++sinks_[i]->linesDropped_;
+                    }
+                }
+                return;
+            }
+            evictOldest();
+        }
+
+        auto& line = slot(head_);
+        if (length > LOG_QUEUE_LINE_SIZE) {
+            length = LOG_QUEUE_LINE_SIZE;
+            ++truncated_;
+        }
+        std::memcpy(line.text, text, length);
+        if (length == LOG_QUEUE_LINE_SIZE) {
+            line.text[length - 1] = '\n';   // A cut line still ends the line.
+        }
+        line.length = static_cast<uint16_t>(length);
+        line.level = level;
+        ++head_;
+    }
+
+    size_t LogQueue::pump(const size_t maxBytes) {
+        size_t written = 0;
+
+        for (uint8_t n = 0; n < sinkCount_ && written < maxBytes; n++) {
+            auto& sink = *sinks_[(nextSink_ + n) % sinkCount_];
+
+            if (!sink.isReady()) {
+                // Nobody is listening. Waiting would only hold the queue for the other sinks.
+                for (; sink.cursor_ != head_; ++sink.cursor_) {
+                    if (sink.accepts(slot(sink.cursor_).level)) {
+                        ++sink.linesDropped_;
+                    }
+                }
+                sink.offset_ = 0;
+                continue;
+            }
+
+            while (sink.cursor_ != head_ && written < maxBytes) {
+                const auto& line = slot(sink.cursor_);
+                if (!sink.accepts(line.level)) {
+                    ++sink.cursor_;
+                    continue;
+                }
+
+                // The rest of the line, all of it: a serial sink only takes whole lines, so a reply can't land
+                // in the middle of one. The budget is checked between lines and can run over by one.
+                const size_t remaining = line.length - sink.offset_;
+                const auto taken = sink.write(line.level, line.text + sink.offset_, remaining);
+                sink.bytesWritten_ += taken;
+                sink.offset_ += taken;
+                written += taken;
+
+                if (sink.offset_ < line.length) {
+                    break;      // Full for now. The rest of the line goes next time.
+                }
+                ++sink.linesWritten_;
+                ++sink.cursor_;
+                sink.offset_ = 0;
+            }
+        }
+
+        if (sinkCount_ > 0) {
+            nextSink_ = (nextSink_ + 1) % sinkCount_;
+        }
+        releaseConsumed();
+        return written;
+    }
+
+    bool LogQueue::attach(LogSink &sink) {
+        if (sinkCount_ >= LOG_QUEUE_MAX_SINKS) {
+            return false;
+        }
+        sink.cursor_ = tail_;
+        sink.offset_ = 0;
+        sinks_[sinkCount_++] = &sink;
+        return true;
+    }
+
+    void LogQueue::detach(const LogSink &sink) {
+        for (uint8_t i = 0; i < sinkCount_; i++) {
+            if (sinks_[i] == &sink) {
+                for (uint8_t j = i + 1; j < sinkCount_; j++) {
+                    sinks_[j - 1] = sinks_[j];
+                }
+                sinks_[--sinkCount_] = nullptr;
+                nextSink_ = 0;
+                releaseConsumed();
+                return;
+            }
+        }
+    }
+
+    void LogQueue::evictOldest() {
+        const auto level = slot(tail_).level;
+        for (uint8_t i = 0; i < sinkCount_; i++) {
+            if (auto& sink = *sinks_[i]; sink.cursor_ == tail_) {
+                // A sink part way through the line loses the rest of it and picks up at the next line.
+                if (sink.accepts(level)) {
+                    ++sink.linesDropped_;
+                }
+                ++sink.cursor_;
+                sink.offset_ = 0;
+            }
+        }
+        ++tail_;
+    }
+
+    void LogQueue::releaseConsumed() {
+        // With no sinks attached the lines are kept, so the first sink attached still sees the startup messages.
+        if (0 == sinkCount_) {
+            return;
+        }
+
+        auto oldest = head_;
+        for (uint8_t i = 0; i < sinkCount_; i++) {
+            if (head_ - sinks_[i]->cursor_ > head_ - oldest) {
+                oldest = sinks_[i]->cursor_;
+            }
+        }
+        tail_ = oldest;
+    }
+
+}   // namespace CScore
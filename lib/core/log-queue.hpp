@@ -0,0 +1,103 @@
+#pragma once
+#ifndef LOG_QUEUE_HPP_
+#define LOG_QUEUE_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "log-sink.hpp"
+#include "logger.hpp"
+
+namespace CScore {
+
+    constexpr uint8_t LOG_QUEUE_DEPTH = 32;        // Lines. A power of two.
+    constexpr uint16_t LOG_QUEUE_LINE_SIZE = 160;  // Bytes per line. Longer lines are cut.
+    constexpr uint8_t LOG_QUEUE_MAX_SINKS = 4;
+    constexpr uint16_t LOG_QUEUE_BYTES_PER_PUMP = 256;
+    static_assert(0 == (LOG_QUEUE_DEPTH & (LOG_QUEUE_DEPTH - 1)), "LOG_QUEUE_DEPTH must be a power of 2");
+
+    enum class LogDropPolicy : uint8_t {
+        DropNewest,     // A full queue turns the new line away.
+        DropOldest      // A full queue gives up its oldest line for the new one.
+    };
+
+    /**
+     * @brief The bounded queue between Logger and the sinks.
+     * push() copies the line into a fixed slot and returns. It never allocates and never waits for a sink.
+     * pump() runs from the main loop and hands each sink its lines, as much as each will take without waiting.
+     * Every sink keeps its own place, so a slow UART doesn't hold back the USB port until the queue fills.
+     * When it does fill, the level's drop policy picks the loser. By default Trace to Info drop the new line and
+     * Warn and above push out the oldest, so a burst of chatter can't hide the error behind it.
+     * Main loop context only. Interrupt handlers and the control loop use binaryLog_.
+     */
+    class LogQueue {
+
+    public:
+        LogQueue ();
+
+        LogQueue (const LogQueue& other) = delete;
+        LogQueue& operator=(const LogQueue& other) = delete;
+
+        void push (LogLevel level, const char* text, size_t length);
+
+        /**
+         * @brief Offers pending lines to the sinks. Call from the main loop.
+         * @param maxBytes Total bytes to write this pass, over all sinks. Lines are offered whole, so the last one
+         * can take it over by up to LOG_QUEUE_LINE_SIZE.
+         * @return Bytes written.
+         */
+        size_t pump (size_t maxBytes = LOG_QUEUE_BYTES_PER_PUMP);
+
+        /**
+         * @brief Lines already queued are offered to the new sink too.
+         * @return false if LOG_QUEUE_MAX_SINKS are attached already.
+         */
+        bool attach (LogSink& sink);
+        void detach (const LogSink& sink);
+
+        void setDropPolicy (const LogLevel level, const LogDropPolicy policy) {
+            policies_[static_cast<size_t>(level)] = policy;
+        }
+        [[nodiscard]] LogDropPolicy getDropPolicy (const LogLevel level) const {
+            return policies_[static_cast<size_t>(level)];
+        }
+
+        [[nodiscard]] uint8_t getSinkCount () const {return sinkCount_;}
+        [[nodiscard]] const LogSink* getSink (const uint8_t ix) const {return ix < sinkCount_ ? sinks_[ix] : nullptr;}
+        [[nodiscard]] uint8_t getPendingCount () const {return static_cast<uint8_t>(head_ - tail_);}
+        [[nodiscard]] uint32_t getDroppedCount () const {return dropped_;}
+        [[nodiscard]] uint32_t getTruncatedCount () const {return truncated_;}
+
+    private:
+        struct Line {
+            LogLevel level = LogLevel::None;
+            uint16_t length = 0;
+            char text[LOG_QUEUE_LINE_SIZE]{};
+        };
+
+        static constexpr size_t LEVEL_COUNT = static_cast<size_t>(LogLevel::None) + 1;
+
+        Line& slot (const uint32_t sequence) {return lines_[sequence & (LOG_QUEUE_DEPTH - 1)];}
+
+        // Gives up the oldest line. Sinks that hadn't had it count a drop.
+        void evictOldest ();
+        // Frees the lines every sink has had.
+        void releaseConsumed ();
+
+        std::array<Line, LOG_QUEUE_DEPTH> lines_{};
+        std::array<LogDropPolicy, LEVEL_COUNT> policies_{};
+        std::array<LogSink*, LOG_QUEUE_MAX_SINKS> sinks_{};
+        uint8_t sinkCount_ = 0;
+        uint8_t nextSink_ = 0;          // Round robin start for pump(), so one sink can't take the whole budget.
+        uint32_t head_ = 0;             // Sequence number of the next line pushed.
+        uint32_t tail_ = 0;             // Oldest line still held.
+        uint32_t dropped_ = 0;
+        uint32_t truncated_ = 0;
+    };
+
+    extern LogQueue logQueue_;    // Global, like logger_.
+
+}   // namespace CScore
+
+#endif  // LOG_QUEUE_HPP_
@@ -0,0 +1,54 @@
+
+#include "log-sink.hpp"
+#include "serial-comm.hpp"
+
+namespace CScore {
+
+    namespace {
+        // All of the line or none of it. Checking the room first means queueOutput never waits, whatever the
+        // TX policy is, and never cuts the line short. A line that doesn't fit stays queued for the next pump.
+        size_t queueWholeLine(const char *text, const size_t length) {
+            if (length > SerialComm::getTxFree()) {
+                return 0;
+            }
+            return SerialComm::queueOutput(text, length);
+        }
+    }
+
+    bool UsbLogSink::isReady() const {
+        // Raw text would break the host's framing.
+        return CommInterface::USB == SerialComm::getActiveCommInterface() && !SerialComm::isFramed();
+    }
+
+    bool UartLogSink::isReady() const {
+        return nullptr != uart_ && CommInterface::UART == SerialComm::getActiveCommInterface() &&
+               !SerialComm::isFramed();
+    }
+
+    size_t UsbLogSink::write(LogLevel level, const char *text, const size_t length) {
+        return queueWholeLine(text, length);
+    }
+
+    size_t UartLogSink::write(LogLevel level, const char *text, const size_t length) {
+        return queueWholeLine(text, length);
+    }
+
+    size_t RamLogSink::write(LogLevel level, const char *text, const size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            buffer_[head_] = text[i];
+            head_ = (head_ + 1) & (RAM_LOG_SINK_SIZE - 1);
+        }
+        size_ = size_ + length < RAM_LOG_SINK_SIZE ? size_ + length : RAM_LOG_SINK_SIZE;
+        return length;
+    }
+
+    std::string RamLogSink::getText() const {
+        std::string text;
+        text.reserve(size_);
+        for (size_t i = 0; i < size_; i++) {
+            text += buffer_[(head_ - size_ + i) & (RAM_LOG_SINK_SIZE - 1)];
+        }
+        return text;
+    }
+
+}   // namespace CScore
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef LOG_SINK_HPP_
+#define LOG_SINK_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "hardware/uart.h"
+#include "logger.hpp"
+
+namespace CScore {
+
+    /**
+     * @brief One destination for Logger output. LogQueue::pump() hands each sink the lines it hasn't had yet.
+     * write() must never wait. It takes what fits right now and returns the count; the queue offers the rest of
+     * the line on a later pump. A sink that isn't ready (no host on the USB port, say) is skipped, and what it
+     * misses is counted as dropped for that sink.
+     */
+    class LogSink {
+
+    public:
+        explicit LogSink (const char* name, const LogLevel minLevel = LogLevel::Trace) :
+                            name_(name), minLevel_(minLevel) {}
+
+        LogSink (const LogSink& other) = delete;
+        LogSink& operator=(const LogSink& other) = delete;
+        virtual ~LogSink () = default;
+
+        /**
+         * @return Bytes taken. 0 is fine: the sink is busy.
+         */
+        virtual size_t write (LogLevel level, const char* text, size_t length) = 0;
+
+        [[nodiscard]] virtual bool isReady () const {return true;}
+
+        // Lines below this level are skipped. They are not drops.
+        [[nodiscard]] bool accepts (const LogLevel level) const {return level >= minLevel_;}
+        void setMinLevel (const LogLevel level) {minLevel_ = level;}
+
+        [[nodiscard]] const char* getName () const {return name_;}
+        [[nodiscard]] uint32_t getBytesWritten () const {return bytesWritten_;}
+        [[nodiscard]] uint32_t getLinesWritten () const {return linesWritten_;}
+        [[nodiscard]] uint32_t getLinesDropped () const {return linesDropped_;}
+
+    private:
+        friend class LogQueue;      // Keeps the counters and the sink's place in the queue.
+
+        const char* name_;
+        LogLevel minLevel_;
+        uint32_t bytesWritten_ = 0;
+        uint32_t linesWritten_ = 0;
+        uint32_t linesDropped_ = 0;
+        uint32_t cursor_ = 0;       // Sequence number of the next line for this sink.
+        uint16_t offset_ = 0;       // Bytes of that line already taken.
+    };
+
+    /**
+     * @brief USB CDC, through SerialComm's TX ring like the command replies, so the two never interleave.
+     * Takes a line only when all of it fits in the ring, and never waits for room. Ready while USB is the active
+     * interface and the link isn't framed.
+     */
+    class UsbLogSink final : public LogSink {
+
+    public:
+        UsbLogSink () : LogSink("usb") {}
+
+        size_t write (LogLevel level, const char* text, size_t length) override;
+        [[nodiscard]] bool isReady () const override;
+    };
+
+    /**
+     * @brief The command UART, through SerialComm's TX ring the same way as UsbLogSink. Ready while the UART is the
+     * active interface and the link isn't framed.
+     */
+    class UartLogSink final : public LogSink {
+
+    public:
+        explicit UartLogSink (uart_inst_t* uart) : LogSink("uart"), uart_(uart) {}
+
+        size_t write (LogLevel level, const char* text, size_t length) override;
+        [[nodiscard]] bool isReady () const override;
+
+    private:
+        uart_inst_t* uart_;
+    };
+
+    constexpr size_t RAM_LOG_SINK_SIZE = 2048;     // Bytes. A power of two.
+    static_assert(0 == (RAM_LOG_SINK_SIZE & (RAM_LOG_SINK_SIZE - 1)), "RAM_LOG_SINK_SIZE must be a power of 2");
+
+    /**
+     * @brief The last RAM_LOG_SINK_SIZE bytes of log text, for when nothing was attached at the time.
+     * Always takes everything. The oldest text is overwritten.
+     */
+    class RamLogSink final : public LogSink {
+
+    public:
+        RamLogSink () : LogSink("ram") {}
+
+        size_t write (LogLevel level, const char* text, size_t length) override;
+
+        // The buffered text, oldest first.
+        [[nodiscard]] std::string getText () const;
+        void clear () {head_ = 0; size_ = 0;}
+
+    private:
+        std::array<char, RAM_LOG_SINK_SIZE> buffer_{};
+        size_t head_ = 0;
+        size_t size_ = 0;
+    };
+
+}   // namespace CScore
+
+#endif  // LOG_SINK_HPP_
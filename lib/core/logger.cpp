@@ -1,8 +1,9 @@
 
 #include <map>
-#include <iostream>
 
+#include "log-queue.hpp"
 #include "logger.hpp"
+#include "post-mortem.hpp"
 #include "pystring.h"
 
 namespace CScore {
@@ -12,64 +13,69 @@ namespace CScore {
 
     void Logger::logMethodEntry(const LogLevel level, const std::string &message) const {
         if (level >= logLevel_) {
-            std::cout << "Log method entry. " << message << ";\n";
+            emit(level, "Log method entry. " + message + ";\n");
         }
     }
 
     void Logger::logMethodEntry(const LogLevel level, const std::string &className, const std::string &methodName) const {
         if (level >= logLevel_) {
-            std::cout << "Log method entry: " << className << "::" << methodName << ". \n";
+            emit(level, "Log method entry: " + className + "::" + methodName + ". \n");
         }
     }
 
     void Logger::logMethodExit(const LogLevel level, const std::string &message) const {
         if (level >= logLevel_) {
-            std::cout << "Log method exit. " << message << ";\n";
+            emit(level, "Log method exit. " + message + ";\n");
         }
     }
 
     void Logger::logMethodEntry(const LogLevel level, const std::string &className, const std::string &methodName,
                                 const std::string &message) const {
         if (level >= logLevel_) {
-            std::cout << "Log method entry: " << className << "::" << methodName << ". \nMessage: " << message << "\n";
+            emit(level, "Log method entry: " + className + "::" + methodName + ". \nMessage: " + message + "\n");
         }
     }
 
     void Logger::logMethodExit(const LogLevel level, const std::string &className, const std::string &methodName,
                                const std::string &message) const {
         if (level >= logLevel_) {
-            std::cout << "Log method exit: " << className << "::" << methodName << ".\nMessage:\t" << message << "\n";
+            emit(level, "Log method exit: " + className + "::" + methodName + ".\nMessage:\t" + message + "\n");
         }
     }
 
     void Logger::logMethodExit(const LogLevel level, const std::string &className, const std::string &methodName) const {
         if (level >= logLevel_) {
-            std::cout << "Log method exit: " << className << "::" << methodName << ".\n";
+            emit(level, "Log method exit: " + className + "::" + methodName + ".\n");
         }
     }
 
     void Logger::logMethodParameters(const LogLevel level, const std::string &className, const std::string &methodName,
                                      const std::string &parameterList, const std::string &message) const {
         if (level >= logLevel_) {
-            std::cout << "Log method: " << className << "::" << methodName << "\n\t(" << parameterList << ");\n" <<
-                                "Message:\t" << message << "\n" ;
+            emit(level, "Log method: " + className + "::" + methodName + "\n\t(" + parameterList + ");\n" +
+                                "Message:\t" + message + "\n");
         }
     }
     void Logger::log(const LogLevel level, const std::string &message) const {
         if (level >= logLevel_) {
-            std::cout << "Log level: " << logLevelToLabel(level) << ", Message: " << message << "\n";
+            emit(level, "Log level: " + logLevelToLabel(level) + ", Message: " + message + "\n");
         }
     }
 
     void Logger::log(const LogLevel level, const std::string &className, const std::string &methodName,
                      const std::string &message) const {
         if (level >= logLevel_) {
-            std::cout << "\nLog level: " << logLevelToLabel(level) << " In " << className << "::" <<
-                                methodName << "\n\tMessage: " << message << "\n";
+            emit(level, "\nLog level: " + logLevelToLabel(level) + " In " + className + "::" +
+                                methodName + "\n\tMessage: " + message + "\n");
 //            log(level, message);
         }
     }
 
+    void Logger::emit(const LogLevel level, const std::string &text) {
+        PostMortem::recordLine(text.data(), text.size());     // Straight away: the queue may never be pumped.
+        logQueue_.push(level, text.data(), text.size());
+    }
+
     // NOLINTNEXTLINE(clang-analyzer-core.CallAndMessage
     std::string Logger::logLevelToLabel(const LogLevel level) {
         std::map<LogLevel, std::string> levelToLabel{
@@ -111,4 +117,32 @@ namespace CScore {
         return retCode;
     }
 
+    namespace {
+        // Indexed by LogGroup. Lower case, since labelToLogGroup lowers its input.
+        constexpr const char* LOG_GROUP_LABELS[] {
+            "main", "i2c", "ps", "g1", "g2", "g3", "hv", "filament", "gpio", "adc", "dac", "csi2c", "mcp24lc32",
+            "commands", "container", "generic", "init", "g2_hv", "one", "two", "three", "four", "five", "six",
+            "seven", "eight", "nine", "ten",
+            "state_one", "state_two", "state_three", "state_four", "state_five", "state_six", "state_seven",
+            "state_eight", "state_nine"
+        };
+        static_assert(sizeof(LOG_GROUP_LABELS) / sizeof(LOG_GROUP_LABELS[0]) == LOG_GROUP_COUNT,
+                      "Every LogGroup needs a label");
+    }
+
+    std::string Logger::logGroupToLabel(const LogGroup group) {
+        const auto ix = static_cast<uint8_t>(group);
+        return ix < LOG_GROUP_COUNT ? LOG_GROUP_LABELS[ix] : "none";
+    }
+
+    LogGroup Logger::labelToLogGroup(const std::string &label) {
+        const std::string lower = pystring::lower(label);
+        for (uint8_t ix = 0; ix < LOG_GROUP_COUNT; ix++) {
+            if (lower == LOG_GROUP_LABELS[ix]) {
+                return static_cast<LogGroup>(ix);
+            }
+        }
+        return LogGroup::GROUP_COUNT;
+    }
+
 } // namespace CScore
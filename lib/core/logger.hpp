@@ -3,54 +3,81 @@
 #ifndef LOGGER_HPP_
 #define LOGGER_HPP_
 
+#include <cstdint>
 #include <string>
 
 #define LOGGER_ENABLED_     // comment this out to remove all logging from the system (production..)
 
 namespace CScore {
 
-    // The following definitions allow us to control compilation of log statements (or other things too.)
-    // Each group will stand for some set of code to optionally compile.
+    // Log groups. Each group stands for some set of log statements, usually one subsystem.
+    // Groups are switched on and off at run time through Logger's group mask (the "loggroups" command, persisted in
+    // EEPROM 0). Guard a statement with: if (logger_.isGroupEnabled(LogGroup::ADC)) { ... }
+    // Add new groups at the end: the persisted mask is by bit number. At most 64.
     //------------------------------------------------------------------
-//#define LOG_GROUP_MAIN      // Main code.
-//#define LOG_GROUP_I2C       // I2C communications.
-//#define LOG_GROUP_PS        // Power Supply.
-//#define LOG_GROUP_G1        // Grid 1.
-//#define LOG_GROUP_G2        // Grid 2.
-//#define LOG_GROUP_G3        // Grid 3.
-//#define LOG_GROUP_HV        // High Voltage.
-//#define LOG_GROUP_FILAMENT  // Filament.
-//#define LOG_GROUP_GPIO      // GPIO.
-//#define LOG_GROUP_ADC       // ADC.
-//#define LOG_GROUP_DAC         // DAC.
-//#define LOG_GROUP_CSI2C       // CSI2C.
-//#define LOG_GROUP_MCP24LC32 // MCP24LC32.
-//#define LOG_GROUP_COMMANDS  // Commands.
-//#define LOG_GROUP_CONTAINER // Container.
-//#define LOG_GROUP_GENERIC   // General Purpose - What we would get just randomly setting log statements.
-//#define LOG_GROUP_INIT      // Initialization of each component.
-//#define LOG_GROUP_G2_HV      // tracks how hv and g2 interact
-//#define LOG_GROUP_ONE   // Mcp4728
-//#define LOG_GROUP_TWO   // EEProm0
-//#define LOG_GROUP_THREE //
-//#define LOG_GROUP_FOUR  //
-//#define LOG_GROUP_FIVE  //
-//#define LOG_GROUP_SIX   //
-//#define LOG_GROUP_SEVEN //
-//#define LOG_GROUP_EIGHT //
-//#define LOG_GROUP_NINE  //
-#define LOG_GROUP_TEN   // DEBUG DAC BLOWOUT
-
-    // State Machine and PS Tracking; comment it out to remove each class of stuff.
-//#define LOG_GROUP_STATE_ONE     // State 1: Read ADC voltage values for High Voltage (ADC2/AIN0)
-//#define LOG_GROUP_STATE_TWO   // State 2: Read ADC current values for High Voltage (ADC2/AIN1)
-//#define LOG_GROUP_STATE_THREE // State 3:
-//#define LOG_GROUP_STATE_FOUR  // State 4: Read ADC voltage values for Heater (ADC0/AIN0) & Grid 2 (extractor; ADC1/AIN0)
-//#define LOG_GROUP_STATE_FIVE  // State 5: Read ADC current values for Heater (ADC0/AIN1) & Grid 2 (extractor; ADC1/AIN1)
-//#define LOG_GROUP_STATE_SIX   // State 6: PsG2::controlVoltage(); PsG2 PID controller
-//#define LOG_GROUP_STATE_SEVEN // State 7: Read ADC voltage values for Grid 1 (suppressor ADC0/AIN2) and Grid 3 (focus; ADC1/AIN2)
-//#define LOG_GROUP_STATE_EIGHT // State 8: Read ADC current values for Grid 1 (suppressor ADC0/AIN3) and Grid 3 (focus; ADC1/AIN3)
-//#define LOG_GROUP_STATE_NINE  // State 9: PsG1::controlVoltage(); PsG1 PID controller. PsG3::controlVoltage(); PsG3 PID controller
+    enum class LogGroup : uint8_t {
+        MAIN = 0,       // Main code.
+        I2C,            // I2C communications.
+        PS,             // Power Supply.
+        G1,             // Grid 1.
+        G2,             // Grid 2.
+        G3,             // Grid 3.
+        HV,             // High Voltage.
+        FILAMENT,       // Filament.
+        GPIO,           // GPIO.
+        ADC,            // ADC.
+        DAC,            // DAC.
+        CSI2C,          // CSI2C.
+        MCP24LC32,      // MCP24LC32.
+        COMMANDS,       // Commands.
+        CONTAINER,      // Container.
+        GENERIC,        // General Purpose - What we would get just randomly setting log statements.
+        INIT,           // Initialization of each component.
+        G2_HV,          // tracks how hv and g2 interact
+        ONE,            // Mcp4728
+        TWO,            // EEProm0
+        THREE,
+        FOUR,
+        FIVE,
+        SIX,
+        SEVEN,
+        EIGHT,
+        NINE,
+        TEN,            // DEBUG DAC BLOWOUT
+
+        // State Machine and PS Tracking.
+        STATE_ONE,      // State 1: Read ADC voltage values for High Voltage (ADC2/AIN0)
+        STATE_TWO,      // State 2: Read ADC current values for High Voltage (ADC2/AIN1)
+        STATE_THREE,    // State 3:
+        STATE_FOUR,     // State 4: Read ADC voltage values for Heater (ADC0/AIN0) & Grid 2 (extractor; ADC1/AIN0)
+        STATE_FIVE,     // State 5: Read ADC current values for Heater (ADC0/AIN1) & Grid 2 (extractor; ADC1/AIN1)
+        STATE_SIX,      // State 6: PsG2::controlVoltage(); PsG2 PID controller
+        STATE_SEVEN,    // State 7: Read ADC voltage values for Grid 1 (suppressor ADC0/AIN2) and Grid 3 (focus; ADC1/AIN2)
+        STATE_EIGHT,    // State 8: Read ADC current values for Grid 1 (suppressor ADC0/AIN3) and Grid 3 (focus; ADC1/AIN3)
+        STATE_NINE,     // State 9: PsG1::controlVoltage(); PsG1 PID controller. PsG3::controlVoltage(); PsG3 PID controller
+        GROUP_COUNT     // Not a group.
+    };
+    constexpr uint8_t LOG_GROUP_COUNT = static_cast<uint8_t>(LogGroup::GROUP_COUNT);
+    static_assert(LOG_GROUP_COUNT <= 64, "The log group mask is 64 bits");
+
+    constexpr uint64_t logGroupBit (const LogGroup group) {
+        return uint64_t{1} << static_cast<uint8_t>(group);
+    }
+
+    // Groups compiled out entirely. isGroupEnabled() is constant false for them, so the compiler drops their
+    // statements and the mask can't bring them back. Set it from the build, e.g. -DLOG_GROUPS_COMPILED_OUT=0x200 for ADC.
+#if !defined (LOG_GROUPS_COMPILED_OUT)
+#define LOG_GROUPS_COMPILED_OUT 0ULL
+#endif
+
+#if defined (LOGGER_ENABLED_)
+    constexpr uint64_t LOG_GROUPS_AVAILABLE = ~static_cast<uint64_t>(LOG_GROUPS_COMPILED_OUT);
+#else
+    constexpr uint64_t LOG_GROUPS_AVAILABLE = 0;
+#endif
+
+    // The mask before EEPROM has been read, and after a reset of the stored value.
+    constexpr uint64_t LOG_GROUP_DEFAULT_MASK = logGroupBit(LogGroup::TEN);
 
 #define SHOW_INFO_AT_STARTUP  // Show info at startup.
 
@@ -83,9 +110,12 @@ namespace CScore {
  * The initial value of logLevel_ is set in its declaration, but can be changed via setLogLevel(),
  * so be careful where that's done!
  * Typically I expect the actual log level to be set from the main function and simply accepted elsewhere.
+ * Output goes to logQueue_ (log-queue.hpp), not straight to stdout. A slow or absent reader costs dropped lines,
+ * never a stalled caller. The main loop pumps the queue to the attached sinks.
  */
     class Logger {
         LogLevel logLevel_ = LogLevel::Error; // default private.
+        uint64_t groupMask_ = LOG_GROUP_DEFAULT_MASK;
 
     public:
 
@@ -115,6 +145,26 @@ namespace CScore {
             return logLevel_;
         }
 
+        /**
+         * @brief The check that guards a group's log statements. One AND and a compare, and constant false for a
+         * group in LOG_GROUPS_COMPILED_OUT.
+         */
+        [[nodiscard]] bool isGroupEnabled(const LogGroup group) const {
+            return 0 != (LOG_GROUPS_AVAILABLE & logGroupBit(group) & groupMask_);
+        }
+
+        void setGroupMask(const uint64_t mask) {
+            groupMask_ = mask;
+        }
+
+        [[nodiscard]] uint64_t getGroupMask() const {
+            return groupMask_;
+        }
+
+        void setGroupEnabled(const LogGroup group, const bool enabled) {
+            groupMask_ = enabled ? (groupMask_ | logGroupBit(group)) : (groupMask_ & ~logGroupBit(group));
+        }
+
         void logMethodEntry(LogLevel level, const std::string &message) const;
 
         void logMethodEntry(LogLevel level, const std::string &className, const std::string &methodName) const;
@@ -142,6 +192,14 @@ namespace CScore {
 
         static LogLevel labelToLogLevel(const std::string &label);
 
+        static std::string logGroupToLabel(LogGroup group);
+
+        // Case-insensitive. Returns LogGroup::GROUP_COUNT if there is no such group.
+        static LogGroup labelToLogGroup(const std::string &label);
+
+    private:
+        static void emit(LogLevel level, const std::string &text);
+
     };
 
     extern Logger logger_;  // Global variable - one logger.
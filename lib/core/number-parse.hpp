@@ -0,0 +1,246 @@
+#pragma once
+#ifndef NUMBER_PARSE_HPP_
+#define NUMBER_PARSE_HPP_
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Number parsing for command arguments, in the manner of std::from_chars: no locale, no allocation, no errno.
+ * Integers stay exact. A fixed-point number comes back as a scaled integer ("1.25" with 3 decimals is 1250), so a
+ * value like millivolts never passes through a float. Everything is constexpr and a few dozen instructions a digit.
+ * Accepted: an optional sign, then decimal digits, or 0x and hex digits, or 0b and binary digits. Fixed point is
+ * decimal only. Underscores are not accepted, nor are leading or trailing spaces.
+ */
+namespace CScore {
+
+    enum class ParseError : uint8_t {
+        NONE = 0,
+        EMPTY,              // No digits where a number had to start.
+        INVALID_CHARACTER,  // Something after the number. ptr points at it.
+        OUT_OF_RANGE,       // A number, but not between min and max.
+        TOO_MANY_DECIMALS   // More fraction digits than the scale keeps.
+    };
+
+    struct ParseResult {
+        const char* ptr;    // First character not used.
+        ParseError  error;
+    };
+
+    constexpr const char* parseErrorToLabel (const ParseError error) {
+        switch (error) {
+            case ParseError::NONE:                  return "ok";
+            case ParseError::EMPTY:                 return "no number";
+            case ParseError::INVALID_CHARACTER:     return "invalid character";
+            case ParseError::OUT_OF_RANGE:          return "out of range";
+            case ParseError::TOO_MANY_DECIMALS:     return "too many decimals";
+        }
+        return "unknown";
+    }
+
+    namespace parse_detail {
+        constexpr int8_t digitValue (const char ch, const uint8_t base) {
+            int8_t value = -1;
+            if (ch >= '0' && ch <= '9') {
+                value = static_cast<int8_t>(ch - '0');
+            } else if (ch >= 'a' && ch <= 'f') {
+                value = static_cast<int8_t>(ch - 'a' + 10);
+            } else if (ch >= 'A' && ch <= 'F') {
+                value = static_cast<int8_t>(ch - 'A' + 10);
+            }
+            return value < base ? value : -1;
+        }
+
+        /**
+         * @brief Digits to a magnitude. Stops at the first non digit. Saturates past limit instead of wrapping.
+         */
+        constexpr ParseResult parseMagnitude (const char* first, const char* last, const uint8_t base,
+                                              const uint64_t limit, uint64_t& magnitude) {
+            magnitude = 0;
+            auto overflow = false;
+            const char* at = first;
+            for (int8_t digit; at != last && (digit = digitValue(*at, base)) >= 0; ++at) {
+                if (magnitude > (limit - static_cast<uint8_t>(digit)) / base) {
+                    overflow = true;
+                    magnitude = limit;
+                } else if (!overflow) {
+                    magnitude = magnitude * base + static_cast<uint8_t>(digit);
+                }
+            }
+            if (at == first) {
+                return {first, ParseError::EMPTY};
+            }
+            return {at, overflow ? ParseError::OUT_OF_RANGE : ParseError::NONE};
+        }
+
+        // Reads a sign and a 0x or 0b prefix.
+        constexpr const char* parsePrefix (const char* first, const char* last, bool& negative, uint8_t& base,
+                                           const bool allowPrefix) {
+            negative = false;
+            base = 10;
+            if (first != last && ('-' == *first || '+' == *first)) {
+                negative = '-' == *first;
+                ++first;
+            }
+            if (allowPrefix && last - first > 2 && '0' == first[0]) {
+                if ('x' == first[1] || 'X' == first[1]) {
+                    base = 16;
+                    first += 2;
+                } else if ('b' == first[1] || 'B' == first[1]) {
+                    base = 2;
+                    first += 2;
+                }
+            }
+            return first;
+        }
+    }
+
+    /**
+     * @brief Parses a signed integer from [first, last). Like from_chars, it stops at the first character that
+     * isn't part of the number and says where.
+     * @param value Set only when the result is NONE.
+     */
+    constexpr ParseResult parseInteger (const char* first, const char* last, int64_t& value,
+                                        const int64_t min = INT32_MIN, const int64_t max = INT32_MAX) {
+        bool negative;
+        uint8_t base;
+        const char* digits = parse_detail::parsePrefix(first, last, negative, base, true);
+
+        uint64_t magnitude = 0;
+        const auto result = parse_detail::parseMagnitude(digits, last, base, UINT64_MAX / 2 + 1, magnitude);
+        if (ParseError::NONE != result.error) {
+            return {ParseError::EMPTY == result.error ? first : result.ptr, result.error};
+        }
+
+        const auto parsed = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+        if ((!negative && magnitude > static_cast<uint64_t>(INT64_MAX)) || parsed < min || parsed > max) {
+            return {result.ptr, ParseError::OUT_OF_RANGE};
+        }
+        value = parsed;
+        return result;
+    }
+
+    /**
+     * @brief Parses an unsigned integer. A sign is an invalid character. Masks want the full 64 bits.
+     */
+    constexpr ParseResult parseUnsigned (const char* first, const char* last, uint64_t& value,
+                                         const uint64_t max = UINT32_MAX) {
+        bool negative;
+        uint8_t base;
+        if (first != last && ('-' == *first || '+' == *first)) {
+            return {first, ParseError::INVALID_CHARACTER};
+        }
+        const char* digits = parse_detail::parsePrefix(first, last, negative, base, true);
+
+        uint64_t magnitude = 0;
+        const auto result = parse_detail::parseMagnitude(digits, last, base, UINT64_MAX, magnitude);
+        if (ParseError::NONE != result.error) {
+            return {ParseError::EMPTY == result.error ? first : result.ptr, result.error};
+        }
+        if (magnitude > max) {
+            return {result.ptr, ParseError::OUT_OF_RANGE};
+        }
+        value = magnitude;
+        return result;
+    }
+
+    /**
+     * @brief Parses a decimal fixed-point number into an integer scaled by 10^decimals. Fewer fraction digits
+     * than decimals are fine; more is TOO_MANY_DECIMALS rather than a silent rounding.
+     * @param min,max In scaled units.
+     */
+    constexpr ParseResult parseFixed (const char* first, const char* last, int32_t& value, const uint8_t decimals,
+                                      const int32_t min = INT32_MIN, const int32_t max = INT32_MAX) {
+        bool negative;
+        uint8_t base;
+        const char* at = parse_detail::parsePrefix(first, last, negative, base, false);
+
+        // Whole part, then fraction, accumulated as one scaled magnitude. 2^31 is the largest that fits negated.
+        constexpr uint64_t LIMIT = static_cast<uint64_t>(INT32_MAX) + 1;
+        uint64_t scaled = 0;
+        auto digits = 0;
+        auto overflow = false;
+        for (; at != last && *at >= '0' && *at <= '9'; ++at, ++digits) {
+            scaled = scaled * 10 + static_cast<uint8_t>(*at - '0');
+            overflow |= scaled > LIMIT;
+            scaled = scaled > LIMIT ? LIMIT + 1 : scaled;
+        }
+
+        uint8_t fractionDigits = 0;
+        if (at != last && '.' == *at) {
+            ++at;
+            for (; at != last && *at >= '0' && *at <= '9'; ++at, ++digits) {
+                if (fractionDigits == decimals) {
+                    return {at, ParseError::TOO_MANY_DECIMALS};
+                }
+                scaled = scaled * 10 + static_cast<uint8_t>(*at - '0');
+                overflow |= scaled > LIMIT;
+                scaled = scaled > LIMIT ? LIMIT + 1 : scaled;
+                ++fractionDigits;
+            }
+        }
+        if (0 == digits) {
+            return {first, ParseError::EMPTY};
+        }
+
+        for (; fractionDigits < decimals; ++fractionDigits) {
+            scaled *= 10;
+            overflow |= scaled > LIMIT;
+            scaled = scaled > LIMIT ? LIMIT + 1 : scaled;
+        }
+
+        const auto parsed = negative ? -static_cast<int64_t>(scaled) : static_cast<int64_t>(scaled);
+        if (overflow || parsed < min || parsed > max) {
+            return {at, ParseError::OUT_OF_RANGE};
+        }
+        value = static_cast<int32_t>(parsed);
+        return {at, ParseError::NONE};
+    }
+
+    // Whole token forms: anything left over is INVALID_CHARACTER.
+
+    constexpr ParseError parseInteger (const std::string_view text, int64_t& value,
+                                       const int64_t min = INT32_MIN, const int64_t max = INT32_MAX) {
+        int64_t parsed = 0;
+        const auto result = parseInteger(text.data(), text.data() + text.size(), parsed, min, max);
+        if (ParseError::NONE != result.error) {
+            return result.error;
+        }
+        if (result.ptr != text.data() + text.size()) {
+            return ParseError::INVALID_CHARACTER;
+        }
+        value = parsed;
+        return ParseError::NONE;
+    }
+
+    constexpr ParseError parseUnsigned (const std::string_view text, uint64_t& value,
+                                        const uint64_t max = UINT32_MAX) {
+        uint64_t parsed = 0;
+        const auto result = parseUnsigned(text.data(), text.data() + text.size(), parsed, max);
+        if (ParseError::NONE != result.error) {
+            return result.error;
+        }
+        if (result.ptr != text.data() + text.size()) {
+            return ParseError::INVALID_CHARACTER;
+        }
+        value = parsed;
+        return ParseError::NONE;
+    }
+
+    constexpr ParseError parseFixed (const std::string_view text, int32_t& value, const uint8_t decimals,
+                                     const int32_t min = INT32_MIN, const int32_t max = INT32_MAX) {
+        int32_t parsed = 0;
+        const auto result = parseFixed(text.data(), text.data() + text.size(), parsed, decimals, min, max);
+        if (ParseError::NONE != result.error) {
+            return result.error;
+        }
+        if (result.ptr != text.data() + text.size()) {
+            return ParseError::INVALID_CHARACTER;
+        }
+        value = parsed;
+        return ParseError::NONE;
+    }
+
+}   // namespace CScore
+
+#endif  // NUMBER_PARSE_HPP_
@@ -0,0 +1,231 @@
+
+#include <cstring>
+
+#include "hardware/exception.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/watchdog.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "post-mortem.hpp"
+#include "utilities.hpp"
+
+namespace CScore {
+
+    namespace {
+        // Not cleared by the C runtime, so it still holds the previous run's record after a warm reset.
+        PostMortemRecord __uninitialized_ram(live_);
+
+        void copyText (char* destination, const std::string& source) {
+            const auto length = source.size() < POST_MORTEM_TEXT_SIZE - 1 ? source.size() : POST_MORTEM_TEXT_SIZE - 1;
+            std::memcpy(destination, source.data(), length);
+            destination[length] = '\0';
+        }
+    }
+
+    PostMortemRecord PostMortem::previous_{};
+    PostMortemCause PostMortem::previousCause_ = PostMortemCause::NONE;
+
+}   // namespace CScore
+
+#if defined (__arm__)
+extern "C" [[noreturn]] void postMortemCaptureFault(const uint32_t* frame) {
+    CScore::PostMortem::captureFault(frame);
+}
+
+// Bit 2 of EXC_RETURN says which stack the exception frame went on. Pass that stack pointer to the C++ side.
+extern "C" __attribute__((naked)) void postMortemHardFaultHandler() {
+    __asm volatile (
+        "movs r0, #4                        \n"
+        "mov  r1, lr                        \n"
+        "tst  r0, r1                        \n"
+        "beq  1f                            \n"
+        "mrs  r0, psp                       \n"
+        "b    2f                            \n"
+        "1:                                 \n"
+        "mrs  r0, msp                       \n"
+        "2:                                 \n"
+        "ldr  r1, =postMortemCaptureFault   \n"
+        "bx   r1                            \n"
+        ".ltorg                             \n"
+    );
+}
+#endif
+
+namespace CScore {
+
+    bool PostMortem::isValid(const PostMortemRecord &record) {
+        return POST_MORTEM_MAGIC == record.magic &&
+               record.logHead < POST_MORTEM_LOG_SIZE &&
+               record.logSize <= POST_MORTEM_LOG_SIZE &&
+               record.fault.stackWords <= POST_MORTEM_STACK_WORDS;
+    }
+
+    void PostMortem::init() {
+        uint32_t bootCount = 1;
+
+        if (isValid(live_)) {
+            previous_ = live_;
+            bootCount = previous_.bootCount + 1;
+
+            if (previous_.hasFault) {
+                previousCause_ = PostMortemCause::HARD_FAULT;
+            } else if (PostMortemCause::NONE != previous_.cause) {
+                previousCause_ = previous_.cause;
+            } else if (watchdog_enable_caused_reboot()) {
+                previousCause_ = PostMortemCause::WATCHDOG;
+            } else {
+                previousCause_ = PostMortemCause::WARM_RESET;
+            }
+        } else {
+            previousCause_ = PostMortemCause::POWER_ON;
+        }
+
+        std::memset(&live_, 0, sizeof(live_));
+        live_.magic = POST_MORTEM_MAGIC;
+        live_.bootCount = bootCount;
+
+#if defined (__arm__)
+        exception_set_exclusive_handler(HARDFAULT_EXCEPTION, postMortemHardFaultHandler);
+#endif
+    }
+
+    void PostMortem::recordLine(const char *text, const size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            live_.log[live_.logHead] = text[i];
+            live_.logHead = (live_.logHead + 1) & (POST_MORTEM_LOG_SIZE - 1);
+        }
+        live_.logSize = live_.logSize + length < POST_MORTEM_LOG_SIZE ? live_.logSize + length : POST_MORTEM_LOG_SIZE;
+    }
+
+    void PostMortem::recordError(const ResponseCode code, const std::string &component, const std::string &function,
+                                 const int line, const std::string &message) {
+        live_.error.code = static_cast<int32_t>(code);
+        live_.error.line = line;
+        copyText(live_.error.component, component);
+        copyText(live_.error.function, function);
+        copyText(live_.error.message, message);
+        live_.hasError = true;
+    }
+
+    void PostMortem::recordCause(const PostMortemCause cause) {
+        live_.cause = cause;
+        live_.uptimeMs = to_ms_since_boot(get_absolute_time());
+    }
+
+    uint32_t PostMortem::getBootCount() {
+        return live_.bootCount;
+    }
+
+    void PostMortem::captureFault(const uint32_t *frame) {
+        auto& fault = live_.fault;
+        const auto address = reinterpret_cast<uintptr_t>(frame);
+
+        // A wild stack pointer is possible here. Don't fault again reading it.
+        if (address >= SRAM_BASE && address + 8 * sizeof(uint32_t) <= SRAM_END && 0 == (address & 3)) {
+            fault.r0 = frame[0];
+            fault.r1 = frame[1];
+            fault.r2 = frame[2];
+            fault.r3 = frame[3];
+            fault.r12 = frame[4];
+            fault.lr = frame[5];
+            fault.pc = frame[6];
+            fault.xpsr = frame[7];
+
+            // xPSR bit 9: the core added a word to align the frame.
+            const auto* above = frame + 8 + ((fault.xpsr >> 9) & 1);
+            fault.sp = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(above));
+
+            const auto wordsToEnd = (SRAM_END - reinterpret_cast<uintptr_t>(above)) / sizeof(uint32_t);
+            fault.stackWords = static_cast<uint8_t>(wordsToEnd < POST_MORTEM_STACK_WORDS ? wordsToEnd
+                                                                                          : POST_MORTEM_STACK_WORDS);
+            for (uint8_t i = 0; i < fault.stackWords; i++) {
+                fault.stack[i] = above[i];
+            }
+        } else {
+            fault.sp = static_cast<uint32_t>(address);
+        }
+
+        live_.hasFault = true;
+        recordCause(PostMortemCause::HARD_FAULT);
+
+        watchdog_reboot(0, 0, 0);
+        while (true) {
+            tight_loop_contents();
+        }
+    }
+
+    std::string PostMortem::causeToLabel(const PostMortemCause cause) {
+        switch (cause) {
+            case PostMortemCause::NONE:         return "None";
+            case PostMortemCause::POWER_ON:     return "Power on";
+            case PostMortemCause::WARM_RESET:   return "Warm reset";
+            case PostMortemCause::WATCHDOG:     return "Watchdog";
+            case PostMortemCause::HARD_FAULT:   return "HardFault";
+            case PostMortemCause::INIT_FAILED:  return "Initialization failed";
+        }
+        return "Unknown";
+    }
+
+    std::vector<std::string> PostMortem::formatReport() {
+        std::vector<std::string> lines;
+        if (!hasReport()) {
+            return lines;
+        }
+
+        lines.push_back("Previous run (boot " + std::to_string(previous_.bootCount) + ") ended: " +
+                        causeToLabel(previousCause_) +
+                        (0 != previous_.uptimeMs ? " at " + std::to_string(previous_.uptimeMs) + " ms" : ""));
+
+        if (previous_.hasFault) {
+            const auto& fault = previous_.fault;
+            lines.push_back("  pc " + int_to_hex_0x(fault.pc) + " lr " + int_to_hex_0x(fault.lr) +
+                            " sp " + int_to_hex_0x(fault.sp) + " xpsr " + int_to_hex_0x(fault.xpsr));
+            lines.push_back("  r0 " + int_to_hex_0x(fault.r0) + " r1 " + int_to_hex_0x(fault.r1) +
+                            " r2 " + int_to_hex_0x(fault.r2) + " r3 " + int_to_hex_0x(fault.r3) +
+                            " r12 " + int_to_hex_0x(fault.r12));
+
+            std::string stack;
+            for (uint8_t i = 0; i < fault.stackWords; i++) {
+                stack += " " + int_to_hex(fault.stack[i]);
+                if (3 == (i & 3) || i + 1 == fault.stackWords) {
+                    lines.push_back("  stack" + stack);
+                    stack.clear();
+                }
+            }
+        }
+
+        if (previous_.hasError) {
+            const auto& error = previous_.error;
+            lines.push_back("  Last error: " + std::string(error.component) + ":" + error.function + "@" +
+                            std::to_string(error.line) + ": " + error.message + "; code:" +
+                            responseToString(static_cast<ResponseCode>(error.code)));
+        }
+
+        // The ring starts part way through a line once it has wrapped. Skip that fragment.
+        std::string text;
+        for (uint16_t i = 0; i < previous_.logSize; i++) {
+            text += previous_.log[(previous_.logHead - previous_.logSize + i) & (POST_MORTEM_LOG_SIZE - 1)];
+        }
+        size_t start = 0;
+        if (POST_MORTEM_LOG_SIZE == previous_.logSize) {
+            const auto firstBreak = text.find('\n');
+            start = std::string::npos == firstBreak ? text.size() : firstBreak + 1;
+        }
+        if (start < text.size()) {
+            lines.emplace_back("  Last log text:");
+            while (start < text.size()) {
+                auto end = text.find('\n', start);
+                if (std::string::npos == end) {
+                    end = text.size();
+                }
+                if (end > start) {
+                    lines.push_back("    " + text.substr(start, end - start));
+                }
+                start = end + 1;
+            }
+        }
+
+        return lines;
+    }
+
+}   // namespace CScore
@@ -0,0 +1,121 @@
+#pragma once
+#ifndef POST_MORTEM_HPP_
+#define POST_MORTEM_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+
+namespace CScore {
+
+    constexpr uint32_t POST_MORTEM_MAGIC = 0x504D5254;     // "PMRT"
+    constexpr uint16_t POST_MORTEM_LOG_SIZE = 1024;        // Bytes of log text. A power of two.
+    constexpr uint8_t POST_MORTEM_STACK_WORDS = 16;        // Stack above the exception frame.
+    constexpr uint8_t POST_MORTEM_TEXT_SIZE = 32;          // Each ErrorContext string, cut to fit.
+    static_assert(0 == (POST_MORTEM_LOG_SIZE & (POST_MORTEM_LOG_SIZE - 1)), "POST_MORTEM_LOG_SIZE must be a power of 2");
+
+    /// @brief Why the previous run ended, as far as the next boot can tell.
+    enum class PostMortemCause : uint8_t {
+        NONE = 0,           // Still running. Never reported.
+        POWER_ON,           // No record survived: a cold start.
+        WARM_RESET,         // The record survived but nothing was noted: reset pin, debugger, reboot command.
+        WATCHDOG,
+        HARD_FAULT,
+        INIT_FAILED         // main gave up during board initialization.
+    };
+
+    // The registers the core stacks on exception entry, then the stack above them.
+    struct PostMortemFault {
+        uint32_t r0;
+        uint32_t r1;
+        uint32_t r2;
+        uint32_t r3;
+        uint32_t r12;
+        uint32_t lr;
+        uint32_t pc;
+        uint32_t xpsr;
+        uint32_t sp;
+        uint32_t stack[POST_MORTEM_STACK_WORDS];
+        uint8_t stackWords;
+    };
+
+    struct PostMortemError {
+        int32_t code;
+        int32_t line;
+        char component[POST_MORTEM_TEXT_SIZE];
+        char function[POST_MORTEM_TEXT_SIZE];
+        char message[POST_MORTEM_TEXT_SIZE];
+    };
+
+    // Plain data, no initializers: it lives in .uninitialized_data and startup mustn't touch it.
+    struct PostMortemRecord {
+        uint32_t magic;
+        uint32_t bootCount;
+        uint32_t uptimeMs;      // When the fault or cause was noted.
+        PostMortemCause cause;
+        bool hasFault;
+        bool hasError;
+        PostMortemFault fault;
+        PostMortemError error;
+        uint16_t logHead;
+        uint16_t logSize;
+        char log[POST_MORTEM_LOG_SIZE];
+    };
+
+    /**
+     * @brief What the previous run left behind, for diagnosing a reset in the field.
+     * A record in RAM that startup doesn't clear holds the latest log text, the last ErrorContext and, after a
+     * HardFault, the stacked registers and the top of the stack. A warm reset (watchdog, fault, reset pin) keeps it.
+     * init() takes a copy of the previous run's record and starts a fresh one; the report is printed at startup
+     * and a summary stored in EEPROM 0.
+     * Logging costs one copy into the ring per line. Nothing else runs until something goes wrong.
+     * All static, like SerialComm.
+     */
+    class PostMortem {
+        PostMortem() = default;
+
+    public:
+        PostMortem(const PostMortem& other) = delete;
+        PostMortem& operator=(const PostMortem& other) = delete;
+
+        /**
+         * @brief Call first thing in main. Keeps the previous record, starts a new one, installs the HardFault handler.
+         */
+        static void init ();
+
+        static void recordLine (const char* text, size_t length);
+
+        static void recordError (ResponseCode code, const std::string& component, const std::string& function,
+                                 int line, const std::string& message);
+
+        // Notes why the firmware is about to stop or reset on purpose.
+        static void recordCause (PostMortemCause cause);
+
+        // True if the previous run left something worth reporting.
+        [[nodiscard]] static bool hasReport () {
+            return PostMortemCause::POWER_ON != previousCause_ && PostMortemCause::NONE != previousCause_;
+        }
+        [[nodiscard]] static PostMortemCause getPreviousCause () {return previousCause_;}
+        [[nodiscard]] static const PostMortemRecord& getPrevious () {return previous_;}
+        [[nodiscard]] static uint32_t getBootCount ();
+
+        [[nodiscard]] static std::vector<std::string> formatReport ();
+
+        static std::string causeToLabel (PostMortemCause cause);
+
+        // Called by the HardFault handler with the stacked exception frame. Doesn't return: it resets the board.
+        [[noreturn]] static void captureFault (const uint32_t* frame);
+
+    private:
+        static bool isValid (const PostMortemRecord& record);
+
+        static PostMortemRecord previous_;
+        static PostMortemCause previousCause_;
+    };
+
+}   // namespace CScore
+
+#endif  // POST_MORTEM_HPP_
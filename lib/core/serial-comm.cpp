@@ -1,9 +1,13 @@
 
 
+#include <cstring>
+
 #include <class/cdc/cdc_device.h>
+#include <device/usbd.h>
 #include <pico/time.h>
 
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 #include "serial-comm.hpp"
 
 namespace CScore {
@@ -13,6 +17,18 @@ namespace CScore {
     uint16_t SerialComm::usbConnectTime_ = 0;
     bool SerialComm::uartEnabled_[2] = {false, false};
     uint SerialComm::actualUartBaudRate_[2] = {0, 0};
+    std::array<char, UART_RX_RING_SIZE> SerialComm::uartRxRing_{};
+    volatile uint16_t SerialComm::uartRxHead_ = 0;
+    volatile uint16_t SerialComm::uartRxTail_ = 0;
+    volatile uint32_t SerialComm::uartRxOverruns_ = 0;
+    uart_inst_t* SerialComm::commandUart_ = nullptr;
+    uint SerialComm::commandUartIrq_ = UART0_IRQ;
+    std::array<char, TX_RING_SIZE> SerialComm::txRing_{};
+    volatile uint16_t SerialComm::txHead_ = 0;
+    volatile uint16_t SerialComm::txTail_ = 0;
+    volatile uint32_t SerialComm::txDroppedBytes_ = 0;
+    TxOverflowPolicy SerialComm::txPolicy_ = TxOverflowPolicy::BLOCK;
+    bool SerialComm::framed_ = false;
 
 
     bool SerialComm::initUsb() {
@@ -87,8 +103,155 @@ namespace CScore {
         }
 
         uartEnabled_[static_cast<size_t>(uartId)] = true;
+
+        if (uartId == config.uart.getCommandHandlerId()) {
+            enableUartRxInterrupt(uartId);
+        }
+        return true;
+
+    }
+
+    void SerialComm::enableUartRxInterrupt(const UartId uartId) {
+        commandUart_ = getUartHardware(uartId);
+        commandUartIrq_ = UartId::UART0 == uartId ? UART0_IRQ : UART1_IRQ;
+        uartRxHead_ = 0;
+        uartRxTail_ = 0;
+
+        irq_set_exclusive_handler(commandUartIrq_, uartIrqHandler);
+        irq_set_enabled(commandUartIrq_, true);
+        uart_set_irq_enables(commandUart_, true, false);    // RX level and RX timeout. TX only while sending.
+    }
+
+    void SerialComm::uartIrqHandler() {
+        auto head = uartRxHead_;
+        while (uart_is_readable(commandUart_)) {
+            const auto ch = uart_getc(commandUart_);
+            const auto next = static_cast<uint16_t>((head + 1) & (UART_RX_RING_SIZE - 1));
+            if (next == uartRxTail_) {
+                uartRxOverruns_ = uartRxOverruns_ + 1;
+                continue;       // Keep reading: the FIFO has to be emptied or the interrupt stays asserted.
+            }
+            uartRxRing_[head] = ch;
+            head = next;
+        }
+        uartRxHead_ = head;    // Publish after the characters are in place.
+
+        fillUartTxFifo();
+    }
+
+    void SerialComm::fillUartTxFifo() {
+        auto tail = txTail_;
+        while (tail != txHead_ && uart_is_writable(commandUart_)) {
+            uart_putc_raw(commandUart_, txRing_[tail]);
+            tail = static_cast<uint16_t>((tail + 1) & (TX_RING_SIZE - 1));
+        }
+        txTail_ = tail;
+
+        // The TX interrupt fires as the FIFO drains. With nothing left to send it would only fire again.
+        uart_set_irq_enables(commandUart_, true, tail != txHead_);
+    }
+
+    void SerialComm::startUartTx() {
+        // The TX interrupt only fires on the FIFO draining past its level, so prime the FIFO here.
+        // The interrupt is off meanwhile so the handler and this don't both move the tail.
+        irq_set_enabled(commandUartIrq_, false);
+        fillUartTxFifo();
+        irq_set_enabled(commandUartIrq_, true);
+    }
+
+    size_t SerialComm::queueOutput(const char *data, const size_t length) {
+        const auto interface = getActiveCommInterface();
+        if (CommInterface::NONE == interface || (CommInterface::UART == interface && nullptr == commandUart_)) {
+            return 0;
+        }
+
+        size_t queued = 0;
+        while (queued < length) {
+            const auto head = txHead_;
+            const auto room = static_cast<size_t>(TX_RING_SIZE - 1 - getTxPending());
+            if (0 == room) {
+                // Waiting only makes sense if something is draining the ring.
+                if (TxOverflowPolicy::BLOCK == txPolicy_ &&
+                    (CommInterface::UART == interface || tud_cdc_connected())) {
+                    serviceOutput();
+                    continue;
+                }
+                break;
+            }
+
+            // Up to the end of the ring, then round again.
+            const auto contiguous = static_cast<size_t>(TX_RING_SIZE - head);
+            auto chunk = length - queued;
+            chunk = chunk < room ? chunk : room;
+            chunk = chunk < contiguous ? chunk : contiguous;
+            std::memcpy(&txRing_[head], data + queued, chunk);
+            queued += chunk;
+            txHead_ = static_cast<uint16_t>((head + chunk) & (TX_RING_SIZE - 1));
+
+            if (CommInterface::UART == interface) {
+                startUartTx();
+            }
+        }
+
+        txDroppedBytes_ = txDroppedBytes_ + (length - queued);
+        return queued;
+    }
+
+    bool SerialComm::queueFrame(const FrameType type, const uint8_t *payload, const size_t length) {
+        uint8_t frame[FRAME_MAX_ENCODED];
+        const auto frameLength = buildFrame(type, payload, length, frame);
+        if (0 == frameLength) {
+            return false;
+        }
+
+        // Half a frame would cost the host this frame and the next. Drop it whole instead.
+        if (TxOverflowPolicy::DROP == txPolicy_ && frameLength > static_cast<size_t>(TX_RING_SIZE - 1 - getTxPending())) {
+            txDroppedBytes_ = txDroppedBytes_ + frameLength;
+            return false;
+        }
+        return frameLength == queueOutput(reinterpret_cast<const char*>(frame), frameLength);
+    }
+
+    void SerialComm::serviceOutput() {
+        if (CommInterface::USB != getActiveCommInterface()) {
+            return;     // The UART drains itself.
+        }
+
+        tud_task();
+        auto tail = txTail_;
+        while (tail != txHead_) {
+            const auto room = tud_cdc_write_available();
+            if (0 == room) {
+                break;
+            }
+            const auto contiguous = static_cast<uint16_t>(txHead_ > tail ? txHead_ - tail : TX_RING_SIZE - tail);
+            const auto written = tud_cdc_write(&txRing_[tail], contiguous < room ? contiguous : room);
+            tail = static_cast<uint16_t>((tail + written) & (TX_RING_SIZE - 1));
+            if (0 == written) {
+                break;
+            }
+        }
+        txTail_ = tail;
+        tud_cdc_write_flush();
+    }
+
+    bool SerialComm::readUartChar(char &ch) {
+        const auto tail = uartRxTail_;
+        if (tail == uartRxHead_) {
+            return false;
+        }
+        ch = uartRxRing_[tail];
+        uartRxTail_ = static_cast<uint16_t>((tail + 1) & (UART_RX_RING_SIZE - 1));
         return true;
+    }
 
+    bool SerialComm::peekUartChar(char &ch) {
+        const auto tail = uartRxTail_;
+        if (tail == uartRxHead_) {
+            return false;
+        }
+        ch = uartRxRing_[tail];
+        return true;
     }
 
     void SerialComm::initUartGpio (UartId instance) {
@@ -152,7 +315,8 @@ namespace CScore {
                 return "USB";
             case CommInterface::UART: {
                 UartId uartId = BOARD.uart.getCommandHandlerId();
-                return "UART" + std::to_string(static_cast<int>(uartId));
+                return "UART" + std::to_string(static_cast<int>(uartId)) +
+                       " (RX overruns: " + std::to_string(getUartRxOverruns()) + ")";
             }
             case CommInterface::NONE:
                 return "None";
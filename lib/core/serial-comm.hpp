@@ -1,12 +1,25 @@
 #pragma once
 #ifndef SERIAL_COMM_HPP_
 
+#include <array>
 #include <string>
 
 #include "board-config.hpp"
+#include "frame-codec.hpp"
 
 namespace CScore {
 
+    constexpr uint16_t UART_RX_RING_SIZE = 256;    // Bytes. A power of two. About 2.5 ms of input at 1 Mbaud.
+    static_assert(0 == (UART_RX_RING_SIZE & (UART_RX_RING_SIZE - 1)), "UART_RX_RING_SIZE must be a power of 2");
+    constexpr uint16_t TX_RING_SIZE = 2048;        // Bytes. A power of two. Several full responses.
+    static_assert(0 == (TX_RING_SIZE & (TX_RING_SIZE - 1)), "TX_RING_SIZE must be a power of 2");
+
+    /// @brief What queueOutput does when the TX ring is full.
+    enum class TxOverflowPolicy : uint8_t {
+        DROP,       // Queue what fits and count the rest. Never waits.
+        BLOCK       // Wait for room. For startup output, before the control loop runs.
+    };
+
     /**
      * Communication interface priorities:
      * 1. USB (if connected)
@@ -41,6 +54,49 @@ namespace CScore {
         static bool initUart(UartId uartId = UartId::UART0);
         static void initUartGpio(UartId instance);
 
+        /**
+         * @brief Command UART input. The RX interrupt empties the FIFO into a ring as characters arrive, so a slow
+         * main loop pass no longer loses input. The ring has one producer (the interrupt) and one consumer (the main
+         * loop), so it needs no lock. A character that finds the ring full is counted and dropped.
+         * @return false if the ring is empty.
+         */
+        static bool readUartChar(char& ch);
+        // The next character, left in the ring.
+        static bool peekUartChar(char& ch);
+        static uint16_t getUartRxPending() {
+            return static_cast<uint16_t>((uartRxHead_ - uartRxTail_) & (UART_RX_RING_SIZE - 1));
+        }
+        static uint32_t getUartRxOverruns() { return uartRxOverruns_; }
+
+        /**
+         * @brief Output to the active interface. Copies into the TX ring and returns; the UART TX interrupt, or
+         * serviceOutput() for USB, sends it. The UART interrupt is the only reader of the ring for UART output,
+         * and the main loop the only writer, so no lock is needed.
+         * @return Bytes queued. Less than length only under TxOverflowPolicy::DROP.
+         */
+        static size_t queueOutput(const char* data, size_t length);
+
+        // Moves queued output to USB CDC, as much as it takes without waiting. Call from the main loop.
+        static void serviceOutput();
+
+        /**
+         * @brief Framed mode (frame-codec.hpp). Everything sent is then a frame: Communication wraps text, and log
+         * output that would be raw text either becomes frames (the binary log) or holds off (the log sinks).
+         */
+        static void setFramed(const bool framed) { framed_ = framed; }
+        static bool isFramed() { return framed_; }
+
+        // Builds the frame on the stack and queues it whole, or not at all.
+        static bool queueFrame(FrameType type, const uint8_t* payload, size_t length);
+
+        static void setTxOverflowPolicy(const TxOverflowPolicy policy) { txPolicy_ = policy; }
+        static TxOverflowPolicy getTxOverflowPolicy() { return txPolicy_; }
+        static uint16_t getTxPending() {
+            return static_cast<uint16_t>((txHead_ - txTail_) & (TX_RING_SIZE - 1));
+        }
+        static uint16_t getTxFree() { return static_cast<uint16_t>(TX_RING_SIZE - 1 - getTxPending()); }
+        static uint32_t getTxDroppedBytes() { return txDroppedBytes_; }
+
         static bool isUartEnabled() { return getActiveCommInterface() == CommInterface::UART; }
         static CommInterface getActiveCommInterface();
         static uint getCommandUartBaudRate();
@@ -59,6 +115,26 @@ namespace CScore {
         static bool usbEnabled_;
         static uint16_t usbConnectTime_;
 
+        static void enableUartRxInterrupt(UartId uartId);
+        static void uartIrqHandler();
+        static void fillUartTxFifo();       // Interrupt context, or with the UART interrupt off.
+        static void startUartTx();
+
+        // The ring keeps one slot empty to tell full from empty.
+        static std::array<char, UART_RX_RING_SIZE> uartRxRing_;
+        static volatile uint16_t uartRxHead_;     // Written by the interrupt only.
+        static volatile uint16_t uartRxTail_;     // Written by readUartChar only.
+        static volatile uint32_t uartRxOverruns_;
+        static uart_inst_t* commandUart_;
+        static uint commandUartIrq_;
+
+        static std::array<char, TX_RING_SIZE> txRing_;
+        static volatile uint16_t txHead_;         // Written by queueOutput only.
+        static volatile uint16_t txTail_;         // Written by whoever sends: the UART interrupt or serviceOutput.
+        static volatile uint32_t txDroppedBytes_;
+        static TxOverflowPolicy txPolicy_;
+        static bool framed_;
+
         // Per-UART state (indexed by UARTInstance)
         static bool uartEnabled_[2];
         static uint actualUartBaudRate_[2];
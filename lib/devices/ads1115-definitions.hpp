@@ -10,6 +10,12 @@
 
 namespace CSdevices {
 
+    // The ADDR pin selects one of four addresses.
+    constexpr uint8_t ADS1115_I2C_ADDRESS_GND = 0x48;   // ADDR tied to GND
+    constexpr uint8_t ADS1115_I2C_ADDRESS_VDD = 0x49;   // ADDR tied to VDD
+    constexpr uint8_t ADS1115_I2C_ADDRESS_SDA = 0x4A;   // ADDR tied to SDA
+    constexpr uint8_t ADS1115_I2C_ADDRESS_SCL = 0x4B;   // ADDR tied to SCL
+
     //AKA Mux
     enum class Ads1115Channel : uint8_t {     // Four channels available per ADC; AKA Mux
         AIN0_1_DIFFERENTIAL = 0b000,// AIN0 and AIN1
@@ -56,20 +56,22 @@ namespace CSdevices {
         return retCode;
     }
 
-    uint16_t Ads1115::setAndReadRegister(Ads111xRegisterAddresses registerAddress) {
+    bool Ads1115::setAndReadRegister(const Ads111xRegisterAddresses registerAddress, uint16_t* result) {
         uint16_t value = 0;
+        auto retCode = false;
 
         if (writeAddressRegister(registerAddress)) { // The register address was set.
             // The register write succeeded. Now read the register we just indicated.
-            if (const auto result = getController().readBuffer(getDeviceAddress(), dataBuffer_, 2);
-                2 == result) {
+            if (const auto bytesRead = getController().readBuffer(getDeviceAddress(), dataBuffer_, 2);
+                2 == bytesRead) {
                 value = networkByteOrderToLocalUint16(dataBuffer_);
+                retCode = true;
             } else {
                 logger_.log(LogLevel::Error,
                             getClassName(),
                             __func__,
                             "Error reading register. Register: " + registerAddressToName(registerAddress) +
-                            " Result: " + int_to_hex_0x(result));
+                            " Result: " + int_to_hex_0x(bytesRead));
             }
         } else {
             logger_.log(LogLevel::Error,
@@ -78,15 +80,16 @@ namespace CSdevices {
                         "Error writing register address. Register: " + registerAddressToName(registerAddress));
         }
 
-#if defined (LOG_GROUP_ADC)
-        logger_.log(LogLevel::Debug,
-                    getClassName(),
-                    __func__,
-                    "Register: " + registerAddressToName(registerAddress) +
-                    "; Value after read: " + int_to_hex_0x(value) + "\n");
-#endif
+        if (logger_.isGroupEnabled(LogGroup::ADC)) {
+            logger_.log(LogLevel::Debug,
+                        getClassName(),
+                        __func__,
+                        "Register: " + registerAddressToName(registerAddress) +
+                        "; Value after read: " + int_to_hex_0x(value) + "\n");
+        }
 
-        return value;
+        *result = value;
+        return retCode;
     }
 
     Ads1115ConfigRegister_t Ads1115::buildConfigRegister() {
@@ -277,17 +280,19 @@ namespace CSdevices {
      * That can be interpreted anyway that's needed by the caller (client) of Ads1115.
      *
      * @param channel
-     * @return
+     * @param counts Set only on success.
+     * @return false on a timeout, an error state, or a failed read.
      */
-    int16_t Ads1115::completeConversion(const Ads1115Channel_t channel) {
-#if defined (LOG_GROUP_ADC)
-        logger_.logMethodEntry(LogLevel::Trace,
-                               getClassName(),
-                               std::string(__func__) ,
-                               "Channel: " + ads1115ChannelToString(channel));
-#endif
+    bool Ads1115::completeConversion(const Ads1115Channel_t channel, int16_t& counts) {
+        if (logger_.isGroupEnabled(LogGroup::ADC)) {
+            logger_.logMethodEntry(LogLevel::Trace,
+                                   getClassName(),
+                                   std::string(__func__) ,
+                                   "Channel: " + ads1115ChannelToString(channel));
+        }
 
         int16_t retValue = 0;
+        auto retCode = false;
         auto i = 2;
         auto pending = true;
         auto error = false; // checking getStatus is somewhat redundant with this, but I'm paranoid about missing it.
@@ -302,45 +307,46 @@ namespace CSdevices {
 
         if (! pending && ! error) {// must have completed.
             // get the actual count value!
-            retValue = static_cast<int16_t>(readRegister(Ads111xRegisterAddresses::ADS111X_CONVERSION_REG_ADDR));
-            // This may have set the status code to ERROR and return 0.
+            uint16_t value = 0;
+            retCode = setAndReadRegister(Ads111xRegisterAddresses::ADS111X_CONVERSION_REG_ADDR, &value);
+            retValue = static_cast<int16_t>(value);
         }
 
 
         /*
         if (getStatus() != CSerrors::StatusCode::READY) {
-#if defined (LOG_GROUP_ADC)
-
-            logger_.log(LogLevel::Debug,
-                        getClassName(),
-                        std::string(__func__),
-                        "Status: " + statusToLabel(getStatus()) +
-                        " Error Code: " + responseToString(getResponseCode()) +
-                        " Error Message: " + getErrorMessage());
-#endif
+            if (logger_.isGroupEnabled(LogGroup::ADC)) {
+                logger_.log(LogLevel::Debug,
+                            getClassName(),
+                            std::string(__func__),
+                            "Status: " + statusToLabel(getStatus()) +
+                            " Error Code: " + responseToString(getResponseCode()) +
+                            " Error Message: " + getErrorMessage());
+            }
 
 
         }
 */
-#if defined (LOG_GROUP_ADC)
-
-        logger_.logMethodExit(LogLevel::Trace,
-                              getClassName(),
-                              std::string(__func__) ,
-                              "retValue: " + std::to_string(retValue));
-#endif
-        
-        return retValue;
+        if (logger_.isGroupEnabled(LogGroup::ADC)) {
+            logger_.logMethodExit(LogLevel::Trace,
+                                  getClassName(),
+                                  std::string(__func__) ,
+                                  "retValue: " + std::to_string(retValue) + (retCode ? "" : " (failed)"));
+        }
+
+        if (retCode) {
+            counts = retValue;
+        }
+        return retCode;
     }
 
     /*
     CSerrors::StatusCode Ads1115::init() {
         const auto retCode = Component::init();
-#if defined LOG_GROUP_INIT
-
-        logger_.log(LogLevel::Debug, getLabel() + " **LOG_GROUP_INIT**" +
-                    __func__ + " Initializing: ");
-#endif
+        if (logger_.isGroupEnabled(LogGroup::INIT)) {
+            logger_.log(LogLevel::Debug, getLabel() + " **LOG_GROUP_INIT**" +
+                        __func__ + " Initializing: ");
+        }
 
         return retCode;
     }
@@ -33,7 +33,12 @@ namespace CSdevices {
 
 
         bool startConversion (Ads1115Channel_t channel);
-        int16_t completeConversion (Ads1115Channel_t channel);  // Returns the counts
+        /**
+         * @brief Waits out the conversion started by startConversion and reads the result.
+         * @param counts Set only on success.
+         * @return false if the conversion didn't finish or the read failed. 0 counts is a real reading, not an error.
+         */
+        bool completeConversion (Ads1115Channel_t channel, int16_t& counts);
         static Ads1115ConfigRegister_t buildConfigRegister (Ads1115Channel_t channel,
                                                             Ads111xOperationalStatus opStatus);
         static Ads1115ConfigRegister_t buildConfigRegister ();
@@ -113,9 +118,19 @@ namespace CSdevices {
          * @brief Writes the register address. Then reads the register data.
          * Don't call this if you are unsure that the current address pointer is the one you want to read.
          * @param registerAddresses
-         * @return
+         * @return The register, or 0 if either transfer failed. Use the other form to tell the two apart.
+         */
+        uint16_t setAndReadRegister (Ads111xRegisterAddresses registerAddresses) {
+            uint16_t value = 0;
+            setAndReadRegister(registerAddresses, &value);
+            return value;
+        }
+
+        /**
+         * @brief As above, with the result separate from the value, as in Ads111x.
+         * @return true if both the address write and the read succeeded.
          */
-        uint16_t setAndReadRegister (Ads111xRegisterAddresses registerAddresses);
+        bool setAndReadRegister (Ads111xRegisterAddresses registerAddress, uint16_t* result);
 
         /**
          * @brief Reads the config register.
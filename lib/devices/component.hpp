@@ -23,7 +23,7 @@ namespace CSdevices {
 
         virtual bool init () {return true;}
 
-        std::string getClassName() {return className_;}
+        [[nodiscard]] std::string getClassName() const {return className_;}
         [[nodiscard]] std::string getLabel() const { return label_; }
         [[nodiscard]] std::string getHierarchy() const { return hierarchy_; }
 
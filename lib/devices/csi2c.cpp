@@ -29,21 +29,20 @@ namespace CSdevices {
                                        __func__);
         int retValue = 0;
 
-#if defined (LOG_GROUP_CSI2C)
-
-        logger_.log(LogLevel::Debug, getLabel() + " " +
-                    __func__ +
-                    "; I2C Bus Controller: " + (ControllerId::I2C_CONTROLLER_0 == getControllerId() ? "0." : "1.") +
-                    ",\n\t deviceAddress: " +
-                    int_to_hex_0x(deviceAddress) + ", " +
-                    " buffer[0..2]: " +
-                    int_to_hex_0x(pBuffer[0]) +
-                    ", " + int_to_hex_0x(pBuffer[1]) +
-                    ", " + int_to_hex_0x(pBuffer[2]) +
-                    " length: " + std::to_string(length) +
-                    " nostop: " + std::to_string(nostop) +
-                    "\n");
-#endif
+        if (logger_.isGroupEnabled(LogGroup::CSI2C)) {
+            logger_.log(LogLevel::Debug, getLabel() + " " +
+                        __func__ +
+                        "; I2C Bus Controller: " + (ControllerId::I2C_CONTROLLER_0 == getControllerId() ? "0." : "1.") +
+                        ",\n\t deviceAddress: " +
+                        int_to_hex_0x(deviceAddress) + ", " +
+                        " buffer[0..2]: " +
+                        int_to_hex_0x(pBuffer[0]) +
+                        ", " + int_to_hex_0x(pBuffer[1]) +
+                        ", " + int_to_hex_0x(pBuffer[2]) +
+                        " length: " + std::to_string(length) +
+                        " nostop: " + std::to_string(nostop) +
+                        "\n");
+        }
         /*
         std::cout << "writeBuffer length: " << length << ". I2C Bus: Controller " <<
             (ControllerId::I2C_CONTROLLER_0 == getControllerId() ? "0." : "1.") << std::endl;
@@ -79,20 +78,19 @@ namespace CSdevices {
     int CsI2C::readBuffer(const uint8_t deviceAddress, uint8_t *pBuffer, const size_t length, const bool nostop) {
         logger_.logMethodEntry(LogLevel::Trace, std::string(getClassName()), __func__);
 
-#if defined (LOG_GROUP_CSI2C)
-
-        logger_.log(LogLevel::Debug, getLabel() + " " +
-                    __func__ +
-                    "; deviceAddress: " +
-                    int_to_hex_0x(deviceAddress) + ", " +
-                    " buffer[0..2]: " +
-                    int_to_hex_0x(pBuffer[0]) +
-                    ", " + int_to_hex_0x(pBuffer[1]) +
-                    ", " + int_to_hex_0x(pBuffer[2]) +
-                    " length: " + std::to_string(length) +
-                    " nostop: " + std::to_string(nostop) +
-                    "\n");
-#endif
+        if (logger_.isGroupEnabled(LogGroup::CSI2C)) {
+            logger_.log(LogLevel::Debug, getLabel() + " " +
+                        __func__ +
+                        "; deviceAddress: " +
+                        int_to_hex_0x(deviceAddress) + ", " +
+                        " buffer[0..2]: " +
+                        int_to_hex_0x(pBuffer[0]) +
+                        ", " + int_to_hex_0x(pBuffer[1]) +
+                        ", " + int_to_hex_0x(pBuffer[2]) +
+                        " length: " + std::to_string(length) +
+                        " nostop: " + std::to_string(nostop) +
+                        "\n");
+        }
 
         const auto retValue =
                 i2c_read_blocking(getI2cInstance(), deviceAddress, pBuffer, length, nostop);
@@ -1,6 +1,7 @@
 #pragma once
 #ifndef DEVICES_CONTAINER_HPP_
 
+#include "ads1115.hpp"
 #include "csi2c.hpp"
 #include "external-thermistor.hpp"
 #include "pico-internal-temp-sensor.hpp"
@@ -51,6 +52,30 @@ namespace CSdevices {
         std::abort();
     }
 
+    // ADC0: Heater (AIN0/AIN1) and Grid 1 (AIN2/AIN3) voltage and current.
+    inline Ads1115& getAdc0 () {
+        static Ads1115 adc0_ {std::string("ADS1115 Adc 0"),
+                                ControllerId::I2C_CONTROLLER_0,
+                                ADS1115_I2C_ADDRESS_GND};
+        return adc0_;
+    }
+
+    // ADC1: Grid 2 (AIN0/AIN1) and Grid 3 (AIN2/AIN3) voltage and current.
+    inline Ads1115& getAdc1 () {
+        static Ads1115 adc1_ {std::string("ADS1115 Adc 1"),
+                                ControllerId::I2C_CONTROLLER_0,
+                                ADS1115_I2C_ADDRESS_VDD};
+        return adc1_;
+    }
+
+    // ADC2: High Voltage (AIN0/AIN1) voltage and current.
+    inline Ads1115& getAdc2 () {
+        static Ads1115 adc2_ {std::string("ADS1115 Adc 2"),
+                                ControllerId::I2C_CONTROLLER_0,
+                                ADS1115_I2C_ADDRESS_SDA};
+        return adc2_;
+    }
+
     inline InternalTempSensor& getOnboardTemperatureSensor () {
         static InternalTempSensor onboardTemperatureSensor_(std::string("OnboardTemperatureSensor"),
                                                             PicoAin::PICO_AINSEL_4);
@@ -1,10 +1,13 @@
 
+#include <algorithm>
 #include <cstring>
+#include <utility>
 
+#include "binary-log.hpp"
+#include "crc.hpp"
 #include "devicesContainer.hpp"
 #include "logger.hpp"
 #include "mcp-24lc32.hpp"
-#include "random.hpp"
 #include "utilities.hpp"
 
 using namespace CScore;
@@ -16,11 +19,9 @@ namespace CSdevices {
     bool Mcp24Lc32::formatEEProm() {
         EepBuffer_t pageBuffer;
 
-        // range-based for loop
-        for(auto & ix : pageBuffer) {
-            // generate a random value for each byte in the buffer.
-            ix = RandomGenerator::getInstance().generateUint8();
-        }
+        // A fixed fill, not random. A page that already holds it is skipped by the compare in writeBytes,
+        // so formatting twice costs no writes.
+        std::memset(pageBuffer, MCP_EEPROM_FORMAT_FILL, sizeof(pageBuffer));
 
         auto retCode = true;
         for (uint16_t i = MIN_PAGE_ID; i <= MAX_PAGE_ID; i++) {
@@ -54,7 +55,502 @@ namespace CSdevices {
         return retVal;
     }
 
-    bool Mcp24Lc32::readBytes(const uint16_t address, uint8_t *buffer) {
+    bool Mcp24Lc32::startBackgroundFormat(const uint8_t firstStep) {
+        formatStep_ = std::min(firstStep, MCP_EEPROM_PAGE_COUNT);
+        formatting_ = formatStep_ < MCP_EEPROM_PAGE_COUNT;
+
+        if (formatting_) {
+            logger_.log(LogLevel::Info, getClassName(), __func__,
+                        "Formatting in the background from step " + std::to_string(formatStep_));
+        }
+        return formatting_;
+    }
+
+    bool Mcp24Lc32::isPageFormatted(const EEPromPageId pageId) {
+        if (!formatting_) {
+            return true;
+        }
+        for (uint8_t step = 0; step < formatStep_; step++) {
+            if (getFormatOrder(step) == pageId) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Mcp24Lc32::doFormatStep() {
+        EepBuffer_t pageBuffer;
+        std::memset(pageBuffer, MCP_EEPROM_FORMAT_FILL, sizeof(pageBuffer));
+
+        // A failure is logged by the page methods. Keep going; the rest of the block is still worth formatting.
+        const auto pageId = getFormatOrder(formatStep_);
+        formatPage(pageId, pageBuffer);
+        initializePage(pageId);
+        flush();
+
+        ++formatStep_;
+        if (formatStep_ >= MCP_EEPROM_PAGE_COUNT) {
+            formatting_ = false;
+            saveFormatProgress(formatStep_);
+            logger_.log(LogLevel::Info, getClassName(), __func__, "Background format complete.");
+            onFormatComplete();
+        } else if (0 == formatStep_ % MCP_EEPROM_FORMAT_PROGRESS_INTERVAL) {
+            saveFormatProgress(formatStep_);
+        }
+    }
+
+    bool Mcp24Lc32::readBytes(const EEPromPageId pageId, uint8_t *buffer) {
+        auto* slot = loadSlot(PageIdToNumber(pageId));
+
+        if (nullptr != slot) {
+            std::memcpy(buffer, getSlotData(*slot), MCP_EEPROM_PAGE_SIZE);
+        }
+        return nullptr != slot && !slot->corrupt;
+    }
+
+    bool Mcp24Lc32::writeBytes(const EEPromPageId pageId, const uint8_t *buffer) {
+        auto* slot = loadSlot(PageIdToNumber(pageId));  // Brings in the current contents to compare against.
+
+        if (nullptr == slot) {
+            return false;
+        }
+
+        EepBuffer_t sealed;
+        const uint8_t* source = buffer;
+        if (hasPageCrc(pageId)) {
+            std::memcpy(sealed, buffer, MCP_EEPROM_PAGE_SIZE);
+            sealPage(sealed);
+            source = sealed;
+        }
+
+        slot->corrupt = false;
+        if (0 == std::memcmp(getSlotData(*slot), source, MCP_EEPROM_PAGE_SIZE)) {
+            ++cacheStats_.writesSkipped;
+            return true;
+        }
+
+        std::memcpy(getSlotData(*slot), source, MCP_EEPROM_PAGE_SIZE);
+        slot->dirty = true;
+        ++writeGeneration_;
+
+        return writeBack_ ? true : flushSlot(*slot);
+    }
+
+    bool Mcp24Lc32::writePartial(const EEPromPageId pageId, const uint8_t offset,
+                                 const uint8_t *buffer, const uint8_t length) {
+        if (0 == length || offset + length > MCP_EEPROM_PAGE_SIZE) {
+            return false;
+        }
+
+        auto* slot = loadSlot(PageIdToNumber(pageId));
+        if (nullptr == slot) {
+            return false;
+        }
+
+        auto* data = getSlotData(*slot);
+        if (0 == std::memcmp(data + offset, buffer, length)) {
+            ++cacheStats_.writesSkipped;
+            return true;
+        }
+
+        std::memcpy(data + offset, buffer, length);
+        ++writeGeneration_;
+
+        // The trailer changes with the data, so it has to go out too.
+        auto writeLength = length;
+        if (hasPageCrc(pageId)) {
+            sealPage(data);
+            slot->corrupt = false;
+            writeLength = MCP_EEPROM_PAGE_SIZE - offset;
+        }
+
+        // A page that's already dirty goes out whole at the next flush, which covers these bytes too.
+        if (slot->dirty) {
+            return true;
+        }
+
+        if (!enqueueWrite(slot->pageNumber, data, offset, writeLength)) {
+            slot->dirty = true;     // No room. Fall back to a full page at the next flush.
+        }
+        return true;
+    }
+
+    bool Mcp24Lc32::loadPages(const EEPromPageId firstPage, const uint8_t pageCount) {
+        const auto first = PageIdToNumber(firstPage);
+        const auto count = std::min<uint16_t>({pageCount,
+                                               static_cast<uint16_t>(MCP_EEPROM_PAGE_COUNT - first),
+                                               MCP_EEPROM_CACHE_PAGE_COUNT});
+        auto retCode = true;
+        uint8_t runStart = first;
+        uint8_t runLength = 0;
+
+        for (uint16_t page = first; page < first + count; page++) {
+            const auto pageNumber = static_cast<uint8_t>(page);
+            const auto slotIndex = getSlotIndex(pageNumber);
+            auto& slot = cache_[slotIndex];
+
+            // Slot data is only contiguous up to the end of the cache array.
+            if (runLength > 0 && 0 == slotIndex) {
+                retCode &= loadRun(runStart, runLength);
+                runLength = 0;
+            }
+
+            // Dirty data is newer than the chip, and so is a page waiting in the write queue. Neither can be
+            // overwritten by the bulk read, so they end the current run.
+            if (slot.valid && slot.dirty) {
+                retCode &= loadRun(runStart, runLength);
+                runLength = 0;
+                if (slot.pageNumber == pageNumber) {
+                    continue;
+                }
+                // Direct mapped: the slot holds another page's changes. They go to the write queue before the slot
+                // is reused, as in loadSlot.
+                if (!flushSlot(slot)) {
+                    retCode = false;
+                    continue;
+                }
+            }
+            if (const auto* pending = findQueuedWrite(pageNumber); nullptr != pending) {
+                retCode &= loadRun(runStart, runLength);
+                runLength = 0;
+                std::memcpy(getSlotData(slot), pending->data, MCP_EEPROM_PAGE_SIZE);
+                slot.pageNumber = pageNumber;
+                slot.valid = true;
+                slot.corrupt = false;
+                continue;
+            }
+
+            if (0 == runLength) {
+                runStart = pageNumber;
+            }
+            ++runLength;
+        }
+
+        retCode &= loadRun(runStart, runLength);
+        return retCode;
+    }
+
+    bool Mcp24Lc32::readPages(const EEPromPageId firstPage, const uint8_t pageCount, uint8_t *buffer) {
+        const auto first = PageIdToNumber(firstPage);
+        const auto count = std::min<uint16_t>(pageCount, MCP_EEPROM_PAGE_COUNT - first);
+        auto retCode = true;
+
+        // A range larger than the cache goes in cache-sized chunks.
+        for (uint16_t done = 0; done < count; ) {
+            const auto chunk = static_cast<uint8_t>(std::min<uint16_t>(count - done, MCP_EEPROM_CACHE_PAGE_COUNT));
+            retCode &= loadPages(NumberToPageId(first + done), chunk);
+            for (uint8_t i = 0; i < chunk; i++, done++) {
+                retCode &= readBytes(NumberToPageId(first + done), buffer + done * MCP_EEPROM_PAGE_SIZE);
+            }
+        }
+
+        return retCode;
+    }
+
+    bool Mcp24Lc32::loadRun(const uint8_t firstPage, const uint8_t pageCount) {
+        if (0 == pageCount) {
+            return true;
+        }
+
+        const auto firstSlot = getSlotIndex(firstPage);
+        const auto retCode = readFromChip(firstPage * MCP_EEPROM_PAGE_SIZE,
+                                          cacheData_[firstSlot],
+                                          pageCount * MCP_EEPROM_PAGE_SIZE);
+
+        for (uint8_t i = 0; i < pageCount; i++) {
+            auto& slot = cache_[firstSlot + i];
+            slot.pageNumber = firstPage + i;
+            slot.valid = retCode;
+            slot.dirty = false;
+            if (retCode) {
+                verifySlot(slot);
+            }
+        }
+
+        ++cacheStats_.bulkReads;
+        return retCode;
+    }
+
+    bool Mcp24Lc32::flush() {
+        auto retCode = true;
+
+        // Slots are in page order when the cache covers the device, so the signature page (last) is queued last.
+        for (auto& slot : cache_) {
+            if (slot.valid && slot.dirty) {
+                retCode &= flushSlot(slot);
+            }
+        }
+
+        nextFlushTime_ = make_timeout_time_ms(flushIntervalMs_);
+        return retCode;
+    }
+
+    bool Mcp24Lc32::flushIfDue() {
+        return time_reached(nextFlushTime_) ? flush() : true;
+    }
+
+    bool Mcp24Lc32::flushAndWait(const uint32_t timeoutMs) {
+        const auto deadline = make_timeout_time_ms(timeoutMs);
+
+        // The queue is smaller than the cache, so a big flush goes out in several rounds.
+        while (!time_reached(deadline)) {
+            const auto allQueued = flush();
+            if (allQueued && isWriteIdle()) {
+                return true;
+            }
+            if (!service()) {
+                sleep_ms(1);
+            }
+        }
+
+        return false;
+    }
+
+    bool Mcp24Lc32::service() {
+        flushIfDue();
+
+        // Waiting for an empty queue keeps each step's page ahead of the progress marker that follows it.
+        if (formatting_ && isWriteIdle()) {
+            doFormatStep();
+        }
+
+        if (WriteState::WRITE_CYCLE == writeState_) {
+            if (!time_reached(getReadyTime())) {
+                return false;
+            }
+            if (pollWriteComplete()) {
+                completeWrite(true);
+            } else if (time_reached(writeDeadline_)) {
+                completeWrite(false);
+            }
+            return true;
+        }
+
+        if (queueCount_ > 0) {
+            startWrite();
+            return true;
+        }
+
+        if (!formatting_ && time_reached(nextScrubTime_)) {
+            scrubNextPage();
+            return true;
+        }
+
+        return false;
+    }
+
+    void Mcp24Lc32::sealPage(uint8_t *page) {
+        const auto crc = crc16Ccitt(page, MCP_EEPROM_PAGE_PAYLOAD_SIZE);
+        page[MCP_EEPROM_PAGE_PAYLOAD_SIZE] = static_cast<uint8_t>(crc >> 8);
+        page[MCP_EEPROM_PAGE_PAYLOAD_SIZE + 1] = static_cast<uint8_t>(crc);
+    }
+
+    bool Mcp24Lc32::isPageIntact(const uint8_t *page) {
+        const auto stored = static_cast<uint16_t>((page[MCP_EEPROM_PAGE_PAYLOAD_SIZE] << 8) |
+                                                  page[MCP_EEPROM_PAGE_PAYLOAD_SIZE + 1]);
+        return stored == crc16Ccitt(page, MCP_EEPROM_PAGE_PAYLOAD_SIZE);
+    }
+
+    void Mcp24Lc32::verifySlot(CachedPage &slot) {
+        slot.corrupt = hasPageCrc(NumberToPageId(slot.pageNumber)) && !isPageIntact(getSlotData(slot));
+
+        if (slot.corrupt) {
+            ++cacheStats_.crcErrors;
+            binaryLog_.record(LogLevel::Warn, LogFormatId::EEPROM_CRC_MISMATCH, slot.pageNumber);
+        }
+    }
+
+    void Mcp24Lc32::scrubNextPage() {
+        nextScrubTime_ = make_timeout_time_ms(scrubIntervalMs_);
+
+        // Find the next page with a CRC. A full lap with none means there's nothing to scrub.
+        auto pageNumber = scrubPage_;
+        uint8_t tries = 0;
+        while (!hasPageCrc(NumberToPageId(pageNumber)) && tries < MCP_EEPROM_PAGE_COUNT) {
+            pageNumber = (pageNumber + 1) % MCP_EEPROM_PAGE_COUNT;
+            ++tries;
+        }
+        if (tries >= MCP_EEPROM_PAGE_COUNT) {
+            return;
+        }
+        scrubPage_ = (pageNumber + 1) % MCP_EEPROM_PAGE_COUNT;
+
+        // Straight from the chip. The point is to catch what the cache would hide.
+        EepBuffer_t chipData;
+        if (!readFromChip(pageNumber * MCP_EEPROM_PAGE_SIZE, chipData, MCP_EEPROM_PAGE_SIZE)) {
+            return;
+        }
+        ++cacheStats_.pagesScrubbed;
+
+        if (isPageIntact(chipData)) {
+            return;
+        }
+
+        ++cacheStats_.crcErrors;
+        binaryLog_.record(LogLevel::Warn, LogFormatId::EEPROM_CRC_MISMATCH, pageNumber);
+        auto& slot = cache_[getSlotIndex(pageNumber)];
+        const auto cached = slot.valid && slot.pageNumber == pageNumber;
+
+        if (cached && !slot.corrupt && isPageIntact(getSlotData(slot))) {
+            // The cache still has the page from before the damage. The next flush writes it back.
+            slot.dirty = true;
+            ++cacheStats_.pagesRepaired;
+        } else {
+            if (cached && !slot.dirty) {
+                slot.corrupt = true;
+            }
+            logger_.log(LogLevel::Error, getClassName(), __func__,
+                        "Scrub found page " + std::to_string(pageNumber) + " damaged; no good copy.");
+        }
+    }
+
+    void Mcp24Lc32::invalidateCache() {
+        for (auto& slot : cache_) {
+            if (!slot.dirty) {
+                slot.valid = false;
+            }
+        }
+        ++writeGeneration_;
+    }
+
+    uint8_t Mcp24Lc32::getDirtyPageCount() const {
+        uint8_t count = 0;
+        for (const auto& slot : cache_) {
+            count += (slot.valid && slot.dirty) ? 1 : 0;
+        }
+        return count;
+    }
+
+    Mcp24Lc32::CachedPage * Mcp24Lc32::loadSlot(const uint8_t pageNumber) {
+        auto& slot = cache_[getSlotIndex(pageNumber)];
+
+        if (slot.valid && slot.pageNumber == pageNumber) {
+            ++cacheStats_.hits;
+            return &slot;
+        }
+
+        ++cacheStats_.misses;
+
+        // Direct mapped: the slot belongs to another page. Don't lose its changes.
+        if (slot.valid && slot.dirty && !flushSlot(slot)) {
+            return nullptr;
+        }
+
+        slot.valid = false;
+
+        slot.pageNumber = pageNumber;
+        slot.dirty = false;
+        slot.corrupt = false;
+
+        // A page still waiting in the write queue is newer than what's on the chip.
+        if (const auto* pending = findQueuedWrite(pageNumber); nullptr != pending) {
+            std::memcpy(getSlotData(slot), pending->data, MCP_EEPROM_PAGE_SIZE);
+        } else if (readFromChip(pageNumber * MCP_EEPROM_PAGE_SIZE, getSlotData(slot), MCP_EEPROM_PAGE_SIZE)) {
+            verifySlot(slot);
+        } else {
+            return nullptr;
+        }
+
+        slot.valid = true;
+        return &slot;
+    }
+
+    bool Mcp24Lc32::flushSlot(CachedPage &slot) {
+        const auto retCode = enqueueWrite(slot.pageNumber, getSlotData(slot));
+
+        if (retCode) {
+            slot.dirty = false;
+        }
+        return retCode;
+    }
+
+    bool Mcp24Lc32::enqueueWrite(const uint8_t pageNumber, const uint8_t *pageImage,
+                                 const uint8_t offset, const uint8_t length) {
+        // A page queued but not yet started just takes the newer data, and the union of the two byte ranges.
+        // The head may already be on the wire, so it's left alone.
+        for (uint8_t i = 0; i < queueCount_; i++) {
+            auto& entry = writeQueue_[(queueHead_ + i) % MCP_EEPROM_WRITE_QUEUE_SIZE];
+            const auto inFlight = (0 == i && WriteState::WRITE_CYCLE == writeState_);
+            if (!inFlight && entry.pageNumber == pageNumber) {
+                const auto end = std::max(entry.offset + entry.length, offset + length);
+                std::memcpy(entry.data, pageImage, MCP_EEPROM_PAGE_SIZE);
+                entry.offset = std::min(entry.offset, offset);
+                entry.length = static_cast<uint8_t>(end - entry.offset);
+                entry.attempts = 0;
+                return true;
+            }
+        }
+
+        if (queueCount_ >= MCP_EEPROM_WRITE_QUEUE_SIZE) {
+            return false;
+        }
+
+        auto& entry = writeQueue_[(queueHead_ + queueCount_) % MCP_EEPROM_WRITE_QUEUE_SIZE];
+        std::memcpy(entry.data, pageImage, MCP_EEPROM_PAGE_SIZE);
+        entry.pageNumber = pageNumber;
+        entry.offset = offset;
+        entry.length = length;
+        entry.attempts = 0;
+        ++queueCount_;
+
+        return true;
+    }
+
+    const Mcp24Lc32::PendingWrite * Mcp24Lc32::findQueuedWrite(const uint8_t pageNumber) const {
+        // Newest first. Only the in-flight head and one later entry can share a page.
+        for (uint8_t i = queueCount_; i > 0; i--) {
+            const auto& entry = writeQueue_[(queueHead_ + i - 1) % MCP_EEPROM_WRITE_QUEUE_SIZE];
+            if (entry.pageNumber == pageNumber) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    void Mcp24Lc32::startWrite() {
+        auto& entry = writeQueue_[queueHead_];
+
+        ++entry.attempts;
+        if (writeToChip(entry.pageNumber * MCP_EEPROM_PAGE_SIZE + entry.offset, entry.data + entry.offset, entry.length)) {
+            writeState_ = WriteState::WRITE_CYCLE;
+            writeDeadline_ = make_timeout_time_ms(MCP_EEPROM_WRITE_CYCLE_TIMEOUT_MS);
+        } else {
+            completeWrite(false);
+        }
+    }
+
+    void Mcp24Lc32::completeWrite(const bool success) {
+        auto& entry = writeQueue_[queueHead_];
+        writeState_ = WriteState::IDLE;
+
+        if (!success && entry.attempts < MAX_WRITE_ATTEMPTS) {
+            ++cacheStats_.writeRetries;     // Leave it at the head. The next service() starts it again.
+            return;
+        }
+
+        const auto pageNumber = entry.pageNumber;
+        const auto attempts = entry.attempts;
+        queueHead_ = (queueHead_ + 1) % MCP_EEPROM_WRITE_QUEUE_SIZE;
+        --queueCount_;
+
+        if (success) {
+            ++cacheStats_.pagesWritten;
+        } else {
+            ++cacheStats_.writeErrors;
+            binaryLog_.record(LogLevel::Error, LogFormatId::EEPROM_WRITE_FAILED, pageNumber, attempts);
+
+            // The cache still has the data. Mark it dirty so a later flush tries again.
+            if (auto& slot = cache_[getSlotIndex(pageNumber)]; slot.valid && slot.pageNumber == pageNumber) {
+                slot.dirty = true;
+            }
+        }
+
+        if (nullptr != writeCompleteCallback_) {
+            writeCompleteCallback_(NumberToPageId(pageNumber), success, writeCompleteContext_);
+        }
+    }
+
+    bool Mcp24Lc32::readFromChip(const uint16_t address, uint8_t *buffer, const size_t length) {
         bool retCode = false;
         const ControlByte_t controlByte = getControlByte();
         uint8_t addressBigEndian[2];
@@ -62,49 +558,57 @@ namespace CSdevices {
 
         localUint16ToNetworkByteOrder(address, addressBigEndian);
 
-        // Check that no prior write is pending.
-        if ((retCode = isEEPromWriteReady(controlByte))) {
-            bytesWritten = getController().writeBuffer(controlByte.byte,
-                                                       addressBigEndian,
-                                                       sizeof(addressBigEndian),
-                                                       false);
-
-            if (sizeof(addressBigEndian) ==  bytesWritten) {
-                bytesRead = getController().readBuffer(controlByte.byte,
-                                                             buffer,
-                                                             MCP_EEPROM_PAGE_SIZE,
-                                                             false); // send the stop bit
-//                constexpr int foo = MCP_EEPROM_PAGE_SIZE;   // Why foo? so the static analyzer won't freak out
-//                retCode = (foo == bytesRead);               // about comparing signed & unsigned.
-                retCode = (MCP_EEPROM_PAGE_SIZE == bytesRead);
-            }
-        } else {
+        // The chip ignores reads until its write cycle is over. Busy is not an error; the caller tries later.
+        if (!finishWriteCycle()) {
+            ++cacheStats_.busyReads;
+            return false;
+        }
+
+        bytesWritten = getController().writeBuffer(controlByte.byte,
+                                                   addressBigEndian,
+                                                   sizeof(addressBigEndian),
+                                                   false);
+
+        if (sizeof(addressBigEndian) ==  bytesWritten) {
+            // The chip's address counter runs on across page boundaries for reads, so one transaction
+            // can cover any number of pages.
+            bytesRead = getController().readBuffer(controlByte.byte,
+                                                         buffer,
+                                                         length,
+                                                         false); // send the stop bit
+            retCode = std::cmp_equal(length, bytesRead);
+        }
+        if (!retCode) {
             logger_.log(LogLevel::Error,
                                      getClassName(),
-                                     "readBytes; bytes read, written: " +
+                                     "readFromChip; bytes read, written: " +
                                      std::to_string(bytesRead),
                                      std::to_string(bytesWritten));
         }
         return retCode;
     }
 
-    bool Mcp24Lc32::writeBytes(const uint16_t address, const uint8_t *buffer) {
+    bool Mcp24Lc32::writeToChip(const uint16_t address, const uint8_t *buffer, const uint8_t length) {
         bool retCode;
 
-        // Check that no prior write is pending.
-        if (const ControlByte_t controlByte = getControlByte(); (retCode = isEEPromWriteReady(controlByte))) {
+        // Only startWrite() calls this, and only when no write cycle is in progress.
+        // The chip wraps within a page, so a write that crosses a page boundary would land in the wrong place.
+        if (const ControlByte_t controlByte = getControlByte();
+            (retCode = (WriteState::IDLE == writeState_ &&
+                        length > 0 &&
+                        (address % MCP_EEPROM_PAGE_SIZE) + length <= MCP_EEPROM_PAGE_SIZE))) {
             uint8_t bigEndianAddressPlusData[2 + MCP_EEPROM_PAGE_SIZE];
 
             localUint16ToNetworkByteOrder(address, bigEndianAddressPlusData);
 
-            std::memcpy(&bigEndianAddressPlusData[2], buffer, MCP_EEPROM_PAGE_SIZE);
+            std::memcpy(&bigEndianAddressPlusData[2], buffer, length);
 
             const auto bytesWritten = getController().writeBuffer(controlByte.byte,
                                                                      bigEndianAddressPlusData,
-                                                                     MCP_EEPROM_PAGE_SIZE + 2,
+                                                                     length + 2,
                                                                      false); // send the stop bit
 
-            if ((retCode = (MCP_EEPROM_PAGE_SIZE + 2 == bytesWritten))) {
+            if ((retCode = (length + 2 == bytesWritten))) {
                 setReadyTime();
             }
         }
@@ -121,31 +625,33 @@ namespace CSdevices {
         return result;
     }
 
-    // Note that this is called recursively.
-    bool Mcp24Lc32::isEEPromWriteReady(const ControlByte_t controlByte, const uint8_t tryNumber) {
-        bool retCode = false;
-
-        sleep_until(getReadyTime());
-        // Now we can check if the device is ready to go.
+    bool Mcp24Lc32::pollWriteComplete() {
         // This is done by writing 0 bytes to the device. If it answers >= 0, then ready.
-
         constexpr uint8_t value = 0;  // dummy value for the control byte write
 
-        const auto bytesWritten = getController().writeBuffer(controlByte.byte,
+        const auto bytesWritten = getController().writeBuffer(getControlByte().byte,
                                                                  &value,
                                                                  0,       // Not really writing. Just checking
                                                                  false); // send the stop bit
+        return bytesWritten >= 0;
+    }
 
-        if (bytesWritten < 0 && tryNumber > 0) {
-            // Did not work. Let's try once more.
-            setReadyTime();
-            retCode = isEEPromWriteReady(controlByte, tryNumber - 1);
+    bool Mcp24Lc32::finishWriteCycle() {
+        if (WriteState::WRITE_CYCLE != writeState_) {
+            return true;
+        }
+        if (!time_reached(getReadyTime())) {
+            return false;
         }
 
-        if (!retCode) {
-            retCode = bytesWritten >= 0;
+        if (pollWriteComplete()) {
+            completeWrite(true);
+            return true;
         }
-        return retCode;
+        if (time_reached(writeDeadline_)) {
+            completeWrite(false);
+        }
+        return false;
     }
 
 }
@@ -6,6 +6,8 @@
 // This represents the EEPROM
 // 4096 bytes arranged in 128 pages of 32 bytes
 
+#include <array>
+
 #include "csi2c.hpp"
 #include "devicesContainer.hpp"
 #include "mcp-eeprom-declarations.hpp"
@@ -53,13 +55,30 @@ class Mcp24Lc32 : public Component {
 
         /**
          * @brief This formats a single page.
-         * The subclass can override this if needed. The default format is to write random data in all the bytes.
+         * The subclass can override this if needed. The default format is to write the fill in all the bytes.
          * @param pageId The id of the page: MIN_PAGE_ID through MAX_PAGE_ID.
          * @param pageBuffer The data to write to the page in question. Typically the same for all pages in a block.
          * @return true if the page was correctly formatted.
          */
         virtual bool formatPage (EEPromPageId pageId, EepBuffer_t pageBuffer);
 
+        /**
+         * @brief Starts formatting and initializing the block in the background. service() does one page per call.
+         * Pages go in getFormatOrder() order, so the ones needed early can come first. Progress is handed to
+         * saveFormatProgress() so a reset can resume with firstStep instead of starting over.
+         * @param firstStep Where to start in the format order. 0 for a fresh format.
+         * @return true if the job is running.
+         */
+        bool startBackgroundFormat (uint8_t firstStep = 0);
+
+        [[nodiscard]] bool isFormatting () const {return formatting_;}
+        [[nodiscard]] uint8_t getFormatStep () const {return formatStep_;}
+
+        /**
+         * @brief Whether a page holds its formatted content yet. Always true when no format is running.
+         */
+        [[nodiscard]] bool isPageFormatted (EEPromPageId pageId);
+
         /**
          * @brief This initializes all pages of the block.
          * Note that it is not necessary to override this to do custom initialization.
@@ -106,37 +125,172 @@ class Mcp24Lc32 : public Component {
 
         /**
          * @brief Reads the designated page.
+         * This is served from the page cache when the page is resident. A miss reads the chip and fills the slot.
+         * For a page with a CRC trailer, false means the CRC didn't match. The data is still copied out.
+         * A miss while the chip is in a write cycle fails at once rather than wait the cycle out. It counts in
+         * busyReads; the same read works once service() has seen the cycle end.
          * There is no need to worry about endianess for the data. But yes for the address.
          * @param pageId
          * @param buffer - where to put the data.
          * @return true if a page of buffer were read, else false.
          */
-        bool readBytes (const EEPromPageId pageId, uint8_t* buffer) {
-            return readBytes(PageIdToNumber(pageId) * MCP_EEPROM_PAGE_SIZE, buffer);
-        }
-
-        bool readBytes (uint16_t address, uint8_t* buffer);
+        bool readBytes (EEPromPageId pageId, uint8_t* buffer);
 
         /**
          * @brief Writes the designated page.
+         * For a page with a CRC trailer, the last MCP_EEPROM_PAGE_CRC_SIZE bytes of buffer are replaced by the CRC.
+         * The new data is compared against the cached copy first. An unchanged page is never written.
+         * In write-back mode a changed page is only marked dirty; flush() or flushIfDue() queues it for the chip.
+         * In write-through mode it's queued immediately.
+         * Either way this returns without waiting for the chip. service() does the writes.
          * @param pageId Id of the page to write.
          * @param buffer Pointer to the data for the write.
          * @return true if all is well.
          */
-        bool writeBytes (const EEPromPageId pageId, const uint8_t* buffer) {
-            return writeBytes(PageIdToNumber(pageId) * MCP_EEPROM_PAGE_SIZE, buffer);
+        bool writeBytes (EEPromPageId pageId, const uint8_t* buffer);
+
+        /**
+         * @brief Writes part of a page. Only those bytes go to the chip, and they go to the write queue right away
+         * regardless of write-back mode. Meant for small appends that should be durable soon.
+         * The cache is updated too. Unchanged bytes are not written.
+         * @param pageId The page.
+         * @param offset Byte offset in the page.
+         * @param buffer The bytes.
+         * @param length How many. offset + length must not pass the end of the page.
+         * @return true if the bytes are cached and queued (or will go with the next flush).
+         */
+        bool writePartial (EEPromPageId pageId, uint8_t offset, const uint8_t* buffer, uint8_t length);
+
+        /**
+         * @brief Brings a range of pages into the cache with one sequential read.
+         * Pages that are dirty, or still waiting in the write queue, are newer than the chip. They split the range
+         * and keep their data, so a busy cache may take a few transactions. A clean cache takes one.
+         * @param firstPage The first page to load.
+         * @param pageCount How many. Clamped to the end of the device and to MCP_EEPROM_CACHE_PAGE_COUNT.
+         * @return true if every page in the range is now resident.
+         */
+        bool loadPages (EEPromPageId firstPage, uint8_t pageCount);
+
+        /**
+         * @brief Loads the whole device image into the cache. With a smaller cache, the lowest pages.
+         */
+        bool loadAll () {return loadPages(EEPromPageId::PAGE_MINIMUM, MCP_EEPROM_PAGE_COUNT);}
+
+        /**
+         * @brief Reads a range of pages into buffer. The range is loaded through the cache in bulk first.
+         * @param buffer Must hold pageCount * MCP_EEPROM_PAGE_SIZE bytes.
+         * @return true if every page was read.
+         */
+        bool readPages (EEPromPageId firstPage, uint8_t pageCount, uint8_t* buffer);
+
+        /**
+         * @brief Moves every dirty page to the write queue, lowest page first.
+         * Pages that don't fit in the queue stay dirty for the next flush.
+         * @return true if no dirty pages remain.
+         */
+        bool flush ();
+
+        /**
+         * @brief Flushes if the flush interval has elapsed since the last flush.
+         * @return true if nothing failed. Returns true when it is not yet time to flush.
+         */
+        bool flushIfDue ();
+
+        /**
+         * @brief Flushes and then runs the write queue until it's empty. This blocks. Meant for startup.
+         * @param timeoutMs Gives up after this long.
+         * @return true if every page reached the chip.
+         */
+        bool flushAndWait (uint32_t timeoutMs = 2000);
+
+        /**
+         * @brief Advances the write pipeline. Call this from the main loop.
+         * Each call does at most one I2C transaction: start the next page write, or one ACK poll of the one
+         * in progress. It never sleeps. The periodic flush is handled here too, and so is a background format:
+         * when the queue is idle, the next page of the format is done. With nothing else to do, the scrub runs.
+         * @return true if the pipeline did something.
+         */
+        bool service ();
+
+        using WriteCompleteCallback = void (*)(EEPromPageId pageId, bool success, void* context);
+
+        /**
+         * @brief Called from service() each time a queued page write finishes or is given up on.
+         */
+        void setWriteCompleteCallback (const WriteCompleteCallback callback, void* context = nullptr) {
+            writeCompleteCallback_ = callback;
+            writeCompleteContext_ = context;
         }
 
-        bool writeBytes (uint16_t address, const uint8_t* buffer);
+        [[nodiscard]] uint8_t getPendingWriteCount () const {return queueCount_;}
+        [[nodiscard]] bool isWriteIdle () const {return 0 == queueCount_ && WriteState::IDLE == writeState_;}
+
+        /**
+         * @brief Drops all clean pages from the cache. Dirty pages are kept; flush first to drop everything.
+         */
+        void invalidateCache ();
+
+        void setScrubIntervalMs (const uint32_t scrubIntervalMs) {scrubIntervalMs_ = scrubIntervalMs;}
+
+        /**
+         * @brief Writes the CRC of the first MCP_EEPROM_PAGE_PAYLOAD_SIZE bytes into the trailer.
+         */
+        static void sealPage (uint8_t* page);
+
+        /**
+         * @brief Checks the trailer against the payload.
+         */
+        [[nodiscard]] static bool isPageIntact (const uint8_t* page);
+
+        void setWriteBack (const bool writeBack) {writeBack_ = writeBack;}
+        [[nodiscard]] bool isWriteBack () const {return writeBack_;}
+        void setFlushIntervalMs (const uint32_t flushIntervalMs) {flushIntervalMs_ = flushIntervalMs;}
+
+        [[nodiscard]] uint8_t getDirtyPageCount () const;
+
+        /**
+         * @brief Changes whenever cached page contents change: a write that wasn't skipped, or invalidateCache.
+         * A copy of a page taken at one generation is still current while the generation is unchanged.
+         */
+        [[nodiscard]] uint32_t getWriteGeneration () const {return writeGeneration_;}
+
+        struct PageCacheStats {
+            uint32_t hits           = 0;
+            uint32_t misses         = 0;
+            uint32_t bulkReads      = 0;    // Sequential reads issued by loadPages.
+            uint32_t writesSkipped  = 0;    // Writes whose data matched what was already there.
+            uint32_t pagesWritten   = 0;    // Page writes that actually reached the chip.
+            uint32_t writeRetries   = 0;
+            uint32_t writeErrors    = 0;    // Page writes given up on after MAX_WRITE_ATTEMPTS.
+            uint32_t crcErrors      = 0;    // CRC pages that failed their check, on load or in the scrub.
+            uint32_t pagesScrubbed  = 0;
+            uint32_t pagesRepaired  = 0;    // Bad on the chip, rewritten from a good cached copy.
+            uint32_t busyReads      = 0;    // Chip reads turned away because a write cycle was in progress.
+        };
+        [[nodiscard]] const PageCacheStats& getCacheStats () const {return cacheStats_;}
 
     protected:
 
-        static constexpr uint8_t EEPromWriteSettlingTime_ms = 5;
-        static constexpr uint8_t MAX_ATTEMPTS_AT_SETTLING = 3;
+        static constexpr uint8_t EEPromWriteSettlingTime_ms = MCP_EEPROM_WRITE_CYCLE_MS;
+        static constexpr uint8_t MAX_WRITE_ATTEMPTS = 3;
+
+        enum class WriteState : uint8_t {
+            IDLE,           // Nothing on the chip. The next queued page can start.
+            WRITE_CYCLE     // A page was sent; the chip is busy until it ACKs its address again.
+        };
+
+        /**
+         * @brief One ACK poll: a zero-length write. The chip only answers once its write cycle is over.
+         * @return true if it answered.
+         */
+        bool pollWriteComplete ();
 
-        // This will call itself up to twice more before bailing out.
-        // Treat a false return as an error.
-        bool isEEPromWriteReady (ControlByte_t controlByte, uint8_t tryNumber = MAX_ATTEMPTS_AT_SETTLING);
+        /**
+         * @brief Ends a write cycle that is over, without waiting: one ACK poll once the ready time has passed.
+         * Only a cache miss during a write gets here. A page in the write queue is served from there instead.
+         * @return true if the chip can be read now. false while it is still busy; service() finishes the cycle.
+         */
+        bool finishWriteCycle ();
 
         [[nodiscard]] inline absolute_time_t getReadyTime () const {
             return readyTime_;
@@ -146,21 +300,124 @@ class Mcp24Lc32 : public Component {
             readyTime_ = make_timeout_time_ms(eePromWriteSettlingTime_ms);
         }
 
+        /**
+         * @brief The page handled at a given step of a background format. Default: page order.
+         * An override must visit every page exactly once.
+         */
+        virtual EEPromPageId getFormatOrder (const uint8_t step) {return NumberToPageId(step);}
+
+        /**
+         * @brief Whether a page carries a CRC trailer. Those pages are sealed on write, checked when loaded into
+         * the cache, and re-checked on the chip by the background scrub. Default: none.
+         */
+        [[nodiscard]] virtual bool hasPageCrc (const EEPromPageId pageId) const {return false;}
+
+        /**
+         * @brief Persists background format progress. nextStep == MCP_EEPROM_PAGE_COUNT means done.
+         * The default keeps nothing, so an interrupted format starts over.
+         */
+        virtual bool saveFormatProgress (uint8_t nextStep) {return true;}
+
+        virtual void onFormatComplete () {}
+
         [[nodiscard]] ControlByte_t getControlByte () const;
         [[nodiscard]] uint8_t getEePromAddress () const {return eePromAddress_;}
 
+        // These go straight to the chip and bypass the cache.
+        // A read may be any length. A write must stay within one page.
+        bool readFromChip (uint16_t address, uint8_t* buffer, size_t length);
+        bool writeToChip (uint16_t address, const uint8_t* buffer, uint8_t length);
+
 
     private:
 
 
         void setEePromAddress (const uint8_t eePromAddress) {eePromAddress_ = eePromAddress  & 0x07;}
 
+        // Slot state. The page data lives in cacheData_ so that slots are contiguous for bulk reads.
+        struct CachedPage {
+            uint8_t     pageNumber  = 0;
+            bool        valid       = false;
+            bool        dirty       = false;
+            bool        corrupt     = false;    // Loaded with a bad CRC. Cleared by the next write.
+        };
+
+        static constexpr uint8_t getSlotIndex (const uint8_t pageNumber) {
+            return pageNumber % MCP_EEPROM_CACHE_PAGE_COUNT;
+        }
+
+        /**
+         * @brief Makes the slot for pageNumber hold that page, reading the chip on a miss.
+         * A dirty page already in the slot is written back first.
+         * @return The slot, or nullptr if the eviction or the read failed.
+         */
+        CachedPage* loadSlot (uint8_t pageNumber);
+
+        // Reads pages straight into their slots. The slots must be contiguous.
+        bool loadRun (uint8_t firstPage, uint8_t pageCount);
+
+        // Sets the slot's corrupt flag from its CRC, if the page has one.
+        void verifySlot (CachedPage& slot);
+
+        // Re-reads the next CRC page from the chip. A bad page with a good cached copy is marked for rewrite.
+        void scrubNextPage ();
+
+        uint8_t* getSlotData (const CachedPage& slot) {
+            return cacheData_[&slot - cache_.data()];
+        }
+
+        /**
+         * @brief Puts the slot's page on the write queue and marks it clean.
+         * @return false if the queue is full. The slot stays dirty.
+         */
+        bool flushSlot (CachedPage& slot);
+
+        // The entry holds the whole page image, but only offset..offset+length goes to the chip.
+        struct PendingWrite {
+            EepBuffer_t data{};
+            uint8_t     pageNumber  = 0;
+            uint8_t     offset      = 0;
+            uint8_t     length      = MCP_EEPROM_PAGE_SIZE;
+            uint8_t     attempts    = 0;
+        };
+
+        bool enqueueWrite (uint8_t pageNumber, const uint8_t* pageImage,
+                           uint8_t offset = 0, uint8_t length = MCP_EEPROM_PAGE_SIZE);
+        [[nodiscard]] const PendingWrite* findQueuedWrite (uint8_t pageNumber) const;
+        void startWrite ();
+        void completeWrite (bool success);
+
+        void doFormatStep ();
+
         // This is used as a timer for when the eeprom is ready after a write.
         // Initializing it just is a precaution in case it's checked before it should be.
         absolute_time_t readyTime_ = get_absolute_time();
         uint8_t eePromAddress_ = 0;
         ControllerId controllerId_;
 
+        std::array<CachedPage, MCP_EEPROM_CACHE_PAGE_COUNT> cache_{};
+        uint8_t cacheData_[MCP_EEPROM_CACHE_PAGE_COUNT][MCP_EEPROM_PAGE_SIZE]{};
+        PageCacheStats cacheStats_{};
+        uint32_t writeGeneration_ = 0;
+        bool writeBack_ = true;
+        uint32_t flushIntervalMs_ = MCP_EEPROM_FLUSH_INTERVAL_MS;
+        absolute_time_t nextFlushTime_ = make_timeout_time_ms(MCP_EEPROM_FLUSH_INTERVAL_MS);
+
+        std::array<PendingWrite, MCP_EEPROM_WRITE_QUEUE_SIZE> writeQueue_{};
+        uint8_t queueHead_ = 0;     // The entry being written, or next to be.
+        uint8_t queueCount_ = 0;
+        WriteState writeState_ = WriteState::IDLE;
+        absolute_time_t writeDeadline_ = get_absolute_time();
+        WriteCompleteCallback writeCompleteCallback_ = nullptr;
+        void* writeCompleteContext_ = nullptr;
+
+        bool formatting_ = false;
+        uint8_t formatStep_ = 0;
+
+        uint8_t scrubPage_ = 0;
+        uint32_t scrubIntervalMs_ = MCP_EEPROM_SCRUB_INTERVAL_MS;
+        absolute_time_t nextScrubTime_ = make_timeout_time_ms(MCP_EEPROM_SCRUB_INTERVAL_MS);
+
     };
 }
 
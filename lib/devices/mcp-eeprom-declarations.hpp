@@ -12,6 +12,27 @@ namespace CSdevices {
     constexpr uint8_t CONTROL_I2C_DEVICE = 0b101;       // This will combine with the chip select bits: 101xabc
     constexpr uint8_t MCP_EEPROM_PAGE_COUNT = 128;     // 128 pages per eeprom. pages 0-127
     constexpr uint8_t MCP_EEPROM_PAGE_SIZE = 32;       // 32 byte pages
+    constexpr uint8_t MCP_EEPROM_FORMAT_FILL = 0xFF;   // What formatEEProm writes. Same as a factory-fresh part.
+
+    // RAM page cache. 128 slots covers the whole device (4 KB). Fewer slots are direct mapped: page % slot count.
+    constexpr uint8_t MCP_EEPROM_CACHE_PAGE_COUNT = MCP_EEPROM_PAGE_COUNT;
+    static_assert(MCP_EEPROM_CACHE_PAGE_COUNT > 0 && MCP_EEPROM_CACHE_PAGE_COUNT <= MCP_EEPROM_PAGE_COUNT,
+                  "The page cache needs between 1 and MCP_EEPROM_PAGE_COUNT slots");
+    constexpr uint32_t MCP_EEPROM_FLUSH_INTERVAL_MS = 1000;    // Default for flushIfDue.
+
+    // Page writes waiting for the chip. Each entry holds its own copy of the page.
+    constexpr uint8_t MCP_EEPROM_WRITE_QUEUE_SIZE = 16;
+    constexpr uint8_t MCP_EEPROM_WRITE_CYCLE_MS = 5;            // tWC max from the datasheet.
+    constexpr uint8_t MCP_EEPROM_WRITE_CYCLE_TIMEOUT_MS = 20;   // No ACK by now means the write failed.
+
+    // Optional CRC trailer. A page that opts in (Mcp24Lc32::hasPageCrc) keeps its data in the first
+    // MCP_EEPROM_PAGE_PAYLOAD_SIZE bytes; the driver fills in a CRC-16 (big endian) after that on every write.
+    constexpr uint8_t MCP_EEPROM_PAGE_CRC_SIZE = 2;
+    constexpr uint8_t MCP_EEPROM_PAGE_PAYLOAD_SIZE = MCP_EEPROM_PAGE_SIZE - MCP_EEPROM_PAGE_CRC_SIZE;
+    constexpr uint32_t MCP_EEPROM_SCRUB_INTERVAL_MS = 1000;    // One CRC page re-read from the chip per interval.
+
+    // A background format saves its progress every this many pages. Redoing a few pages after a reset is harmless.
+    constexpr uint8_t MCP_EEPROM_FORMAT_PROGRESS_INTERVAL = 8;
 
     // The ControlBits struct basically is the i2cAddress.
     // 0x50 is the base address. The device address is always 7 bits.
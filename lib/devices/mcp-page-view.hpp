@@ -0,0 +1,103 @@
+#pragma once
+#ifndef MCP_PAGE_VIEW_HPP_
+#define MCP_PAGE_VIEW_HPP_
+
+#include <cstdint>
+#include <utility>
+
+#include "mcp-24lc32.hpp"
+#include "mcp-eeprom-declarations.hpp"
+
+namespace CSdevices {
+
+    /**
+     * @brief A typed view of one page. The page id is part of the type, so a view can't point at the wrong page.
+     * PageType is one of the page unions: a data struct overlaid on an EepBuffer_t.
+     * The page is read on first access and the fields are served from the view's copy after that.
+     * The copy is refreshed only when the device's write generation moves on, and that refresh comes from the
+     * page cache. Repeated reads never cost a bus transaction.
+     */
+    template <typename PageType, EEPromPageId PageId>
+    class PageView final {
+
+    public:
+        using DataType = decltype(PageType::data);
+
+        static_assert(sizeof(PageType) == MCP_EEPROM_PAGE_SIZE, "A page view needs a full page union");
+        static_assert(PageId <= EEPromPageId::PAGE_MAXIMUM, "Page id out of range");
+
+        explicit PageView (Mcp24Lc32& eeProm) : eeProm_(eeProm) {}
+
+        [[nodiscard]] static constexpr EEPromPageId getPageId () {return PageId;}
+
+        /**
+         * @brief The page contents. Loaded on first use.
+         * If the read failed, this is whatever could be read (or the defaults). See isValid().
+         */
+        [[nodiscard]] const DataType& get () {
+            load();
+            return page_.data;
+        }
+
+        const DataType* operator-> () {return &get();}
+
+        /**
+         * @return true if the last load read the page successfully (and, for a CRC page, the CRC matched).
+         */
+        [[nodiscard]] bool isValid () {
+            return load();
+        }
+
+        /**
+         * @brief Replaces the whole page.
+         * @return The result of the page write.
+         */
+        bool set (const DataType& data) {
+            page_.data = data;
+            return store();
+        }
+
+        /**
+         * @brief Changes some fields and writes the page back.
+         * @param modifier Called with a mutable reference to the current contents.
+         * @return The result of the page write.
+         */
+        template <typename Modifier>
+        bool update (Modifier&& modifier) {
+            load();
+            std::forward<Modifier>(modifier)(page_.data);
+            return store();
+        }
+
+        /**
+         * @brief Forces the next access to read the page again.
+         */
+        void invalidate () {loaded_ = false;}
+
+    private:
+        bool load () {
+            if (!loaded_ || generation_ != eeProm_.getWriteGeneration()) {
+                valid_ = eeProm_.readPage(PageId, page_);
+                generation_ = eeProm_.getWriteGeneration();
+                loaded_ = true;
+            }
+            return valid_;
+        }
+
+        bool store () {
+            valid_ = eeProm_.writePage(PageId, page_);
+            generation_ = eeProm_.getWriteGeneration();     // Our own write doesn't make the copy stale.
+            loaded_ = valid_;
+            return valid_;
+        }
+
+        Mcp24Lc32& eeProm_;
+        PageType page_{};
+        uint32_t generation_ = 0;
+        bool loaded_ = false;
+        bool valid_ = false;
+    };
+
+}
+
+#endif  // MCP_PAGE_VIEW_HPP_
@@ -0,0 +1,217 @@
+
+#include <algorithm>
+#include <cstring>
+
+#include "crc.hpp"
+#include "logger.hpp"
+#include "mcp-record-log.hpp"
+
+using namespace CScore;
+
+namespace CSdevices {
+
+    RecordLog::RecordLog(Mcp24Lc32 &eeProm, const EEPromPageId firstPage, const uint8_t pageCount,
+                         const uint8_t slotSize) :
+            eeProm_(eeProm),
+            firstPage_(PageIdToNumber(firstPage)),
+            pageCount_(std::min<uint8_t>(pageCount, MCP_EEPROM_PAGE_COUNT - PageIdToNumber(firstPage))),
+            slotSize_(32 == slotSize ? 32 : RECORD_LOG_DEFAULT_SLOT_SIZE),
+            capacity_(static_cast<uint16_t>(pageCount_ * (MCP_EEPROM_PAGE_SIZE / slotSize_))) {
+        setClassName("RecordLog");
+        setLabel("EEPROM Record Log");
+        liveSlots_.fill(NO_SLOT);
+    }
+
+    bool RecordLog::mount() {
+        mounted_ = false;
+        liveSlots_.fill(NO_SLOT);
+        head_ = 0;
+        appendsThisLap_ = 0;
+        nextSequence_ = 1;
+
+        // Every type must be able to hold a slot with room left to append.
+        if (capacity_ <= RECORD_LOG_MAX_TYPES) {
+            logger_.log(LogLevel::Error, getClassName(), __func__, "Range too small for the record log.");
+            return false;
+        }
+
+        // One sequential read brings the range into the cache. The scan below is then all memory.
+        eeProm_.loadPages(NumberToPageId(firstPage_), pageCount_);
+
+        std::array<uint32_t, RECORD_LOG_MAX_TYPES> liveSequences{};
+        uint32_t newestSequence = 0;
+        int16_t newestSlot = NO_SLOT;
+        const auto slotsPerPage = static_cast<uint8_t>(MCP_EEPROM_PAGE_SIZE / slotSize_);
+
+        for (uint8_t page = 0; page < pageCount_; page++) {
+            EepBuffer_t pageBuffer;
+            if (!eeProm_.readBytes(NumberToPageId(firstPage_ + page), pageBuffer)) {
+                return false;
+            }
+
+            for (uint8_t i = 0; i < slotsPerPage; i++) {
+                uint8_t type, length;
+                uint32_t sequence;
+                if (!parseSlot(pageBuffer + i * slotSize_, type, length, sequence)) {
+                    continue;
+                }
+
+                const auto slot = static_cast<int16_t>(page * slotsPerPage + i);
+                if (sequence > liveSequences[type]) {
+                    liveSequences[type] = sequence;
+                    liveSlots_[type] = slot;
+                }
+                if (sequence > newestSequence) {
+                    newestSequence = sequence;
+                    newestSlot = slot;
+                }
+            }
+        }
+
+        if (NO_SLOT != newestSlot) {
+            head_ = static_cast<uint16_t>((newestSlot + 1) % capacity_);
+            nextSequence_ = newestSequence + 1;
+        }
+
+        mounted_ = true;
+        return true;
+    }
+
+    bool RecordLog::append(const uint8_t type, const uint8_t *payload, const uint8_t length) {
+        if (!mounted_ || type >= RECORD_LOG_MAX_TYPES || length > getMaxPayload() ||
+            (nullptr == payload && length > 0)) {
+            return false;
+        }
+
+        // Skip live slots. The type's own live slot is fair game once the new record is written elsewhere,
+        // but it is skipped too so a torn write never loses the only copy.
+        uint16_t tries = 0;
+        while (isLive(head_) && tries < capacity_) {
+            head_ = (head_ + 1) % capacity_;
+            ++tries;
+        }
+        if (tries >= capacity_) {
+            return false;
+        }
+
+        const auto slot = head_;
+        if (!writeSlot(slot, type, payload, length)) {
+            return false;
+        }
+
+        liveSlots_[type] = static_cast<int16_t>(slot);
+        ++nextSequence_;
+        head_ = (head_ + 1) % capacity_;
+
+        // Once per lap, move the live records up to the head so the slots they pin get their turn.
+        if (++appendsThisLap_ >= capacity_ && !compacting_) {
+            compact();
+        }
+
+        return true;
+    }
+
+    bool RecordLog::readLatest(const uint8_t type, uint8_t *payload, uint8_t &length) {
+        if (!mounted_ || type >= RECORD_LOG_MAX_TYPES || NO_SLOT == liveSlots_[type]) {
+            return false;
+        }
+
+        const auto slot = static_cast<uint16_t>(liveSlots_[type]);
+        EepBuffer_t pageBuffer;
+        if (!eeProm_.readBytes(getSlotPage(slot), pageBuffer)) {
+            return false;
+        }
+
+        const auto* slotData = pageBuffer + getSlotOffset(slot);
+        uint8_t storedType;
+        uint32_t sequence;
+        if (!parseSlot(slotData, storedType, length, sequence) || storedType != type) {
+            return false;
+        }
+
+        std::memcpy(payload, slotData + RECORD_LOG_HEADER_SIZE, length);
+        return true;
+    }
+
+    bool RecordLog::compact() {
+        if (!mounted_) {
+            return false;
+        }
+
+        auto retCode = true;
+        compacting_ = true;
+        appendsThisLap_ = 0;
+
+        for (uint8_t type = 0; type < RECORD_LOG_MAX_TYPES; type++) {
+            uint8_t payload[MCP_EEPROM_PAGE_SIZE];
+            uint8_t length = 0;
+            if (NO_SLOT != liveSlots_[type]) {
+                retCode &= readLatest(type, payload, length) && append(type, payload, length);
+            }
+        }
+
+        compacting_ = false;
+        return retCode;
+    }
+
+    uint8_t RecordLog::getLiveCount() const {
+        return static_cast<uint8_t>(std::count_if(liveSlots_.begin(), liveSlots_.end(),
+                                                  [](const int16_t slot) {return NO_SLOT != slot;}));
+    }
+
+    EEPromPageId RecordLog::getSlotPage(const uint16_t slot) const {
+        return NumberToPageId(firstPage_ + (slot * slotSize_) / MCP_EEPROM_PAGE_SIZE);
+    }
+
+    uint8_t RecordLog::getSlotOffset(const uint16_t slot) const {
+        return static_cast<uint8_t>((slot * slotSize_) % MCP_EEPROM_PAGE_SIZE);
+    }
+
+    bool RecordLog::isLive(const uint16_t slot) const {
+        return std::find(liveSlots_.begin(), liveSlots_.end(), static_cast<int16_t>(slot)) != liveSlots_.end();
+    }
+
+    bool RecordLog::parseSlot(const uint8_t *slotData, uint8_t &type, uint8_t &length, uint32_t &sequence) const {
+        const auto crcOffset = slotSize_ - RECORD_LOG_CRC_SIZE;
+        const auto storedCrc = static_cast<uint16_t>((slotData[crcOffset] << 8) | slotData[crcOffset + 1]);
+
+        if (RECORD_LOG_MAGIC != slotData[0] ||
+            slotData[1] >= RECORD_LOG_MAX_TYPES ||
+            slotData[2] > getMaxPayload() ||
+            storedCrc != crc16Ccitt(slotData, crcOffset)) {
+            return false;
+        }
+
+        type = slotData[1];
+        length = slotData[2];
+        sequence = static_cast<uint32_t>(slotData[3]) |
+                   static_cast<uint32_t>(slotData[4]) << 8 |
+                   static_cast<uint32_t>(slotData[5]) << 16 |
+                   static_cast<uint32_t>(slotData[6]) << 24;
+        return 0 != sequence;
+    }
+
+    bool RecordLog::writeSlot(const uint16_t slot, const uint8_t type, const uint8_t *payload, const uint8_t length) {
+        uint8_t slotData[MCP_EEPROM_PAGE_SIZE];
+        std::memset(slotData, 0xFF, slotSize_);
+
+        slotData[0] = RECORD_LOG_MAGIC;
+        slotData[1] = type;
+        slotData[2] = length;
+        slotData[3] = static_cast<uint8_t>(nextSequence_);
+        slotData[4] = static_cast<uint8_t>(nextSequence_ >> 8);
+        slotData[5] = static_cast<uint8_t>(nextSequence_ >> 16);
+        slotData[6] = static_cast<uint8_t>(nextSequence_ >> 24);
+        if (length > 0) {
+            std::memcpy(slotData + RECORD_LOG_HEADER_SIZE, payload, length);
+        }
+
+        const auto crcOffset = slotSize_ - RECORD_LOG_CRC_SIZE;
+        const auto crc = crc16Ccitt(slotData, crcOffset);
+        slotData[crcOffset] = static_cast<uint8_t>(crc >> 8);
+        slotData[crcOffset + 1] = static_cast<uint8_t>(crc);
+
+        return eeProm_.writePartial(getSlotPage(slot), getSlotOffset(slot), slotData, slotSize_);
+    }
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef MCP_RECORD_LOG_HPP_
+#define MCP_RECORD_LOG_HPP_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "component.hpp"
+#include "mcp-24lc32.hpp"
+#include "mcp-eeprom-declarations.hpp"
+
+namespace CSdevices {
+
+    // Record slot layout: magic, type, length, sequence (little endian), payload, 0xFF fill, CRC-16 (big endian).
+    constexpr uint8_t RECORD_LOG_MAGIC = 0xA5;
+    constexpr uint8_t RECORD_LOG_HEADER_SIZE = 7;
+    constexpr uint8_t RECORD_LOG_CRC_SIZE = 2;
+    constexpr uint8_t RECORD_LOG_MAX_TYPES = 16;
+    constexpr uint8_t RECORD_LOG_DEFAULT_SLOT_SIZE = 16;
+
+    /**
+     * @brief An append-only store of small typed records on a page range of a 24LC32.
+     * The range is a ring of fixed-size slots. Every append goes to the next slot, so wear spreads over the whole
+     * range instead of hammering one page, and each append is one partial-page write of a single slot.
+     * Only the newest record of each type is live. The head skips live slots, so a rarely updated type is never
+     * overwritten by a busy one. Once per lap compact() rewrites the live records at the head, which frees their old
+     * slots and keeps wear even.
+     * Each record carries a sequence number and a CRC. mount() finds the newest record of every type in one pass.
+     * A torn write fails its CRC and the previous record of that type is still there.
+     */
+    class RecordLog final : public Component {
+
+    public:
+        /**
+         * @param eeProm The device.
+         * @param firstPage First page of the range.
+         * @param pageCount Pages in the range.
+         * @param slotSize Bytes per record slot: 16 or 32. It divides the page so no record straddles two pages.
+         */
+        RecordLog (Mcp24Lc32& eeProm, EEPromPageId firstPage, uint8_t pageCount,
+                   uint8_t slotSize = RECORD_LOG_DEFAULT_SLOT_SIZE);
+
+        RecordLog (const RecordLog& other) = delete;
+        RecordLog& operator=(const RecordLog& other) = delete;
+        ~RecordLog () override = default;
+
+        /**
+         * @brief Scans the range once and finds the newest record of each type and the append position.
+         * @return true if the range could be read.
+         */
+        bool mount ();
+
+        /**
+         * @brief Appends a record. It becomes the live record for its type.
+         * @return false if the log isn't mounted, the arguments are out of range or the write couldn't be queued.
+         */
+        bool append (uint8_t type, const uint8_t* payload, uint8_t length);
+
+        template <typename RecordType>
+        bool append (const uint8_t type, const RecordType& record) {
+            static_assert(sizeof(RecordType) <= MCP_EEPROM_PAGE_SIZE - RECORD_LOG_HEADER_SIZE - RECORD_LOG_CRC_SIZE,
+                          "Record too big for any slot size");
+            return append(type, reinterpret_cast<const uint8_t*>(&record), sizeof(RecordType));
+        }
+
+        /**
+         * @brief Reads the live record for a type.
+         * @param payload Receives up to getMaxPayload() bytes.
+         * @param length Receives the stored length.
+         * @return false if there is no record of that type.
+         */
+        bool readLatest (uint8_t type, uint8_t* payload, uint8_t& length);
+
+        template <typename RecordType>
+        bool readLatest (const uint8_t type, RecordType& record) {
+            uint8_t buffer[MCP_EEPROM_PAGE_SIZE]{};
+            uint8_t length = 0;
+            const auto retCode = readLatest(type, buffer, length) && sizeof(RecordType) == length;
+            if (retCode) {
+                std::memcpy(&record, buffer, sizeof(RecordType));
+            }
+            return retCode;
+        }
+
+        /**
+         * @brief Rewrites every live record at the head. The old copies become free slots.
+         * append() calls this each time the head completes a lap of the range.
+         * @return true if every live record was rewritten.
+         */
+        bool compact ();
+
+        [[nodiscard]] bool isMounted () const {return mounted_;}
+        [[nodiscard]] uint16_t getCapacity () const {return capacity_;}
+        [[nodiscard]] uint8_t getMaxPayload () const {return slotSize_ - RECORD_LOG_HEADER_SIZE - RECORD_LOG_CRC_SIZE;}
+        [[nodiscard]] uint8_t getLiveCount () const;
+        [[nodiscard]] uint32_t getNextSequence () const {return nextSequence_;}
+
+    private:
+        static constexpr int16_t NO_SLOT = -1;
+
+        [[nodiscard]] EEPromPageId getSlotPage (uint16_t slot) const;
+        [[nodiscard]] uint8_t getSlotOffset (uint16_t slot) const;
+        [[nodiscard]] bool isLive (uint16_t slot) const;
+
+        // Checks magic, length and CRC. Returns the header fields if it's a record.
+        bool parseSlot (const uint8_t* slotData, uint8_t& type, uint8_t& length, uint32_t& sequence) const;
+        bool writeSlot (uint16_t slot, uint8_t type, const uint8_t* payload, uint8_t length);
+
+        Mcp24Lc32& eeProm_;
+        uint8_t firstPage_;
+        uint8_t pageCount_;
+        uint8_t slotSize_;
+        uint16_t capacity_;
+
+        std::array<int16_t, RECORD_LOG_MAX_TYPES> liveSlots_{};
+        uint16_t head_ = 0;             // The next slot to try.
+        uint16_t appendsThisLap_ = 0;
+        uint32_t nextSequence_ = 1;
+        bool mounted_ = false;
+        bool compacting_ = false;
+    };
+
+}
+
+#endif  // MCP_RECORD_LOG_HPP_
@@ -1,11 +1,11 @@
 
-#include <iostream>
-
 #include "dac-declarations.hpp"
 #include "logger.hpp"
 #include "mcp4728.hpp"
 #include "utilities.hpp"
 
+using namespace CScore;
+
 namespace CSdevices {
 
 /**
@@ -16,12 +16,12 @@ namespace CSdevices {
  */
     bool Mcp4728::writeDacInputRegister(const DacChannelIds dacChannelId, uint16_t data) const {
 
-#if defined (LOG_GROUP_DAC)
-        logger_.logMethodEntry(LogLevel::Trace,
-                              getClassName(),
-                              std::string(__func__),
-                              getLabel() + "\n");
-#endif
+        if (logger_.isGroupEnabled(LogGroup::DAC)) {
+            logger_.logMethodEntry(LogLevel::Trace,
+                                  getClassName(),
+                                  std::string(__func__),
+                                  getLabel() + "\n");
+        }
 
         auto retCode = false;
         const auto channel = getDacChannelConfig(dacChannelId);
@@ -59,51 +59,48 @@ namespace CSdevices {
         controlByte.bits.powerDown = static_cast<uint8_t>(channel.getPowerMode());
         controlByte.bits.vref = static_cast<uint8_t>(channel.getVref());
 
-#if defined (LOG_GROUP_TEN)
-        if (data >= 4095) {
-            std::cout << "Error: data is too large for MCP4728: " << data << std::endl;
+        // The control loop calls this every step. Full scale is a legal value, and the logger only queues.
+        if (data > MAX_DAC_COUNTS && logger_.isGroupEnabled(LogGroup::DAC)) {
+            logger_.log(LogLevel::Warn, getLabel() + ": data too large for MCP4728, clamped: " + std::to_string(data));
         }
-#endif
 
-        data = std::min(data, static_cast<uint16_t>(4095)); // 12-bit limit.
+        data = std::min(data, MAX_DAC_COUNTS); // 12-bit limit.
         CScore::localUint16ToNetworkByteOrder(data, &buffer[1]);    // Now the data is in the lower nibble of [1] && buffer[2]
         buffer[1] |= (controlByte.byte & 0xf0);   // Set control byte to live in upper nibble.
         // This leaves the lower nibble untouched.
 
 
-#if defined (LOG_GROUP_DAC)
-
-        logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
-                    "addField.addressByte: " + int_to_hex_0x(addressField.addressByte) + ",\n\t\t\t" +
-                    "addField.bits.unused: " + int_to_hex_0x(addressField.bits.unused) + ",\n\t\t\t"
-                    "addField.bits.deviceCode: " + int_to_hex_0x(addressField.bits.deviceCode) + ",\n\t\t\t" +
-                    "addField.bits.i2cAddress: " + int_to_hex_0x(addressField.bits.i2cAddress));
-
-        logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
-                    "cmd.byte: " + int_to_hex_0x(cmd.byte) + ",\n\t\t\t"
-                    "cmd.bits.command: " + int_to_hex_0x(cmd.bits.command) + ",\n\t\t\t" +
-                    "cmd.bits.channel: " + int_to_hex_0x(cmd.bits.channel) + ",\n\t\t\t" +
-                    "cmd.bits.udac: " + int_to_hex_0x(cmd.bits.udac));
-
-        logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
-                    "ctlByte.byte: " + int_to_hex_0x(controlByte.byte) + ",\n\t\t\t" +
-                    "ctlByte.bits.vref: " + int_to_hex_0x(controlByte.bits.vref) + ",\n\t\t\t" +
-                    "ctlByte.bits.powerDown: " + int_to_hex_0x(controlByte.bits.powerDown) + ",\n\t\t\t" +
-                    "ctlByte.bits.gain: " + int_to_hex_0x(controlByte.bits.gain) + ",\n\t\t\t" +
-                    "ctlByte.bits.dataNibble: "+ int_to_hex_0x(controlByte.bits.dataNibble));
-
-        logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
-                    "writing 12 bits of data:" + int_to_hex_0x(data) + " to the Dac Input Register");
-
-        logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
-                    "i2c_write; addressByte: " +
-                    int_to_hex_0x(addressField.addressByte) +
-                    " buffer[0..2]: " +
-                    int_to_hex_0x(buffer[0]) +
-                    ", " + int_to_hex_0x(buffer[1]) +
-                    ", " + int_to_hex_0x(buffer[2]));
-
-#endif
+        if (logger_.isGroupEnabled(LogGroup::DAC)) {
+            logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
+                        "addField.addressByte: " + int_to_hex_0x(addressField.addressByte) + ",\n\t\t\t" +
+                        "addField.bits.unused: " + int_to_hex_0x(addressField.bits.unused) + ",\n\t\t\t"
+                        "addField.bits.deviceCode: " + int_to_hex_0x(addressField.bits.deviceCode) + ",\n\t\t\t" +
+                        "addField.bits.i2cAddress: " + int_to_hex_0x(addressField.bits.i2cAddress));
+
+            logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
+                        "cmd.byte: " + int_to_hex_0x(cmd.byte) + ",\n\t\t\t"
+                        "cmd.bits.command: " + int_to_hex_0x(cmd.bits.command) + ",\n\t\t\t" +
+                        "cmd.bits.channel: " + int_to_hex_0x(cmd.bits.channel) + ",\n\t\t\t" +
+                        "cmd.bits.udac: " + int_to_hex_0x(cmd.bits.udac));
+
+            logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
+                        "ctlByte.byte: " + int_to_hex_0x(controlByte.byte) + ",\n\t\t\t" +
+                        "ctlByte.bits.vref: " + int_to_hex_0x(controlByte.bits.vref) + ",\n\t\t\t" +
+                        "ctlByte.bits.powerDown: " + int_to_hex_0x(controlByte.bits.powerDown) + ",\n\t\t\t" +
+                        "ctlByte.bits.gain: " + int_to_hex_0x(controlByte.bits.gain) + ",\n\t\t\t" +
+                        "ctlByte.bits.dataNibble: "+ int_to_hex_0x(controlByte.bits.dataNibble));
+
+            logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
+                        "writing 12 bits of data:" + int_to_hex_0x(data) + " to the Dac Input Register");
+
+            logger_.log(LogLevel::Info, getLabel() + "\n\t\t" +
+                        "i2c_write; addressByte: " +
+                        int_to_hex_0x(addressField.addressByte) +
+                        " buffer[0..2]: " +
+                        int_to_hex_0x(buffer[0]) +
+                        ", " + int_to_hex_0x(buffer[1]) +
+                        ", " + int_to_hex_0x(buffer[2]));
+        }
 //      This removes the circular dependency and forward reference!
         const auto i2cReturn = CsI2C::writeBuffer(  getControllerId(),  // Calling the static method!
                                                        addressField.addressByte,
@@ -121,13 +118,12 @@ namespace CSdevices {
             */
 
         }
-#if defined (LOG_GROUP_DAC)
-
-        logger_.logMethodExit(LogLevel::Trace,
-                              getClassName(),
-                              std::string(__func__),
-                              getLabel());
-#endif
+        if (logger_.isGroupEnabled(LogGroup::DAC)) {
+            logger_.logMethodExit(LogLevel::Trace,
+                                  getClassName(),
+                                  std::string(__func__),
+                                  getLabel());
+        }
 
         return retCode;
     }
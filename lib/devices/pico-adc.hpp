@@ -50,6 +50,16 @@ namespace CSdevices {
          */
         static bool isAdcReady() {return (adc_hw->cs & ADC_CS_READY_BITS) != 0;}
 
+        /**
+         * @brief One conversion, start to finish. Blocks for the conversion time, about 2 microseconds.
+         * The processed value is cached by the subclass, eg. getTemperature().
+         * @return The raw counts.
+         */
+        uint16_t convert () {
+            startConversion();
+            return readValue();
+        }
+
     protected:
         [[nodiscard]] PicoAin getAinSelect() const {return ainSelect_;};
 
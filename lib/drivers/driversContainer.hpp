@@ -2,6 +2,7 @@
 #ifndef DRIVERS_CONTAINER_HPP_
 
 #include "eeprom0.hpp"
+#include "fault-log-sink.hpp"
 
 namespace CSdrivers {
 
@@ -10,6 +11,11 @@ namespace CSdrivers {
         return eeProm0_;
     }
 
+    inline FaultLogSink& getFaultLogSink () {
+        static FaultLogSink faultLogSink_{getEEProm0()};
+        return faultLogSink_;
+    }
+
     inline CSdevices::Mcp24Lc32& getEEProm (const CSdevices::EEPromId eepromId) {
         switch (eepromId) {
             default:
@@ -4,8 +4,10 @@
 #ifndef EEPROM0_PAGE_DECLARATIONS_HPP_
 #define EEPROM0_PAGE_DECLARATIONS_HPP_
 
+#include <cstddef>
 #include <cstdint>
 
+#include "crc.hpp"
 #include "mcp-eeprom-declarations.hpp"
 #include "product-info.hpp"
 
@@ -26,16 +28,19 @@ namespace CSdrivers {
 
     //*************************************************************************************************************
 
+    // The identity pages (company, product info) carry a CRC trailer, so their structs end at
+    // MCP_EEPROM_PAGE_PAYLOAD_SIZE. See hasEEProm0PageCrc.
+
     //----------PAGE_000---------------
     constexpr auto COMPANY_NAME_PAGE = ee::EEPromPageId::PAGE_000;
 
     struct PageCompany {
         char companyName [sizeof(COMPANY_NAME)] = COMPANY_NAME;  // Includes null byte
-        uint8_t unused [ee::EEP_PAGE_SIZE >= sizeof(companyName)
-                            ? ee::EEP_PAGE_SIZE - sizeof(companyName)
+        uint8_t unused [ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE >= sizeof(companyName)
+                            ? ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE - sizeof(companyName)
                             : 0]{};  // Expansion area
     };
-    static_assert(sizeof(PageCompany) <= ee::EEP_PAGE_SIZE, "EeProm0PageCompany declaration too big!!");
+    static_assert(sizeof(PageCompany) <= ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE, "EeProm0PageCompany declaration too big!!");
 
     union PageCompanyBuffer {
         PageCompany data{};
@@ -49,11 +54,11 @@ namespace CSdrivers {
 
     struct PageProductInfo1 {
         char productName [sizeof(PRODUCT_NAME)] = PRODUCT_NAME;  // Includes null byte
-        uint8_t unused [ee::EEP_PAGE_SIZE >= sizeof(productName)
-                            ? ee::EEP_PAGE_SIZE - sizeof(productName)
+        uint8_t unused [ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE >= sizeof(productName)
+                            ? ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE - sizeof(productName)
                             : 0]{};  // Expansion area
     };
-    static_assert(sizeof(PageProductInfo1) <= ee::EEP_PAGE_SIZE, "EeProm0PageProductInfo1 declaration too big!!");
+    static_assert(sizeof(PageProductInfo1) <= ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE, "EeProm0PageProductInfo1 declaration too big!!");
 
     union PageProductInfo1Buffer {
         PageProductInfo1 data{};
@@ -71,11 +76,11 @@ namespace CSdrivers {
     struct PageProductInfo2 {
         char partNumber [sizeof("Part#00000")] = "Part#00000";
         char serialNumber [sizeof("Serial#000000000")] = "Serial#000000000";
-        uint8_t unused [ee::EEP_PAGE_SIZE >= (sizeof(partNumber) + sizeof(serialNumber))
-                        ? ee::EEP_PAGE_SIZE - (sizeof(partNumber) + sizeof(serialNumber))
+        uint8_t unused [ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE >= (sizeof(partNumber) + sizeof(serialNumber))
+                        ? ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE - (sizeof(partNumber) + sizeof(serialNumber))
                         : 0]{};  // Expansion area
     };
-    static_assert(sizeof(PageProductInfo2) <= ee::EEP_PAGE_SIZE, "EeProm0PageProductInfo2 declaration too big!!");
+    static_assert(sizeof(PageProductInfo2) <= ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE, "EeProm0PageProductInfo2 declaration too big!!");
 
     union PageProductInfo2Buffer {
         PageProductInfo2 data{};
@@ -92,11 +97,11 @@ namespace CSdrivers {
         uint8_t majorVersion = 0;
         uint8_t minorVersion = 0;
         uint16_t buildNumber = 0;
-        uint8_t unused [ee::EEP_PAGE_SIZE >= (sizeof(majorVersion) + sizeof(minorVersion) + sizeof(buildNumber))
-                        ? ee::EEP_PAGE_SIZE - (sizeof(majorVersion) + sizeof(minorVersion) + sizeof(buildNumber))
+        uint8_t unused [ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE >= (sizeof(majorVersion) + sizeof(minorVersion) + sizeof(buildNumber))
+                        ? ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE - (sizeof(majorVersion) + sizeof(minorVersion) + sizeof(buildNumber))
                         : 0]{};  // Expansion area
     };
-    static_assert(sizeof(PageProductInfo3) <= ee::EEP_PAGE_SIZE, "EeProm0PageProductInfo3 declaration too big!!");
+    static_assert(sizeof(PageProductInfo3) <= ee::MCP_EEPROM_PAGE_PAYLOAD_SIZE, "EeProm0PageProductInfo3 declaration too big!!");
 
     union PageProductInfo3Buffer {
         PageProductInfo3 data{};
@@ -193,9 +198,118 @@ namespace CSdrivers {
     constexpr auto HV_CONTROL_DATA_PAGE_2 = ee::EEPromPageId::PAGE_039;
 
 
+    /// @brief Identifies the power supply that owns a pair of control data pages.
+    enum class PowerSupplyId : uint8_t {
+        G1 = 0,
+        G2,
+        G3,
+        HEATER,
+        HV,
+        NOT_A_SUPPLY
+    };
+    constexpr uint8_t POWER_SUPPLY_COUNT = static_cast<uint8_t>(PowerSupplyId::NOT_A_SUPPLY);
+
+    /// @brief Both control data pages for one power supply, as they are laid out in storage.
+    struct ControlData {
+        ControlDataPage1 page1{};
+        ControlDataPage2 page2{};
+    };
+
+    constexpr ee::EEPromPageId getControlDataPage1Id (const PowerSupplyId psId) {
+        switch (psId) {
+            case PowerSupplyId::G1:         return GRID1_CONTROL_DATA_PAGE_1;
+            case PowerSupplyId::G2:         return GRID2_CONTROL_DATA_PAGE_1;
+            case PowerSupplyId::G3:         return GRID3_CONTROL_DATA_PAGE_1;
+            case PowerSupplyId::HEATER:     return HEATER_CONTROL_DATA_PAGE_1;
+            default:
+            case PowerSupplyId::HV:         return HV_CONTROL_DATA_PAGE_1;
+        }
+    }
+
+    constexpr ee::EEPromPageId getControlDataPage2Id (const PowerSupplyId psId) {
+        switch (psId) {
+            case PowerSupplyId::G1:         return GRID1_CONTROL_DATA_PAGE_2;
+            case PowerSupplyId::G2:         return GRID2_CONTROL_DATA_PAGE_2;
+            case PowerSupplyId::G3:         return GRID3_CONTROL_DATA_PAGE_2;
+            case PowerSupplyId::HEATER:     return HEATER_CONTROL_DATA_PAGE_2;
+            default:
+            case PowerSupplyId::HV:         return HV_CONTROL_DATA_PAGE_2;
+        }
+    }
+
+
+    //----------Page layouts---------------
+    // Maps each page with a fixed layout to its page union, for EeProm0::view. Pages without one are left undefined,
+    // so asking for a view of them doesn't compile.
+    template <ee::EEPromPageId PageId>
+    struct EEProm0PageLayout;
+
+    template <> struct EEProm0PageLayout<COMPANY_NAME_PAGE>             {using Type = PageCompany_t;};
+    template <> struct EEProm0PageLayout<PRODUCT_INFO_1>                {using Type = PageProductInfo1_t;};
+    template <> struct EEProm0PageLayout<PRODUCT_INFO_2>                {using Type = PageProductInfo2_t;};
+    template <> struct EEProm0PageLayout<PRODUCT_INFO_3>                {using Type = PageProductInfo3_t;};
+    template <> struct EEProm0PageLayout<GRID1_CONTROL_DATA_PAGE_1>     {using Type = PSControlDataPage1_t;};
+    template <> struct EEProm0PageLayout<GRID1_CONTROL_DATA_PAGE_2>     {using Type = PSControlDataPage2_t;};
+    template <> struct EEProm0PageLayout<GRID2_CONTROL_DATA_PAGE_1>     {using Type = PSControlDataPage1_t;};
+    template <> struct EEProm0PageLayout<GRID2_CONTROL_DATA_PAGE_2>     {using Type = PSControlDataPage2_t;};
+    template <> struct EEProm0PageLayout<GRID3_CONTROL_DATA_PAGE_1>     {using Type = PSControlDataPage1_t;};
+    template <> struct EEProm0PageLayout<GRID3_CONTROL_DATA_PAGE_2>     {using Type = PSControlDataPage2_t;};
+    template <> struct EEProm0PageLayout<HEATER_CONTROL_DATA_PAGE_1>    {using Type = PSControlDataPage1_t;};
+    template <> struct EEProm0PageLayout<HEATER_CONTROL_DATA_PAGE_2>    {using Type = PSControlDataPage2_t;};
+    template <> struct EEProm0PageLayout<HV_CONTROL_DATA_PAGE_1>        {using Type = PSControlDataPage1_t;};
+    template <> struct EEProm0PageLayout<HV_CONTROL_DATA_PAGE_2>        {using Type = PSControlDataPage2_t;};
+
+    template <ee::EEPromPageId PageId>
+    using EEProm0PageType = typename EEProm0PageLayout<PageId>::Type;
+
+
+    //----------PAGE_064 - PAGE_111---------------
+    // Record log. Frequently updated values live here as appended records instead of fixed pages.
+    constexpr auto RECORD_LOG_FIRST_PAGE = ee::EEPromPageId::PAGE_064;
+    constexpr uint8_t RECORD_LOG_PAGE_COUNT = 48;      // 48 slots of 32 bytes.
+    constexpr uint8_t RECORD_LOG_SLOT_SIZE = 32;       // 23 payload bytes. A telemetry set needs more than 7.
+
+    /// @brief Record types in the record log. Each type keeps only its newest record.
+    enum class LogRecordType : uint8_t {
+        RUNTIME_HOURS = 0,
+        FAULT_EVENT,
+        SETPOINT_G1,        // One per supply, in PowerSupplyId order.
+        SETPOINT_G2,
+        SETPOINT_G3,
+        SETPOINT_HEATER,
+        SETPOINT_HV,
+        LOG_GROUP_MASK,     // Logger group mask, low LOG_GROUP_MASK_RECORD_SIZE bytes, little endian.
+        POST_MORTEM,        // Why the previous run ended. See POST_MORTEM_RECORD_SIZE.
+        TELEMETRY_SET_0,    // One per named telemetry set slot. See TELEMETRY_SET_RECORD_SIZE.
+        TELEMETRY_SET_1,
+        TELEMETRY_SET_2,
+        TELEMETRY_SET_3
+    };
+    constexpr uint8_t LOG_GROUP_MASK_RECORD_SIZE = 7;  // Enough for every log group.
+    constexpr uint8_t FAULT_EVENT_RECORD_SIZE = 7;     // Level (1), uptime seconds (4), text CRC-16 (2). Little endian.
+    constexpr uint8_t POST_MORTEM_RECORD_SIZE = 7;     // Cause (1), fault pc (4), uptime minutes (2). Little endian.
+    constexpr uint8_t TELEMETRY_SET_RECORD_COUNT = 4;
+    constexpr uint8_t TELEMETRY_SET_RECORD_NAME_SIZE = 11;
+    // Mask (4, little endian), then the name without its terminator. A shorter name makes a shorter record.
+    constexpr uint8_t TELEMETRY_SET_RECORD_SIZE = 4 + TELEMETRY_SET_RECORD_NAME_SIZE;
+
+    constexpr uint8_t LogRecordTypeToNumber (const LogRecordType type) {
+        return static_cast<uint8_t>(type);
+    }
+
+    constexpr LogRecordType getSetpointRecordType (const PowerSupplyId psId) {
+        return static_cast<LogRecordType>(LogRecordTypeToNumber(LogRecordType::SETPOINT_G1) +
+                                          static_cast<uint8_t>(psId));
+    }
+
+    constexpr LogRecordType getTelemetrySetRecordType (const uint8_t slot) {
+        return static_cast<LogRecordType>(LogRecordTypeToNumber(LogRecordType::TELEMETRY_SET_0) + slot);
+    }
+
+
     //----------PAGE_127---------------
-    // This page is used to determine if the block has been written to by us.
-    // It's a page of random values, however, we've added a signature to the beginning seven bytes.
+    // This page is used to determine if the block has been written to by us, and with which layout.
+    // The first seven bytes are a fixed signature. The next four are the layout hash (EEPROM0_LAYOUT_HASH).
     constexpr auto SIGNATURE_PAGE = ee::EEPromPageId::PAGE_127;
 
     constexpr auto SIGNATURE_LENGTH = 1+5+1+4; // just to make things obvious
@@ -204,14 +318,20 @@ namespace CSdrivers {
                                                 0x44 - 0x04, 0x69 - 0x04, 0x61 - 0x04, 0x6e - 0x04, 0x65 - 0x04,
                                                 0x00,
                                                 0x00, 0x00, 0x00, 0x00};
-    struct PageSignature { // 1 byte 00, 5 'random' bytes, 1 byte 00, 4 bytes packed date
+    // A background format in progress is recorded right after the signature. Older pages have 0 there: complete.
+    constexpr uint8_t FORMAT_STATE_COMPLETE = 0x00;
+    constexpr uint8_t FORMAT_STATE_IN_PROGRESS = 0xA5;
+
+    struct PageSignature { // 1 byte 00, 5 'random' bytes, 1 byte 00, 4 bytes layout hash
         uint8_t signature [SIGNATURE_LENGTH];
-        uint8_t unused [ee::EEP_PAGE_SIZE >= sizeof(signature)
-                        ? ee::EEP_PAGE_SIZE - sizeof(signature)
+        uint8_t formatState = FORMAT_STATE_COMPLETE;
+        uint8_t formatNextStep = 0;     // Step in the format order to resume from.
+        uint8_t unused [ee::EEP_PAGE_SIZE >= sizeof(signature) + 2
+                        ? ee::EEP_PAGE_SIZE - (sizeof(signature) + 2)
                         : 0]{};  // Expansion area
     };
     static_assert(sizeof(PageSignature) <= ee::EEP_PAGE_SIZE, "EeProm0PageSignature declaration too big!!");
-    constexpr uint8_t SIGNATURE_BUILD_DATE_OFFSET = 0x07; // location of the packed build date
+    constexpr uint8_t SIGNATURE_LAYOUT_HASH_OFFSET = 0x07; // location of the layout hash
     union PageSignatureBuffer {
         PageSignature data{};
         ee::EepBuffer_t   buffer; // Initializer is necessary or struct is immediately destroyed.
@@ -219,6 +339,68 @@ namespace CSdrivers {
 
     using PageSignature_t = PageSignatureBuffer;
 
+    template <> struct EEProm0PageLayout<SIGNATURE_PAGE>                {using Type = PageSignature_t;};
+
+
+    //----------Layout hash---------------
+    // The signature used to carry the build date, so every new build reformatted the chip. Now it carries a hash of
+    // the layout: where each page is, how big its struct is, and where the fields sit. It only changes when the
+    // layout does. The compiler can't see field types or meanings, so bump EEPROM0_LAYOUT_VERSION for a change that
+    // keeps every size and offset but alters what the bytes mean.
+    constexpr uint32_t EEPROM0_LAYOUT_VERSION = 1;
+
+    // Pages with a CRC trailer. Part of the layout hash, so changing the set migrates the device.
+    constexpr bool hasEEProm0PageCrc (const ee::EEPromPageId pageId) {
+        return COMPANY_NAME_PAGE == pageId || PRODUCT_INFO_1 == pageId ||
+               PRODUCT_INFO_2 == pageId || PRODUCT_INFO_3 == pageId;
+    }
+
+    constexpr uint32_t computeEEProm0LayoutHash () {
+        using CScore::fnv1a32Append;
+        auto hash = fnv1a32Append(CScore::FNV1A32_OFFSET_BASIS, EEPROM0_LAYOUT_VERSION);
+
+        hash = fnv1a32Append(hash, ee::PageIdToNumber(COMPANY_NAME_PAGE));
+        hash = fnv1a32Append(hash, sizeof(PageCompany));
+        hash = fnv1a32Append(hash, ee::PageIdToNumber(PRODUCT_INFO_1));
+        hash = fnv1a32Append(hash, sizeof(PageProductInfo1));
+        hash = fnv1a32Append(hash, ee::PageIdToNumber(PRODUCT_INFO_2));
+        hash = fnv1a32Append(hash, sizeof(PageProductInfo2));
+        hash = fnv1a32Append(hash, offsetof(PageProductInfo2, serialNumber));
+        hash = fnv1a32Append(hash, ee::PageIdToNumber(PRODUCT_INFO_3));
+        hash = fnv1a32Append(hash, sizeof(PageProductInfo3));
+        hash = fnv1a32Append(hash, offsetof(PageProductInfo3, buildNumber));
+
+        for (uint8_t ps = 0; ps < POWER_SUPPLY_COUNT; ps++) {
+            hash = fnv1a32Append(hash, ee::PageIdToNumber(getControlDataPage1Id(static_cast<PowerSupplyId>(ps))));
+            hash = fnv1a32Append(hash, ee::PageIdToNumber(getControlDataPage2Id(static_cast<PowerSupplyId>(ps))));
+        }
+        hash = fnv1a32Append(hash, sizeof(ControlDataPage1));
+        hash = fnv1a32Append(hash, offsetof(ControlDataPage1, crcMVoltageSlope));
+        hash = fnv1a32Append(hash, offsetof(ControlDataPage1, vwcMVoltageSlope));
+        hash = fnv1a32Append(hash, sizeof(ControlDataPage2));
+        hash = fnv1a32Append(hash, offsetof(ControlDataPage2, vwcVConversionCoeff));
+        hash = fnv1a32Append(hash, offsetof(ControlDataPage2, pdcKpValue));
+        hash = fnv1a32Append(hash, offsetof(ControlDataPage2, pdcCollectionWindowSize));
+
+        hash = fnv1a32Append(hash, ee::PageIdToNumber(RECORD_LOG_FIRST_PAGE));
+        hash = fnv1a32Append(hash, RECORD_LOG_PAGE_COUNT);
+        hash = fnv1a32Append(hash, RECORD_LOG_SLOT_SIZE);
+
+        hash = fnv1a32Append(hash, ee::PageIdToNumber(SIGNATURE_PAGE));
+        hash = fnv1a32Append(hash, SIGNATURE_LAYOUT_HASH_OFFSET);
+
+        hash = fnv1a32Append(hash, ee::MCP_EEPROM_PAGE_CRC_SIZE);
+        for (uint8_t page = ee::MIN_PAGE_ID; page <= ee::MAX_PAGE_ID; page++) {
+            if (hasEEProm0PageCrc(ee::NumberToPageId(page))) {
+                hash = fnv1a32Append(hash, page);
+            }
+        }
+
+        return hash;
+    }
+
+    constexpr uint32_t EEPROM0_LAYOUT_HASH = computeEEProm0LayoutHash();
+
 
     //*************************************************************************************************************
 
@@ -1,5 +1,7 @@
 
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 
 #include "eeprom0.hpp"
@@ -8,45 +10,144 @@
 #include "mcp-24lc32.hpp"
 #include "utilities.hpp"
 
+using namespace CScore;
+
 namespace CSdrivers {
 
+    namespace {
+        // Background format order. Pages read at boot go first, then the record log, then everything else.
+        // The signature page goes last: writing it complete is what ends the format.
+        constexpr std::array<uint8_t, ee::MCP_EEPROM_PAGE_COUNT> makeFormatOrder () {
+            std::array<uint8_t, ee::MCP_EEPROM_PAGE_COUNT> order{};
+            std::array<bool, ee::MCP_EEPROM_PAGE_COUNT> placed{};
+            uint8_t step = 0;
+
+            auto place = [&](const uint8_t page) {
+                if (!placed[page]) {
+                    placed[page] = true;
+                    order[step++] = page;
+                }
+            };
+
+            place(ee::PageIdToNumber(COMPANY_NAME_PAGE));
+            place(ee::PageIdToNumber(PRODUCT_INFO_1));
+            place(ee::PageIdToNumber(PRODUCT_INFO_2));
+            place(ee::PageIdToNumber(PRODUCT_INFO_3));
+            for (uint8_t ps = 0; ps < POWER_SUPPLY_COUNT; ps++) {
+                place(ee::PageIdToNumber(getControlDataPage1Id(static_cast<PowerSupplyId>(ps))));
+                place(ee::PageIdToNumber(getControlDataPage2Id(static_cast<PowerSupplyId>(ps))));
+            }
+            for (uint8_t i = 0; i < RECORD_LOG_PAGE_COUNT; i++) {
+                place(ee::PageIdToNumber(RECORD_LOG_FIRST_PAGE) + i);
+            }
+            placed[ee::PageIdToNumber(SIGNATURE_PAGE)] = true;     // Hold it back for the end.
+            for (uint8_t page = 0; page < ee::MCP_EEPROM_PAGE_COUNT; page++) {
+                place(page);
+            }
+            order[step] = ee::PageIdToNumber(SIGNATURE_PAGE);
+
+            return order;
+        }
+
+        constexpr auto FORMAT_ORDER = makeFormatOrder();
+        static_assert(FORMAT_ORDER[ee::MCP_EEPROM_PAGE_COUNT - 1] == ee::PageIdToNumber(SIGNATURE_PAGE),
+                      "The signature page must be formatted last");
+    }
+
     bool EeProm0::init() {
 
         auto retCode = Mcp24Lc32::init(); // Let the base classes have a chance to initialize.
 
-        if (!checkSignature()) {    // This means we need to format and initialize the block.
-            formatEEProm();
-            retCode = Mcp24Lc32::initializeEEProm();
+        // One sequential read of the whole device. The signature check and every config read after it are cache hits.
+        loadAll();
+
+        if (PageSignature_t signaturePage{};
+            readBytes(SIGNATURE_PAGE, signaturePage.buffer) && isSignatureCurrent(signaturePage)) {
+            if (FORMAT_STATE_IN_PROGRESS == signaturePage.data.formatState) {
+                startBackgroundFormat(signaturePage.data.formatNextStep);   // Interrupted last time. Pick it up.
+            }
+        } else {
+            // New part, or a new layout. Record that a format is under way before touching anything else,
+            // then let the main loop do it a page at a time.
+            retCode &= saveFormatProgress(0);
+            startBackgroundFormat(0);
+        }
+
+        // The log range may still be old content. onFormatComplete mounts it in that case.
+        if (!isFormatting()) {
+            retCode &= recordLog_.mount();
         }
 
         return retCode;
     }
 
+    ee::EEPromPageId EeProm0::getFormatOrder(const uint8_t step) {
+        return ee::NumberToPageId(FORMAT_ORDER[std::min<uint8_t>(step, ee::MCP_EEPROM_PAGE_COUNT - 1)]);
+    }
+
+    bool EeProm0::saveFormatProgress(const uint8_t nextStep) {
+        PageSignature_t signaturePage{};
+        computeSignature(signaturePage.data.signature);
+        signaturePage.data.formatState = nextStep >= ee::MCP_EEPROM_PAGE_COUNT
+                                            ? FORMAT_STATE_COMPLETE
+                                            : FORMAT_STATE_IN_PROGRESS;
+        signaturePage.data.formatNextStep = nextStep;
+
+        // Queue it now so it lands behind the pages it vouches for.
+        return writePage(SIGNATURE_PAGE, signaturePage) && flush();
+    }
+
+    void EeProm0::onFormatComplete() {
+        recordLog_.mount();
+        if (nullptr != formatCompleteCallback_) {
+            formatCompleteCallback_(formatCompleteContext_);
+        }
+    }
+
+    bool EeProm0::isSignatureCurrent(const PageSignature_t &signaturePage) {
+        PageSignature pageSignature;
+        computeSignature(pageSignature.signature);  // Get the correct signature to compare against.
+        return 0 == memcmp(signaturePage.buffer, pageSignature.signature, sizeof(pageSignature.signature));
+    }
+
     void EeProm0::computeSignature(uint8_t *signature) { // assumes that signature points at an array large enough.
-        const CScore::PackedDateTime_t dt = CScore::PackedDateTime::getPackedBuildDate();
-        CScore::UInt32ToBytes dateBytes;
-        dateBytes.data = dt;
+        constexpr auto layoutHash = EEPROM0_LAYOUT_HASH;
         memcpy(signature, SIGNATURE_DEFAULT, sizeof(SIGNATURE_DEFAULT));    // copy in the const data
-        memcpy(signature + SIGNATURE_BUILD_DATE_OFFSET,
-                dateBytes.bytes,
-                sizeof(dateBytes.bytes));
+        for (uint8_t i = 0; i < sizeof(layoutHash); i++) {                  // little endian, like the old build date
+            signature[SIGNATURE_LAYOUT_HASH_OFFSET + i] = static_cast<uint8_t>(layoutHash >> (8 * i));
+        }
     }
 
     bool EeProm0::checkSignature() {
         bool retCode = false;
 
-
         if (PageSignature_t signaturePage{};
             readBytes(SIGNATURE_PAGE, signaturePage.buffer)) {
-                PageSignature pageSignature;
-                computeSignature(pageSignature.signature);  // Get the correct signature to compare against.
-                retCode = (memcmp(signaturePage.buffer, pageSignature.signature, sizeof(pageSignature.signature)) == 0);
+                retCode = isSignatureCurrent(signaturePage) &&
+                          FORMAT_STATE_COMPLETE == signaturePage.data.formatState;
             }
 
-
         return retCode;
     }
 
+    bool EeProm0::hasPageInitializer(const CSdevices::EEPromPageId pageId) {
+        switch (pageId) {
+            case COMPANY_NAME_PAGE:
+            case PRODUCT_INFO_1:
+            case PRODUCT_INFO_2:
+            case PRODUCT_INFO_3:
+            case SIGNATURE_PAGE:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool EeProm0::formatPage(const CSdevices::EEPromPageId pageId, CSdevices::EepBuffer_t pageBuffer) {
+        // initializePage is about to write the real content. Filling it first would just be an extra write.
+        return hasPageInitializer(pageId) ? true : Mcp24Lc32::formatPage(pageId, pageBuffer);
+    }
+
     bool EeProm0::initializePage(const CSdevices::EEPromPageId pageId) {
         auto retValue = false;
 
@@ -205,6 +306,31 @@ namespace CSdrivers {
         return retValue;
     }
 
+    bool EeProm0::getControlDataFromStorage(const PowerSupplyId psId, ControlData &controlData) {
+        // During a background format, a page not reached yet still holds the old layout.
+        if (PowerSupplyId::NOT_A_SUPPLY == psId ||
+            !isPageFormatted(getControlDataPage1Id(psId)) ||
+            !isPageFormatted(getControlDataPage2Id(psId))) {
+            return false;
+        }
+
+        // Through the held views: calibration and the control loop both ask, and only the first ask reads.
+        switch (psId) {
+            case PowerSupplyId::G1:
+                return readControlData<GRID1_CONTROL_DATA_PAGE_1, GRID1_CONTROL_DATA_PAGE_2>(controlData);
+            case PowerSupplyId::G2:
+                return readControlData<GRID2_CONTROL_DATA_PAGE_1, GRID2_CONTROL_DATA_PAGE_2>(controlData);
+            case PowerSupplyId::G3:
+                return readControlData<GRID3_CONTROL_DATA_PAGE_1, GRID3_CONTROL_DATA_PAGE_2>(controlData);
+            case PowerSupplyId::HEATER:
+                return readControlData<HEATER_CONTROL_DATA_PAGE_1, HEATER_CONTROL_DATA_PAGE_2>(controlData);
+            case PowerSupplyId::HV:
+                return readControlData<HV_CONTROL_DATA_PAGE_1, HV_CONTROL_DATA_PAGE_2>(controlData);
+            default:
+                return false;
+        }
+    }
+
     /*
     CSfactory::ControlData EeProm0::getControlDataFromStorage(  const ControlDataPage1 &controlDataPage1,
                                                                 const ControlDataPage2 &controlDataPage2) {
@@ -230,69 +356,6 @@ namespace CSdrivers {
     }
     */
 
-    /*
-    CSfactory::ControlData EeProm0::getControlDataFromStorage(CSpowersupply::PowerSupplyID psId) {
-            PSControlDataPage1_t page1;
-            PSControlDataPage2_t page2;
-            CSfactory::ControlData controlData;
-            EeProm0& eeProm0 = getEEProm0();
-            bool result = false;
-
-            switch (normalizeID(psId)) {
-                default:
-                    // just return the initialized controlData.
-                    break;
-                case CSpowersupply::NORMALIZED_G1:
-                    result =  eeProm0.getG1ControlDataPage1(page1);
-                    result &= eeProm0.getG1ControlDataPage2(page2);
-
-                    if (result) {
-                        controlData = getControlDataFromStorage(page1.data, page2.data);
-                    }
-                    break;
-
-                case CSpowersupply::NORMALIZED_G2:
-                    result =  eeProm0.getG2ControlDataPage1(page1);
-                    result &= eeProm0.getG2ControlDataPage2(page2);
-
-                    if (result) {
-                        controlData = getControlDataFromStorage(page1.data, page2.data);
-                    }
-                    break;
-
-                case CSpowersupply::NORMALIZED_G3:
-                    result =  eeProm0.getG3ControlDataPage1(page1);
-                    result &= eeProm0.getG3ControlDataPage2(page2);
-
-                    if (result) {
-                        controlData = getControlDataFromStorage(page1.data, page2.data);
-                    }
-                    break;
-
-                case CSpowersupply::NORMALIZED_HEATER:
-                    result =  eeProm0.getHeaterControlDataPage1(page1);
-                    result &= eeProm0.getHeaterControlDataPage2(page2);
-
-                    if (result) {
-                        controlData = getControlDataFromStorage(page1.data, page2.data);
-                    }
-                    break;
-
-                case CSpowersupply::NORMALIZED_HIGHVOLTAGE:
-                    result =  eeProm0.getHVControlDataPage1(page1);
-                    result &= eeProm0.getHVControlDataPage2(page2);
-
-                    if (result) {
-                        controlData = getControlDataFromStorage(page1.data, page2.data);
-                    }
-                    break;
-            }
-
-            return controlData;
-
-    }
-    */
-
     /*
     void EeProm0::setControlDataInStorage(CSpowersupply::PowerSupplyID psId,
                                                 const CSfactory::ControlData &controlData) {
@@ -367,88 +430,100 @@ namespace CSdrivers {
     }
     */
 
-    // ReSharper disable once CppMemberFunctionMayBeStatic
-    void EeProm0::logPageInitError(const CSdevices::EEPromPageId pageId) {
-
-#if defined (LOG_GROUP_TWO)
-
-        switch (pageId) {
-            case PageId::PAGE_000:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_COMPANY_NAME.");
-                break;
-
-            case PageId::PAGE_001:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_PRODUCT_INFO_1.");
-                break;
-
-            case PageId::PAGE_002:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_PRODUCT_INFO_2.");
-                break;
-
-            case PageId::PAGE_003:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_PRODUCT_INFO_3.");
-                break;
-
-            case PageId::PAGE_010:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_PS_G1_SETTINGS.");
-                break;
-
-            case PageId::PAGE_011:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_PS_G2_SETTINGS.");
-                break;
-
-            case PageId::PAGE_012:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_PS_G3_SETTINGS.");
-
-            case PageId::PAGE_013:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                        getClassName(),
-                                        "initializeEEProm0",
-                                        "Failed to initialize EEP0_PS_HEATER_SETTINGS.");
-                break;
+    bool EeProm0::saveLogGroupMask(const uint64_t mask) {
+        // A record slot has room for seven payload bytes, and that covers every group there is.
+        static_assert(CScore::LOG_GROUP_COUNT <= 8 * LOG_GROUP_MASK_RECORD_SIZE, "Log group mask record too small");
+        uint8_t payload[LOG_GROUP_MASK_RECORD_SIZE];
+        for (uint8_t i = 0; i < LOG_GROUP_MASK_RECORD_SIZE; i++) {
+            payload[i] = static_cast<uint8_t>(mask >> (8 * i));
+        }
+        return recordLog_.append(LogRecordTypeToNumber(LogRecordType::LOG_GROUP_MASK), payload, sizeof(payload));
+    }
 
-            case PageId::PAGE_014:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_PS_HIGH_VOLTAGE_SETTINGS.");
-                break;
+    bool EeProm0::loadLogGroupMask(uint64_t &mask) {
+        uint8_t payload[ee::MCP_EEPROM_PAGE_SIZE];
+        uint8_t length = 0;
+        const auto retCode = recordLog_.readLatest(LogRecordTypeToNumber(LogRecordType::LOG_GROUP_MASK),
+                                                   payload, length) &&
+                             LOG_GROUP_MASK_RECORD_SIZE == length;
+        if (retCode) {
+            mask = 0;
+            for (uint8_t i = 0; i < LOG_GROUP_MASK_RECORD_SIZE; i++) {
+                mask |= static_cast<uint64_t>(payload[i]) << (8 * i);
+            }
+        }
+        return retCode;
+    }
 
-            case PageId::PAGE_127:
-                CSutilities::logger_.log(CSutilities::LogLevel::Error,
-                                         getClassName(),
-                                         "initializeEEProm0",
-                                         "Failed to initialize EEP0_SIGNATURE_PAGE.");
-                break;
+    bool EeProm0::saveFaultEvent(const uint8_t level, const uint32_t uptimeSeconds, const uint16_t textCrc) {
+        const uint8_t payload[FAULT_EVENT_RECORD_SIZE] {
+            level,
+            static_cast<uint8_t>(uptimeSeconds),
+            static_cast<uint8_t>(uptimeSeconds >> 8),
+            static_cast<uint8_t>(uptimeSeconds >> 16),
+            static_cast<uint8_t>(uptimeSeconds >> 24),
+            static_cast<uint8_t>(textCrc),
+            static_cast<uint8_t>(textCrc >> 8)
+        };
+        return recordLog_.append(LogRecordTypeToNumber(LogRecordType::FAULT_EVENT), payload, sizeof(payload));
+    }
 
-            default:
+    bool EeProm0::savePostMortem(const uint8_t cause, const uint32_t pc, const uint32_t uptimeMs) {
+        const auto minutes = uptimeMs / 60000;
+        const auto uptimeMinutes = static_cast<uint16_t>(minutes < UINT16_MAX ? minutes : UINT16_MAX);
+        const uint8_t payload[POST_MORTEM_RECORD_SIZE] {
+            cause,
+            static_cast<uint8_t>(pc),
+            static_cast<uint8_t>(pc >> 8),
+            static_cast<uint8_t>(pc >> 16),
+            static_cast<uint8_t>(pc >> 24),
+            static_cast<uint8_t>(uptimeMinutes),
+            static_cast<uint8_t>(uptimeMinutes >> 8)
+        };
+        return recordLog_.append(LogRecordTypeToNumber(LogRecordType::POST_MORTEM), payload, sizeof(payload));
+    }
 
-                break;
+    bool EeProm0::saveTelemetrySet(const uint8_t slot, const std::string_view name, const uint32_t mask) {
+        static_assert(TELEMETRY_SET_RECORD_SIZE <= RECORD_LOG_SLOT_SIZE - ee::RECORD_LOG_HEADER_SIZE -
+                                                   ee::RECORD_LOG_CRC_SIZE, "Telemetry set record too big");
+        static_assert(LogRecordTypeToNumber(getTelemetrySetRecordType(TELEMETRY_SET_RECORD_COUNT - 1)) <
+                      ee::RECORD_LOG_MAX_TYPES, "Too many record types");
+        if (slot >= TELEMETRY_SET_RECORD_COUNT || name.empty() || name.size() > TELEMETRY_SET_RECORD_NAME_SIZE) {
+            return false;
+        }
+        uint8_t payload[TELEMETRY_SET_RECORD_SIZE];
+        for (uint8_t i = 0; i < sizeof(mask); i++) {
+            payload[i] = static_cast<uint8_t>(mask >> (8 * i));
+        }
+        std::memcpy(payload + sizeof(mask), name.data(), name.size());
+        return recordLog_.append(LogRecordTypeToNumber(getTelemetrySetRecordType(slot)), payload,
+                                 static_cast<uint8_t>(sizeof(mask) + name.size()));
+    }
 
+    bool EeProm0::loadTelemetrySet(const uint8_t slot, std::string &name, uint32_t &mask) {
+        if (slot >= TELEMETRY_SET_RECORD_COUNT) {
+            return false;
+        }
+        uint8_t payload[ee::MCP_EEPROM_PAGE_SIZE];
+        uint8_t length = 0;
+        const auto retCode = recordLog_.readLatest(LogRecordTypeToNumber(getTelemetrySetRecordType(slot)),
+                                                   payload, length) &&
+                             length > sizeof(mask) && length <= TELEMETRY_SET_RECORD_SIZE;
+        if (retCode) {
+            mask = 0;
+            for (uint8_t i = 0; i < sizeof(mask); i++) {
+                mask |= static_cast<uint32_t>(payload[i]) << (8 * i);
+            }
+            name.assign(reinterpret_cast<const char*>(payload + sizeof(mask)), length - sizeof(mask));
         }
-#endif    // LOG_GROUP_TWO
+        return retCode;
+    }
 
+    void EeProm0::logPageInitError(const CSdevices::EEPromPageId pageId) {
+        if (logger_.isGroupEnabled(LogGroup::TWO)) {
+            logger_.log(LogLevel::Error, getClassName(), "initializeEEProm0",
+                        "Failed to initialize page " + std::to_string(ee::PageIdToNumber(pageId)) + ".");
+        }
     }
 
 }
@@ -4,21 +4,39 @@
 #ifndef EEPROM0_HPP_
 #define EEPROM0_HPP_
 
+#include <string>
+#include <string_view>
+#include <tuple>
+
 #include "csi2c.hpp"
 #include "eeprom0-page-declarations.hpp"
 #include "mcp-24lc32.hpp"
+#include "mcp-page-view.hpp"
+#include "mcp-record-log.hpp"
 
 
 namespace CSdrivers {
     namespace ee = CSdevices;   // alias the namespace to make it less verbose in this file.
     namespace i2c = CSdevices;  // alias the namespace to make it less verbose in this file.
 
+    template <ee::EEPromPageId PageId>
+    using EEProm0PageView = ee::PageView<EEProm0PageType<PageId>, PageId>;
+
+    // One view of each page in the list, built against the same device.
+    template <ee::EEPromPageId... PageIds>
+    struct EEProm0PageViews {
+        explicit EEProm0PageViews (ee::Mcp24Lc32& eeProm) : views(EEProm0PageView<PageIds>(eeProm)...) {}
+        std::tuple<EEProm0PageView<PageIds>...> views;
+    };
+
     class EeProm0 final : public ee::Mcp24Lc32 {
 
         public:
 
         explicit EeProm0 (const i2c::ControllerId controllerId) :
-                                Mcp24Lc32(ee::EEPromIDToNumber(ee::EEPromId::EEPROM_0), controllerId) {
+                                Mcp24Lc32(ee::EEPromIDToNumber(ee::EEPromId::EEPROM_0), controllerId),
+                                recordLog_(*this, RECORD_LOG_FIRST_PAGE, RECORD_LOG_PAGE_COUNT, RECORD_LOG_SLOT_SIZE),
+                                pageViews_(*this) {
             setClassName("EEProm0");
             setLabel("SW EEProm 0");
         }
@@ -33,6 +51,7 @@ namespace CSdrivers {
         }
 
         // This gets called during system initialization - StateMachine::doInitialEEPromState
+        // If the block needs a format, this starts it in the background and returns. service() finishes it.
         bool init () override;
 
         ///
@@ -54,8 +73,8 @@ namespace CSdrivers {
         bool checkSignature () override;
 
         /**
-         * @brief This 'formats' the eeprom. That consists of writing a page of random values to all the pages.
-         * It's the same random values for all pages, but it generates the values new each time format is called.
+         * @brief This 'formats' the eeprom. That consists of filling every page with MCP_EEPROM_FORMAT_FILL.
+         * Pages that initializeEEProm writes are left for it. Pages that already hold the fill are not rewritten.
          * THIS ERASES ALL VALUES IN THE EEPROM!
          * @return true if all is well
          */
@@ -63,6 +82,8 @@ namespace CSdrivers {
             return Mcp24Lc32::formatEEProm(); // Just delegate to the base class.
         }
 
+        bool formatPage (ee::EEPromPageId pageId, ee::EepBuffer_t pageBuffer) override;
+
         /**
          * @brief Initialization writes the values that are supposed to be in each page. They may be just
          * a starting point. But they are the right format at least.
@@ -76,195 +97,115 @@ namespace CSdrivers {
 
         bool initializePage (ee::EEPromPageId pageId) override;
         
-        /// @brief Converts the two pages of eeprom associated with control data into ControlData
-        /// @param controlDataPage1 First page as declared for eeprom;
-        /// @param controlDataPage2 Second page as declared for eeprom;
-        /// @return A copy of ControlData.
-        /*
-        static CSfactory::ControlData getControlDataFromStorage (  const ControlDataPage1& controlDataPage1,
-                                                                   const ControlDataPage2& controlDataPage2);
-
-        static CSfactory::ControlData getControlDataFromStorage (CSpowersupply::PowerSupplyID psId);
-
-        static void setControlDataInStorage (CSpowersupply::PowerSupplyID psId,
-                                                const CSfactory::ControlData& controlData);
-
-        static void setControlDataInStorage (CSpowersupply::PowerSupplyID psId);
+        /// @brief Reads the two pages of eeprom associated with control data for one power supply.
+        /// @param psId The power supply whose pages are read.
+        /// @param controlData Receives both pages. Left untouched if either read fails.
+        /// @return true if both pages were read.
+        bool getControlDataFromStorage (PowerSupplyId psId, ControlData& controlData);
 
-        static void setFactoryControlDataInStorage (const CSpowersupply::PowerSupplyID psId) {
-            setControlDataInStorage(psId, CSfactory::getControlDataFromFactory(psId));
+        /// @brief The typed view of a page, e.g. view<PRODUCT_INFO_2>()->serialNumber.
+        /// The page type comes from EEProm0PageLayout. Every page with a layout has one view, held here, so the page
+        /// is read on first access and served from the view's copy on every call after that.
+        template <ee::EEPromPageId PageId>
+        [[nodiscard]] EEProm0PageView<PageId>& view () {
+            return std::get<EEProm0PageView<PageId>>(pageViews_.views);
         }
 
-        static ControlDataPage1 getControlDataPage1FromControlData (const CSfactory::ControlData& controlData);
-
-        static ControlDataPage2 getControlDataPage2FromControlData (const CSfactory::ControlData& controlData);
-
-        */
-        // Page methods here.
+        using FormatCompleteCallback = void (*)(void* context);
 
         /**
-         * @brief Reads the G1 ControlDataPage1 group of control data values.
-         * @param g1ControlData1 Struct holding the values.
+         * @brief Called from service() when a background format has finished and the record log is mounted.
+         * Whatever was read from the pages while it ran may have been old content, or half rewritten.
          */
-        bool getG1ControlDataPage1 (PSControlDataPage1_t& g1ControlData1) {
-            return readPage(GRID1_CONTROL_DATA_PAGE_1, g1ControlData1);
+        void setFormatCompleteCallback (const FormatCompleteCallback callback, void* context = nullptr) {
+            formatCompleteCallback_ = callback;
+            formatCompleteContext_ = context;
         }
 
-        /**
-         * @brief Writes the G1 ControlDataPage1 group of control data values.
-         * @param g1ControlData1 Struct holding the values.
-         */
-        bool setG1ControlDataPage1 (PSControlDataPage1_t& g1ControlData1) {
-            return writePage(GRID1_CONTROL_DATA_PAGE_1, g1ControlData1);
-        }
+        /// @brief The record log on RECORD_LOG_FIRST_PAGE. Mounted by init().
+        [[nodiscard]] ee::RecordLog& getRecordLog () {return recordLog_;}
 
-        /**
-         * @brief Reads the G1 ControlDataPage2 group of control data values.
-         * @param g1ControlData2 Struct holding the values.
-         */
-        bool getG1ControlDataPage2 (PSControlDataPage2_t& g1ControlData2) {
-            return readPage(GRID1_CONTROL_DATA_PAGE_2, g1ControlData2);
-        }
+        /// @brief Stores the logger's group mask in the record log.
+        bool saveLogGroupMask (uint64_t mask);
 
-        /**
-         * @brief Writes the G1 ControlDataPage2 group of control data values.
-         * @param g1ControlData2 Struct holding the values.
-         */
-        bool setG1ControlDataPage2 (PSControlDataPage2_t& g1ControlData2) {
-            return writePage(GRID1_CONTROL_DATA_PAGE_2, g1ControlData2);
-        }
+        /// @brief Reads the stored group mask. False if none has been stored (or the log isn't mounted yet).
+        bool loadLogGroupMask (uint64_t& mask);
 
-        /**
-         * @brief Reads the G2 ControlDataPage1 group of control data values.
-         * @param g2ControlData1 Struct holding the values.
-         */
-        bool getG2ControlDataPage1 (PSControlDataPage1_t& g2ControlData1) {
-            return readPage(GRID2_CONTROL_DATA_PAGE_1, g2ControlData1);
-        }
+        /// @brief Stores a fault log entry: its level, when it happened and a CRC of its text. The newest one is kept.
+        bool saveFaultEvent (uint8_t level, uint32_t uptimeSeconds, uint16_t textCrc);
 
-        /**
-         * @brief Writes the G2 ControlDataPage1 group of control data values.
-         * @param g2ControlData1 Struct holding the values.
-         */
-        bool setG2ControlDataPage1 (PSControlDataPage1_t& g2ControlData1) {
-            return writePage(GRID2_CONTROL_DATA_PAGE_1, g2ControlData1);
-        }
+        /// @brief Stores the summary of a post-mortem report: the cause, the fault pc (0 if none) and the uptime.
+        bool savePostMortem (uint8_t cause, uint32_t pc, uint32_t uptimeMs);
 
-        /**
-         * @brief Reads the G2 ControlDataPage2 group of control data values.
-         * @param g2ControlData2 Struct holding the values.
-         */
-        bool getG2ControlDataPage2 (PSControlDataPage2_t& g2ControlData2) {
-            return readPage(GRID2_CONTROL_DATA_PAGE_2, g2ControlData2);
-        }
+        /// @brief Stores a named telemetry set under its slot. False if the slot or name is out of range.
+        bool saveTelemetrySet (uint8_t slot, std::string_view name, uint32_t mask);
 
-        /**
-         * @brief Writes the G2 ControlDataPage2 group of control data values.
-         * @param g2ControlData2 Struct holding the values.
-         */
-        bool setG2ControlDataPage2 (PSControlDataPage2_t& g2ControlData2) {
-            return writePage(GRID2_CONTROL_DATA_PAGE_2, g2ControlData2);
-        }
+        /// @brief Reads the set stored under a slot. False if there is none (or the log isn't mounted yet).
+        bool loadTelemetrySet (uint8_t slot, std::string& name, uint32_t& mask);
 
-        /**
-         * @brief Reads the G3 ControlDataPage1 group of control data values.
-         * @param g3ControlData1 Struct holding the values.
-         */
-        bool getG3ControlDataPage1 (PSControlDataPage1_t& g3ControlData1) {
-            return readPage(GRID3_CONTROL_DATA_PAGE_1, g3ControlData1);
-        }
-
-        /**
-         * @brief Writes the G3 ControlDataPage1 group of control data values.
-         * @param g3ControlData1 Struct holding the values.
-         */
-        bool setG3ControlDataPage1 (PSControlDataPage1_t& g3ControlData1) {
-            return writePage(GRID3_CONTROL_DATA_PAGE_1, g3ControlData1);
-        }
+        /*
+        static void setControlDataInStorage (CSpowersupply::PowerSupplyID psId,
+                                                const CSfactory::ControlData& controlData);
 
-        /**
-         * @brief Reads the G3 ControlDataPage2 group of control data values.
-         * @param g3ControlData2 Struct holding the values.
-         */
-        bool getG3ControlDataPage2 (PSControlDataPage2_t& g3ControlData2) {
-            return readPage(GRID3_CONTROL_DATA_PAGE_2, g3ControlData2);
-        }
+        static void setControlDataInStorage (CSpowersupply::PowerSupplyID psId);
 
-        /**
-         * @brief Writes the G3 ControlDataPage2 group of control data values.
-         * @param g3ControlData2 Struct holding the values.
-         */
-        bool setG3ControlDataPage2 (PSControlDataPage2_t& g3ControlData2) {
-            return writePage(GRID3_CONTROL_DATA_PAGE_2, g3ControlData2);
+        static void setFactoryControlDataInStorage (const CSpowersupply::PowerSupplyID psId) {
+            setControlDataInStorage(psId, CSfactory::getControlDataFromFactory(psId));
         }
 
-        /**
-         * @brief Reads the Heater ControlDataPage1 group of control data values.
-         * @param heaterControlData1 Struct holding the values.
-         */
-        bool getHeaterControlDataPage1 (PSControlDataPage1_t& heaterControlData1) {
-            return readPage(HEATER_CONTROL_DATA_PAGE_1, heaterControlData1);
-        }
+        static ControlDataPage1 getControlDataPage1FromControlData (const CSfactory::ControlData& controlData);
 
-        /**
-         * @brief Writes the Heater ControlDataPage1 group of control data values.
-         * @param heaterControlData1 Struct holding the values.
-         */
-        bool setHeaterControlDataPage1 (PSControlDataPage1_t& heaterControlData1) {
-            return writePage(HEATER_CONTROL_DATA_PAGE_1, heaterControlData1);
-        }
+        static ControlDataPage2 getControlDataPage2FromControlData (const CSfactory::ControlData& controlData);
 
-        /**
-         * @brief Reads the Heater ControlDataPage2 group of control data values.
-         * @param heaterControlData2 Struct holding the values.
-         */
-        bool getHeaterControlDataPage2 (PSControlDataPage2_t& heaterControlData2) {
-            return readPage(HEATER_CONTROL_DATA_PAGE_2, heaterControlData2);
-        }
+        */
 
-        /**
-         * @brief Writes the Heater ControlDataPage2 group of control data values.
-         * @param heaterControlData2 Struct holding the values.
-         */
-        bool setHeaterControlDataPage2 (PSControlDataPage2_t& heaterControlData2) {
-            return writePage(HEATER_CONTROL_DATA_PAGE_2, heaterControlData2);
-        }
+    protected:
 
-        /**
-         * @brief Reads the HV ControlDataPage1 group of control data values.
-         * @param hvControlData1 Struct holding the values.
-         */
-        bool getHVControlDataPage1 (PSControlDataPage1_t& hvControlData1) {
-            return readPage(HV_CONTROL_DATA_PAGE_1, hvControlData1);
+        [[nodiscard]] bool hasPageCrc (const ee::EEPromPageId pageId) const override {
+            return hasEEProm0PageCrc(pageId);
         }
 
-        /**
-         * @brief Writes the HV ControlDataPage1 group of control data values.
-         * @param hvControlData1 Struct holding the values.
-         */
-        bool setHVControlDataPage1 (PSControlDataPage1_t& hvControlData1) {
-            return writePage(HV_CONTROL_DATA_PAGE_1, hvControlData1);
-        }
+        ee::EEPromPageId getFormatOrder (uint8_t step) override;
 
-        /**
-         * @brief Reads the HV ControlDataPage2 group of control data values.
-         * @param hvControlData2 Struct holding the values.
-         */
-        bool getHVControlDataPage2 (PSControlDataPage2_t& hvControlData2) {
-            return readPage(HV_CONTROL_DATA_PAGE_2, hvControlData2);
-        }
+        // The progress marker lives in the signature page, right after the signature.
+        bool saveFormatProgress (uint8_t nextStep) override;
 
-        /**
-         * @brief Writes the HV ControlDataPage2 group of control data values.
-         * @param hvControlData2 Struct holding the values.
-         */
-        bool setHVControlDataPage2 (PSControlDataPage2_t& hvControlData2) {
-            return writePage(HV_CONTROL_DATA_PAGE_2, hvControlData2);
-        }
+        void onFormatComplete () override;
 
     private:
 
         void logPageInitError (ee::EEPromPageId pageId);
+
+        // True for the pages initializePage actually writes.
+        static bool hasPageInitializer (ee::EEPromPageId pageId);
+
+        // Compares the signature and layout hash only. The format state is checked separately.
+        static bool isSignatureCurrent (const PageSignature_t& signaturePage);
+
+        template <ee::EEPromPageId Page1Id, ee::EEPromPageId Page2Id>
+        bool readControlData (ControlData& controlData) {
+            auto& page1 = view<Page1Id>();
+            auto& page2 = view<Page2Id>();
+            if (!page1.isValid() || !page2.isValid()) {
+                return false;
+            }
+            controlData.page1 = page1.get();
+            controlData.page2 = page2.get();
+            return true;
+        }
+
+        ee::RecordLog recordLog_;
+
+        // Every page in EEProm0PageLayout. About 50 bytes each.
+        EEProm0PageViews<COMPANY_NAME_PAGE, PRODUCT_INFO_1, PRODUCT_INFO_2, PRODUCT_INFO_3,
+                         GRID1_CONTROL_DATA_PAGE_1, GRID1_CONTROL_DATA_PAGE_2,
+                         GRID2_CONTROL_DATA_PAGE_1, GRID2_CONTROL_DATA_PAGE_2,
+                         GRID3_CONTROL_DATA_PAGE_1, GRID3_CONTROL_DATA_PAGE_2,
+                         HEATER_CONTROL_DATA_PAGE_1, HEATER_CONTROL_DATA_PAGE_2,
+                         HV_CONTROL_DATA_PAGE_1, HV_CONTROL_DATA_PAGE_2,
+                         SIGNATURE_PAGE> pageViews_;
+        FormatCompleteCallback formatCompleteCallback_ = nullptr;
+        void* formatCompleteContext_ = nullptr;
     };
 
 
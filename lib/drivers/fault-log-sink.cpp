@@ -0,0 +1,30 @@
+
+#include "fault-log-sink.hpp"
+#include "pico/time.h"
+
+namespace CSdrivers {
+
+    size_t FaultLogSink::write(const CScore::LogLevel level, const char *text, const size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            if (text[i] < '0' || text[i] > '9') {
+                crc_ = CScore::crc16Ccitt(reinterpret_cast<const uint8_t*>(&text[i]), 1, crc_);
+            }
+        }
+        if (0 == length || '\n' != text[length - 1]) {
+            return length;      // More of the line to come.
+        }
+
+        const auto nowMs = to_ms_since_boot(get_absolute_time());
+        if (saved_ && nowMs - lastSaveMs_ < FAULT_LOG_MIN_INTERVAL_MS) {
+            ++suppressed_;
+        } else if (eeProm_.saveFaultEvent(static_cast<uint8_t>(level), nowMs / 1000, crc_)) {
+            saved_ = true;
+            lastSaveMs_ = nowMs;
+            ++recordsSaved_;
+        }
+
+        crc_ = CScore::CRC16_CCITT_INITIAL;
+        return length;
+    }
+
+}
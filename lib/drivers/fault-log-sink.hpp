@@ -0,0 +1,44 @@
+#pragma once
+#ifndef FAULT_LOG_SINK_HPP_
+#define FAULT_LOG_SINK_HPP_
+
+#include <cstdint>
+
+#include "crc.hpp"
+#include "eeprom0.hpp"
+#include "log-sink.hpp"
+
+namespace CSdrivers {
+
+    constexpr uint32_t FAULT_LOG_MIN_INTERVAL_MS = 60 * 1000;  // At most one EEPROM record a minute.
+
+    /**
+     * @brief Keeps a trace of Error and Fatal log lines across a reset, in the EEPROM 0 record log.
+     * A record slot holds seven bytes, so the text itself doesn't fit. A record holds the level, the uptime and a
+     * CRC of the text with its digits left out. The numbers a message carries don't change the CRC, so the same
+     * fault gives the same CRC each time and repeats can be told from new faults. It doesn't name the message.
+     * EEPROM wear limits it to one record per FAULT_LOG_MIN_INTERVAL_MS. Lines in between are suppressed and counted.
+     */
+    class FaultLogSink final : public CScore::LogSink {
+
+    public:
+        explicit FaultLogSink (EeProm0& eeProm) : LogSink("eeprom", CScore::LogLevel::Error), eeProm_(eeProm) {}
+
+        size_t write (CScore::LogLevel level, const char* text, size_t length) override;
+        [[nodiscard]] bool isReady () const override {return eeProm_.getRecordLog().isMounted();}
+
+        [[nodiscard]] uint32_t getRecordsSaved () const {return recordsSaved_;}
+        [[nodiscard]] uint32_t getSuppressedCount () const {return suppressed_;}
+
+    private:
+        EeProm0& eeProm_;
+        uint16_t crc_ = CScore::CRC16_CCITT_INITIAL;   // Of the line so far, less digits. It can arrive in pieces.
+        uint32_t lastSaveMs_ = 0;
+        bool saved_ = false;
+        uint32_t recordsSaved_ = 0;
+        uint32_t suppressed_ = 0;
+    };
+
+}
+
+#endif  // FAULT_LOG_SINK_HPP_
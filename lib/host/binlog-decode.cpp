@@ -0,0 +1,67 @@
+
+// Host-side decoder for the binary log. Reads a captured serial stream on stdin and writes it to stdout with every
+// binary log line (BINARY_LOG_LINE_PREFIX + hex) expanded to text. Other lines pass through unchanged.
+// It only needs the codec and format headers from lib/core, so it also builds without the SDK:
+//   g++ -std=c++20 -I lib/core lib/host/binlog-decode.cpp -o binlog-decode
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "binary-log-codec.hpp"
+
+using namespace CScore;
+
+namespace {
+
+    int hexValue (const char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool decodeLine (const std::string& hex, std::string& text) {
+        uint8_t bytes[BINARY_LOG_MAX_RECORD_SIZE];
+
+        if (0 != hex.size() % 2 || hex.size() / 2 > sizeof(bytes)) {
+            return false;
+        }
+        for (size_t i = 0; i < hex.size() / 2; i++) {
+            const auto high = hexValue(hex[2 * i]);
+            const auto low = hexValue(hex[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            bytes[i] = static_cast<uint8_t>((high << 4) | low);
+        }
+
+        BinaryLogRecord record;
+        if (!decodeBinaryLogRecord(bytes, hex.size() / 2, record)) {
+            return false;
+        }
+        text = formatBinaryLogRecord(record);
+        return true;
+    }
+
+}
+
+int main () {
+    const auto prefixLength = std::strlen(BINARY_LOG_LINE_PREFIX);
+    std::string line;
+
+    while (std::getline(std::cin, line)) {
+        if (!line.empty() && '\r' == line.back()) {
+            line.pop_back();
+        }
+
+        std::string text;
+        if (0 == line.compare(0, prefixLength, BINARY_LOG_LINE_PREFIX) &&
+            decodeLine(line.substr(prefixLength), text)) {
+            std::cout << text << "\n";
+        } else {
+            std::cout << line << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+
+// Host-side wear run for EEPROM 0. Puts a HostEeprom24Lc32 on the host I2C bus where the board has the chip, then
+// drives the real EeProm0 through the paths that write: the first format of a blank part, a reboot that must not
+// write, a layout change (migration) that formats again, and a long run of record log appends across reboots.
+// After each step it reports the page writes the model counted during it, so a change to the format order, the
+// record log or the write cache shows up as a change in wear.
+//   eeprom-wear [backing file] [appends]
+// The backing file is erased at the start, so every run begins from a blank part.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "eeprom0.hpp"
+#include "host-eeprom-24lc32.hpp"
+#include "host-i2c.hpp"
+
+using namespace CSdrivers;
+using CShost::HostEeprom24Lc32;
+
+namespace {
+
+    constexpr uint32_t DEFAULT_APPENDS = 2000;
+    constexpr uint32_t APPENDS_PER_BOOT = 250;
+
+    // One power-up: a fresh EeProm0, as main() would have, run until its background work is done.
+    bool boot (HostEeprom24Lc32& chip, uint32_t appends, uint32_t& appended) {
+        EeProm0 eeProm0{CSdevices::ControllerId::I2C_CONTROLLER_1};
+        auto retCode = eeProm0.init();
+        while (eeProm0.isFormatting()) {
+            eeProm0.service();
+        }
+
+        uint64_t mask = 0;
+        const auto hadMask = eeProm0.loadLogGroupMask(mask);
+        if (appended > 0 && (!hadMask || mask != appended)) {
+            std::cout << "  log group mask not restored: " << mask << ", expected " << appended << "\n";
+            retCode = false;
+        }
+
+        for (uint32_t i = 0; i < appends; i++) {
+            // A loggroups command now and then: each append's write is done before the next one comes.
+            retCode &= eeProm0.saveLogGroupMask(++appended);
+            while (eeProm0.service()) {}
+        }
+        retCode &= eeProm0.flushAndWait();
+        chip.sync();
+        return retCode;
+    }
+
+    void report (const char* step, HostEeprom24Lc32& chip) {
+        uint32_t total = 0;
+        uint32_t recordLog = 0;
+        uint32_t recordLogMax = 0;
+        const auto firstLogPage = CSdevices::PageIdToNumber(RECORD_LOG_FIRST_PAGE);
+        for (uint8_t page = 0; page < HostEeprom24Lc32::PAGE_COUNT; page++) {
+            const auto writes = chip.getPageWriteCount(page);
+            total += writes;
+            if (page >= firstLogPage && page < firstLogPage + RECORD_LOG_PAGE_COUNT) {
+                recordLog += writes;
+                recordLogMax = writes > recordLogMax ? writes : recordLogMax;
+            }
+        }
+
+        const auto& stats = chip.getStats();
+        std::cout << step << ": " << total << " page writes, busiest page " << chip.getMaxPageWriteCount()
+                  << ", signature page " << chip.getPageWriteCount(CSdevices::PageIdToNumber(SIGNATURE_PAGE))
+                  << ", record log " << recordLog << " (busiest " << recordLogMax << ", mean "
+                  << recordLog / RECORD_LOG_PAGE_COUNT << "), " << stats.ackPolls << " ACK polls\n";
+    }
+
+}
+
+int main (const int argc, char* argv[]) {
+    const std::string path = argc > 1 ? argv[1] : "eeprom0-wear.bin";
+    const uint32_t appends = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : DEFAULT_APPENDS;
+
+    HostEeprom24Lc32 chip{path};
+    if (!chip.isOpen()) {
+        std::cout << "Can't open " << path << "\n";
+        return 1;
+    }
+    chip.fill(HostEeprom24Lc32::ERASED);
+    CShost::HostI2cBus::attach(i2c1, CSdevices::I2C_EEPROM_ADDRESS |
+                                     CSdevices::EEPromIDToNumber(CSdevices::EEPromId::EEPROM_0), &chip);
+
+    auto ok = true;
+    uint32_t appended = 0;
+
+    ok &= boot(chip, 0, appended);
+    report("format, blank part", chip);
+
+    chip.resetStats();
+    ok &= boot(chip, 0, appended);
+    report("reboot", chip);
+    if (0 != chip.getStats().writeTransactions) {
+        std::cout << "  a reboot with nothing to do wrote to the chip\n";
+        ok = false;
+    }
+
+    // A build with another layout finds a different hash in the signature.
+    chip.getMemory()[CSdevices::PageIdToNumber(SIGNATURE_PAGE) * HostEeprom24Lc32::PAGE_SIZE +
+                     SIGNATURE_LAYOUT_HASH_OFFSET] ^= 0xFF;
+    chip.resetStats();
+    ok &= boot(chip, 0, appended);
+    report("migration", chip);
+
+    chip.resetStats();
+    while (appended < appends) {
+        const auto thisBoot = appends - appended < APPENDS_PER_BOOT ? appends - appended : APPENDS_PER_BOOT;
+        ok &= boot(chip, thisBoot, appended);
+    }
+    ok &= boot(chip, 0, appended);     // The last mask has to come back too.
+    report((std::to_string(appended) + " record log appends").c_str(), chip);
+
+    std::cout << (ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "host-eeprom-24lc32.hpp"
+#include "pico/error.h"
+#include "pico/time.h"
+
+namespace CShost {
+
+    HostEeprom24Lc32::HostEeprom24Lc32(const std::string &path, const uint32_t writeCycleUs) :
+                                        writeCycleUs_(writeCycleUs) {
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) {
+            return;
+        }
+
+        struct stat fileStat{};
+        const auto isNew = 0 != fstat(fd_, &fileStat) || fileStat.st_size < SIZE;
+
+        if (isNew && 0 != ftruncate(fd_, SIZE)) {
+            close(fd_);
+            fd_ = -1;
+            return;
+        }
+
+        auto* mapped = mmap(nullptr, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (MAP_FAILED == mapped) {
+            close(fd_);
+            fd_ = -1;
+            return;
+        }
+
+        memory_ = static_cast<uint8_t*>(mapped);
+        if (isNew) {
+            fill(ERASED);   // A part fresh from the factory.
+        }
+    }
+
+    HostEeprom24Lc32::~HostEeprom24Lc32() {
+        if (nullptr != memory_) {
+            sync();
+            munmap(memory_, SIZE);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool HostEeprom24Lc32::isBusy() const {
+        return time_us_64() < busyUntil_us_;
+    }
+
+    int HostEeprom24Lc32::nack() {
+        ++stats_.nacks;
+        return PICO_ERROR_GENERIC;
+    }
+
+    int HostEeprom24Lc32::write(const uint8_t *src, const size_t length, const bool nostop) {
+        if (!isOpen() || isBusy()) {
+            return nack();
+        }
+
+        if (0 == length) {
+            ++stats_.ackPolls;
+            return 0;
+        }
+
+        if (length < 2) {
+            return static_cast<int>(length);    // Half an address. The chip waits for the rest.
+        }
+
+        addressPointer_ = static_cast<uint16_t>(((src[0] << 8) | src[1]) & (SIZE - 1));
+        if (2 == length) {
+            return 2;   // Address only: sets up a random read.
+        }
+
+        // The page latch only holds one page. The low five address bits wrap; the page bits don't move.
+        const auto pageBase = static_cast<uint16_t>(addressPointer_ & ~(PAGE_SIZE - 1));
+        auto offset = static_cast<uint8_t>(addressPointer_ & (PAGE_SIZE - 1));
+        const auto dataLength = length - 2;
+        if (offset + dataLength > PAGE_SIZE) {
+            ++stats_.wrappedWrites;
+        }
+
+        for (size_t i = 0; i < dataLength; i++) {
+            memory_[pageBase + offset] = src[2 + i];
+            offset = (offset + 1) & (PAGE_SIZE - 1);
+        }
+        addressPointer_ = pageBase + offset;
+
+        ++pageWrites_[pageBase / PAGE_SIZE];
+        ++stats_.writeTransactions;
+        stats_.bytesWritten += dataLength;
+
+        busyUntil_us_ = time_us_64() + writeCycleUs_;
+        return static_cast<int>(length);
+    }
+
+    int HostEeprom24Lc32::read(uint8_t *dst, const size_t length, const bool nostop) {
+        if (!isOpen() || isBusy()) {
+            return nack();
+        }
+
+        // Sequential read: the counter runs across page boundaries and rolls over at the end of the array.
+        for (size_t i = 0; i < length; i++) {
+            dst[i] = memory_[addressPointer_];
+            addressPointer_ = (addressPointer_ + 1) & (SIZE - 1);
+        }
+
+        ++stats_.readTransactions;
+        stats_.bytesRead += length;
+        return static_cast<int>(length);
+    }
+
+    void HostEeprom24Lc32::fill(const uint8_t value) {
+        if (isOpen()) {
+            std::memset(memory_, value, SIZE);
+        }
+    }
+
+    bool HostEeprom24Lc32::sync() {
+        return isOpen() && 0 == msync(memory_, SIZE, MS_SYNC);
+    }
+
+    uint32_t HostEeprom24Lc32::getMaxPageWriteCount() const {
+        return *std::max_element(pageWrites_.begin(), pageWrites_.end());
+    }
+
+    void HostEeprom24Lc32::resetStats() {
+        stats_ = Stats{};
+        pageWrites_.fill(0);
+    }
+
+}
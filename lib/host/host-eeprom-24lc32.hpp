@@ -0,0 +1,96 @@
+#pragma once
+#ifndef HOST_EEPROM_24LC32_HPP_
+#define HOST_EEPROM_24LC32_HPP_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "host-i2c.hpp"
+
+namespace CShost {
+
+    /**
+     * @brief A 24LC32 on the host I2C bus, backed by a memory-mapped file.
+     * The file holds the 4 KB array, so the contents survive between runs the way the chip's do. A new file starts
+     * out erased (0xFF).
+     * Modelled from the datasheet:
+     *  - Two address bytes (big endian, top four bits ignored) then data.
+     *  - A write wraps within its 32-byte page. Bytes past the page end land at the start of the same page.
+     *  - A read runs on across pages and rolls over from the last address to 0.
+     *  - After a write with data, the chip is busy for the write cycle and NACKs everything. A zero-length
+     *    write is the ACK poll.
+     * Every page touched by a write has its write count bumped, for wear measurements.
+     */
+    class HostEeprom24Lc32 final : public HostI2cDevice {
+
+    public:
+        static constexpr uint16_t SIZE = 4096;
+        static constexpr uint8_t PAGE_SIZE = 32;
+        static constexpr uint8_t PAGE_COUNT = SIZE / PAGE_SIZE;
+        static constexpr uint32_t DEFAULT_WRITE_CYCLE_US = 5000;    // tWC max.
+        static constexpr uint8_t ERASED = 0xFF;
+
+        struct Stats {
+            uint32_t writeTransactions  = 0;    // Writes with data. Address-only writes and ACK polls aren't counted.
+            uint32_t bytesWritten       = 0;
+            uint32_t wrappedWrites      = 0;    // Writes that ran past the end of their page.
+            uint32_t readTransactions   = 0;
+            uint32_t bytesRead          = 0;
+            uint32_t ackPolls           = 0;
+            uint32_t nacks              = 0;    // Transactions refused during a write cycle.
+        };
+
+        /**
+         * @param path Backing file. Created and erased if it doesn't exist.
+         * @param writeCycleUs Busy time after each write. 0 makes writes instantaneous.
+         */
+        explicit HostEeprom24Lc32 (const std::string& path, uint32_t writeCycleUs = DEFAULT_WRITE_CYCLE_US);
+
+        HostEeprom24Lc32 (const HostEeprom24Lc32& other) = delete;
+        HostEeprom24Lc32& operator=(const HostEeprom24Lc32& other) = delete;
+        ~HostEeprom24Lc32 () override;
+
+        [[nodiscard]] bool isOpen () const {return nullptr != memory_;}
+
+        int write (const uint8_t* src, size_t length, bool nostop) override;
+        int read (uint8_t* dst, size_t length, bool nostop) override;
+
+        [[nodiscard]] bool isBusy () const;
+
+        void setWriteCycleUs (const uint32_t writeCycleUs) {writeCycleUs_ = writeCycleUs;}
+
+        /**
+         * @brief The array itself, for setting up a test or damaging a page on purpose. Bypasses the model.
+         */
+        [[nodiscard]] uint8_t* getMemory () {return memory_;}
+
+        void fill (uint8_t value);
+
+        /**
+         * @brief Pushes the array out to the file.
+         */
+        bool sync ();
+
+        [[nodiscard]] uint32_t getPageWriteCount (const uint8_t page) const {
+            return page < PAGE_COUNT ? pageWrites_[page] : 0;
+        }
+        [[nodiscard]] uint32_t getMaxPageWriteCount () const;
+        [[nodiscard]] const Stats& getStats () const {return stats_;}
+        void resetStats ();
+
+    private:
+        int nack ();
+
+        uint8_t* memory_ = nullptr;
+        int fd_ = -1;
+        uint16_t addressPointer_ = 0;
+        uint32_t writeCycleUs_;
+        uint64_t busyUntil_us_ = 0;
+        std::array<uint32_t, PAGE_COUNT> pageWrites_{};
+        Stats stats_{};
+    };
+
+}
+
+#endif  // HOST_EEPROM_24LC32_HPP_
@@ -0,0 +1,42 @@
+
+#include "host-i2c.hpp"
+#include "pico/error.h"
+
+i2c_inst_t i2c0_inst{0};
+i2c_inst_t i2c1_inst{1};
+
+namespace CShost {
+
+    std::array<HostI2cBus::AddressMap_t, HOST_I2C_CONTROLLER_COUNT>& HostI2cBus::getDevices() {
+        static std::array<AddressMap_t, HOST_I2C_CONTROLLER_COUNT> devices{};
+        return devices;
+    }
+
+    void HostI2cBus::attach(const i2c_inst_t *i2c, const uint8_t address, HostI2cDevice *device) {
+        if (nullptr != i2c && i2c->index < HOST_I2C_CONTROLLER_COUNT && address < HOST_I2C_ADDRESS_COUNT) {
+            getDevices()[i2c->index][address] = device;
+        }
+    }
+
+    HostI2cDevice* HostI2cBus::getDevice(const i2c_inst_t *i2c, const uint8_t address) {
+        if (nullptr == i2c || i2c->index >= HOST_I2C_CONTROLLER_COUNT || address >= HOST_I2C_ADDRESS_COUNT) {
+            return nullptr;
+        }
+        return getDevices()[i2c->index][address];
+    }
+
+}
+
+uint i2c_set_baudrate(i2c_inst_t *, const uint baudrate) {
+    return baudrate;    // The host bus has no clock. Report what was asked for.
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, const uint8_t addr, const uint8_t *src, const size_t len, const bool nostop) {
+    auto* device = CShost::HostI2cBus::getDevice(i2c, addr);
+    return nullptr == device ? PICO_ERROR_GENERIC : device->write(src, len, nostop);
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, const uint8_t addr, uint8_t *dst, const size_t len, const bool nostop) {
+    auto* device = CShost::HostI2cBus::getDevice(i2c, addr);
+    return nullptr == device ? PICO_ERROR_GENERIC : device->read(dst, len, nostop);
+}
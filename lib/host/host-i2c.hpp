@@ -0,0 +1,52 @@
+#pragma once
+#ifndef HOST_I2C_HPP_
+#define HOST_I2C_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "hardware/i2c.h"
+
+namespace CShost {
+
+    constexpr uint8_t HOST_I2C_CONTROLLER_COUNT = 2;
+    constexpr uint8_t HOST_I2C_ADDRESS_COUNT = 128;     // 7-bit addresses.
+
+    /**
+     * @brief A device model on the host I2C bus.
+     * The return values follow the SDK: bytes transferred, or PICO_ERROR_GENERIC for a NACK.
+     */
+    class HostI2cDevice {
+
+    public:
+        virtual ~HostI2cDevice () = default;
+
+        virtual int write (const uint8_t* src, size_t length, bool nostop) = 0;
+        virtual int read (uint8_t* dst, size_t length, bool nostop) = 0;
+    };
+
+    /**
+     * @brief Connects device models to the host I2C functions. Nothing attached at an address means a NACK,
+     * the same as an empty socket.
+     */
+    class HostI2cBus final {
+
+    public:
+        static void attach (const i2c_inst_t* i2c, uint8_t address, HostI2cDevice* device);
+
+        static void detach (const i2c_inst_t* i2c, const uint8_t address) {
+            attach(i2c, address, nullptr);
+        }
+
+        [[nodiscard]] static HostI2cDevice* getDevice (const i2c_inst_t* i2c, uint8_t address);
+
+    private:
+        using AddressMap_t = std::array<HostI2cDevice*, HOST_I2C_ADDRESS_COUNT>;
+
+        static std::array<AddressMap_t, HOST_I2C_CONTROLLER_COUNT>& getDevices ();
+    };
+
+}
+
+#endif  // HOST_I2C_HPP_
@@ -0,0 +1,30 @@
+#pragma once
+#ifndef HOST_HARDWARE_I2C_H_
+#define HOST_HARDWARE_I2C_H_
+
+// Host-build stand-in for the SDK's hardware/i2c.h. Only the calls this project makes are here.
+// Transfers are routed to whatever device model is attached at the address (see host-i2c.hpp).
+
+#include <cstddef>
+#include <cstdint>
+
+#include "pico/types.h"
+
+struct i2c_inst {
+    uint8_t index;
+};
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+uint i2c_set_baudrate (i2c_inst_t* i2c, uint baudrate);
+
+int i2c_write_blocking (i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop);
+
+int i2c_read_blocking (i2c_inst_t* i2c, uint8_t addr, uint8_t* dst, size_t len, bool nostop);
+
+#endif  // HOST_HARDWARE_I2C_H_
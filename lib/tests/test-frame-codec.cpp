@@ -0,0 +1,198 @@
+
+#include <cstdint>
+#include <cstring>
+
+#include "frame-codec.hpp"
+#include "test-frame-codec.hpp"
+
+using namespace CScore;
+
+namespace CStest {
+
+    namespace {
+
+        constexpr size_t COBS_TEST_MAX_LENGTH = 600;    // Past two 254 byte COBS blocks.
+
+        // Zeros nowhere, everywhere, every seventh byte, and wherever a pseudo random fill puts them.
+        void fillPattern (uint8_t* buffer, const size_t length, const int pattern) {
+            for (size_t i = 0; i < length; i++) {
+                switch (pattern) {
+                    case 0:  buffer[i] = static_cast<uint8_t>(1 + i % 255); break;
+                    case 1:  buffer[i] = 0; break;
+                    case 2:  buffer[i] = 0 == i % 7 ? 0 : static_cast<uint8_t>(i); break;
+                    default: buffer[i] = static_cast<uint8_t>(i * 37 + 11); break;
+                }
+            }
+        }
+
+    }
+
+    TestFrameCodec::TestFrameCodec (const Assertion::verbosity level) {
+        setClassName("TestFrameCodec");
+        setVerbosityLevel(level);
+        addTestFunction([this](const Assertion::verbosity lvl) {testCobsRoundTrip(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testCobsRejects(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testCrc(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testFrameRoundTrip(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testFrameCorruption(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testZigzag(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testSampleSeries(lvl);});
+    }
+
+    // Every length up to COBS_TEST_MAX_LENGTH, so both sides of each block boundary are covered.
+    void TestFrameCodec::testCobsRoundTrip (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        static uint8_t source[COBS_TEST_MAX_LENGTH];
+        static uint8_t encoded[COBS_TEST_MAX_LENGTH + COBS_TEST_MAX_LENGTH / 254 + 1];
+        static uint8_t decoded[COBS_TEST_MAX_LENGTH + 1];
+
+        auto ok = true;
+        for (size_t length = 0; length <= COBS_TEST_MAX_LENGTH && ok; length++) {
+            for (int pattern = 0; pattern < 4 && ok; pattern++) {
+                fillPattern(source, length, pattern);
+                const auto encodedLength = cobsEncode(source, length, encoded);
+                ok &= encodedLength <= length + length / 254 + 1;
+                ok &= nullptr == std::memchr(encoded, FRAME_DELIMITER, encodedLength);
+
+                const auto decodedLength = cobsDecode(encoded, encodedLength, decoded, sizeof(decoded));
+                ok &= decodedLength == length && (0 == length || 0 == std::memcmp(source, decoded, length));
+
+                // One byte short of room is refused rather than overrun.
+                ok &= 0 == length || 0 == cobsDecode(encoded, encodedLength, decoded, length - 1);
+            }
+        }
+        Assertion::assertTrue(level, ok, name, __func__, __FILE__, __LINE__);
+    }
+
+    void TestFrameCodec::testCobsRejects (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        uint8_t out[16];
+        const uint8_t zeroCode[] = {0x00, 0x01};
+        Assertion::assertTrue(level, 0 == cobsDecode(zeroCode, sizeof(zeroCode), out, sizeof(out)),
+                              name, __func__, __FILE__, __LINE__);
+        const uint8_t shortBlock[] = {0x05, 0x01, 0x02};
+        Assertion::assertTrue(level, 0 == cobsDecode(shortBlock, sizeof(shortBlock), out, sizeof(out)),
+                              name, __func__, __FILE__, __LINE__);
+        const uint8_t innerZero[] = {0x03, 0x01, 0x00};
+        Assertion::assertTrue(level, 0 == cobsDecode(innerZero, sizeof(innerZero), out, sizeof(out)),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+    void TestFrameCodec::testCrc (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        const auto* check123 = reinterpret_cast<const uint8_t*>("123456789");
+        // The CRC-16/CCITT-FALSE check value.
+        Assertion::assertTrue(level, 0x29B1 == crc16Ccitt(check123, 9), name, __func__, __FILE__, __LINE__);
+        // It continues across buffers.
+        Assertion::assertTrue(level, crc16Ccitt(check123 + 4, 5, crc16Ccitt(check123, 4)) == crc16Ccitt(check123, 9),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+    // A frame is COBS over type, payload and CRC. The receiver hands over the bytes between delimiters.
+    void TestFrameCodec::testFrameRoundTrip (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        uint8_t payload[FRAME_MAX_PAYLOAD + 1]{};
+        uint8_t frame[FRAME_MAX_ENCODED];
+        uint8_t received[FRAME_MAX_ENCODED];
+
+        auto ok = true;
+        for (size_t length = 0; length <= FRAME_MAX_PAYLOAD && ok; length++) {
+            fillPattern(payload, length, 2);
+            const auto frameLength = buildFrame(FrameType::TEXT, payload, length, frame);
+            ok &= frameLength > 0 && FRAME_DELIMITER == frame[frameLength - 1];
+            if (!ok) {
+                break;
+            }
+
+            std::memcpy(received, frame, frameLength - 1);
+            auto type = FrameType::TEXT_MODE;
+            const uint8_t* parsed = nullptr;
+            size_t parsedLength = 0;
+            FrameError error;
+            ok &= parseFrame(received, frameLength - 1, type, parsed, parsedLength, error);
+            ok &= FrameType::TEXT == type && parsedLength == length &&
+                  (0 == length || 0 == std::memcmp(parsed, payload, length));
+        }
+        Assertion::assertTrue(level, ok, name, __func__, __FILE__, __LINE__);
+
+        Assertion::assertTrue(level, 0 == buildFrame(FrameType::TEXT, payload, FRAME_MAX_PAYLOAD + 1, frame),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+    // Any single bit flipped after encoding is caught, as bad COBS or a bad CRC.
+    void TestFrameCodec::testFrameCorruption (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+        uint8_t frame[FRAME_MAX_ENCODED];
+        uint8_t received[FRAME_MAX_ENCODED];
+
+        auto ok = true;
+        for (size_t length = 0; length <= FRAME_MAX_PAYLOAD && ok; length += 7) {
+            fillPattern(payload, length, 2);
+            const auto frameLength = buildFrame(FrameType::TEXT, payload, length, frame);
+
+            for (size_t bit = 0; bit < (frameLength - 1) * 8 && ok; bit += 5) {
+                std::memcpy(received, frame, frameLength - 1);
+                received[bit / 8] ^= static_cast<uint8_t>(1 << (bit % 8));
+                if (0 == received[bit / 8]) {
+                    continue;   // A new delimiter. The receiver would have split the frame there instead.
+                }
+                auto type = FrameType::TEXT_MODE;
+                const uint8_t* parsed = nullptr;
+                size_t parsedLength = 0;
+                FrameError error;
+                ok &= !parseFrame(received, frameLength - 1, type, parsed, parsedLength, error);
+            }
+        }
+        Assertion::assertTrue(level, ok, name, __func__, __FILE__, __LINE__);
+    }
+
+    void TestFrameCodec::testZigzag (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        constexpr int32_t values[] = {0, 1, -1, 2, -2, 63, -64, 64, INT32_MAX, INT32_MIN, INT32_MIN + 1};
+        auto ok = true;
+        for (const auto value : values) {
+            ok &= value == zigzagDecode(zigzagEncode(value));
+        }
+        Assertion::assertTrue(level, ok, name, __func__, __FILE__, __LINE__);
+        // Small magnitudes stay small.
+        Assertion::assertTrue(level, 1 == zigzagEncode(-1) && 2 == zigzagEncode(1), name, __func__, __FILE__, __LINE__);
+    }
+
+    void TestFrameCodec::testSampleSeries (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        constexpr int32_t series[] = {0, 1, -1, 1000, 999, 1001, INT32_MAX, INT32_MIN, 0, -123456, 123456, 4095, 0};
+        constexpr size_t COUNT = sizeof(series) / sizeof(series[0]);
+
+        uint8_t payload[FRAME_MAX_PAYLOAD];
+        const auto length = encodeSampleSeries(3, series, COUNT, payload, sizeof(payload));
+        uint8_t channel = 0;
+        int32_t decoded[COUNT]{};
+        Assertion::assertTrue(level,
+                              static_cast<int>(COUNT) == decodeSampleSeries(payload, length, channel, decoded, COUNT),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, 3 == channel && 0 == std::memcmp(series, decoded, sizeof(series)),
+                              name, __func__, __FILE__, __LINE__);
+
+        // Cut off mid varint, and a count the caller has no room for.
+        Assertion::assertTrue(level, -1 == decodeSampleSeries(payload, length - 1, channel, decoded, COUNT),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, -1 == decodeSampleSeries(payload, length, channel, decoded, COUNT - 1),
+                              name, __func__, __FILE__, __LINE__);
+
+        // A slow signal costs a byte a value.
+        int32_t ramp[100];
+        for (int i = 0; i < 100; i++) {
+            ramp[i] = 2000 + i / 3;
+        }
+        Assertion::assertTrue(level, 2 + 100 + 1 >= encodeSampleSeries(0, ramp, 100, payload, sizeof(payload)),
+                              name, __func__, __FILE__, __LINE__);
+
+        // Too little room stops early, and the count says so.
+        const auto shortLength = encodeSampleSeries(3, series, COUNT, payload, 12);
+        Assertion::assertTrue(level, shortLength <= 12 && payload[1] < COUNT &&
+                                     payload[1] == decodeSampleSeries(payload, shortLength, channel, decoded, COUNT),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef TEST_FRAME_CODEC_HPP_
+#define TEST_FRAME_CODEC_HPP_
+
+#include "test.hpp"
+
+namespace CStest {
+
+    // COBS, the frame CRC, whole frames and zigzag varint sample series, each taken through a round trip, plus the
+    // malformed input a receiver has to turn away.
+    class TestFrameCodec final : public Test {
+
+    public:
+        explicit TestFrameCodec (Assertion::verbosity level = Assertion::ON_FAILURE);
+
+    private:
+        void testCobsRoundTrip (Assertion::verbosity level);
+        void testCobsRejects (Assertion::verbosity level);
+        void testCrc (Assertion::verbosity level);
+        void testFrameRoundTrip (Assertion::verbosity level);
+        void testFrameCorruption (Assertion::verbosity level);
+        void testZigzag (Assertion::verbosity level);
+        void testSampleSeries (Assertion::verbosity level);
+    };
+
+}
+
+#endif  // TEST_FRAME_CODEC_HPP_
@@ -0,0 +1,191 @@
+
+#include <cstdint>
+#include <string_view>
+
+#include "number-parse.hpp"
+#include "test-number-parse.hpp"
+
+using namespace CScore;
+
+namespace CStest {
+
+    namespace {
+
+        bool integerIs (const std::string_view text, const int64_t expected,
+                        const int64_t min = INT32_MIN, const int64_t max = INT32_MAX) {
+            int64_t value = 0;
+            return ParseError::NONE == parseInteger(text, value, min, max) && expected == value;
+        }
+
+        ParseError integerError (const std::string_view text,
+                                 const int64_t min = INT32_MIN, const int64_t max = INT32_MAX) {
+            int64_t value = 0;
+            return parseInteger(text, value, min, max);
+        }
+
+        bool unsignedIs (const std::string_view text, const uint64_t expected, const uint64_t max = UINT32_MAX) {
+            uint64_t value = 0;
+            return ParseError::NONE == parseUnsigned(text, value, max) && expected == value;
+        }
+
+        ParseError unsignedError (const std::string_view text, const uint64_t max = UINT32_MAX) {
+            uint64_t value = 0;
+            return parseUnsigned(text, value, max);
+        }
+
+        bool fixedIs (const std::string_view text, const int32_t expected, const uint8_t decimals = 3) {
+            int32_t value = 0;
+            return ParseError::NONE == parseFixed(text, value, decimals) && expected == value;
+        }
+
+        ParseError fixedError (const std::string_view text, const uint8_t decimals = 3,
+                               const int32_t min = INT32_MIN, const int32_t max = INT32_MAX) {
+            int32_t value = 0;
+            return parseFixed(text, value, decimals, min, max);
+        }
+
+    }
+
+    TestNumberParse::TestNumberParse (const Assertion::verbosity level) {
+        setClassName("TestNumberParse");
+        setVerbosityLevel(level);
+        addTestFunction([this](const Assertion::verbosity lvl) {testIntegerLimits(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testSign(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testPrefix(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testUnsigned(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testFixed(lvl);});
+        addTestFunction([this](const Assertion::verbosity lvl) {testWholeToken(lvl);});
+    }
+
+    // Both ends of the default int32 range and of the full int64 one, and a value past every limit.
+    void TestNumberParse::testIntegerLimits (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        Assertion::assertTrue(level, integerIs("2147483647", INT32_MAX), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, integerIs("-2147483648", INT32_MIN), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == integerError("2147483648"),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == integerError("-2147483649"),
+                              name, __func__, __FILE__, __LINE__);
+
+        Assertion::assertTrue(level, integerIs("9223372036854775807", INT64_MAX, INT64_MIN, INT64_MAX),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, integerIs("-9223372036854775808", INT64_MIN, INT64_MIN, INT64_MAX),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level,
+                              ParseError::OUT_OF_RANGE == integerError("9223372036854775808", INT64_MIN, INT64_MAX),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level,
+                              ParseError::OUT_OF_RANGE == integerError("-9223372036854775809", INT64_MIN, INT64_MAX),
+                              name, __func__, __FILE__, __LINE__);
+        // Saturates instead of wrapping back into range.
+        Assertion::assertTrue(level,
+                              ParseError::OUT_OF_RANGE == integerError("36893488147419103232", INT64_MIN, INT64_MAX),
+                              name, __func__, __FILE__, __LINE__);
+
+        Assertion::assertTrue(level, integerIs("10", 10, 1, 10), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == integerError("0", 1, 10),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == integerError("11", 1, 10),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+    void TestNumberParse::testSign (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        Assertion::assertTrue(level, integerIs("-5", -5), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, integerIs("+5", 5), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, integerIs("-0", 0), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == integerError("-"), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == integerError("--5"), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == integerError("+-5"), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::INVALID_CHARACTER == integerError("5-"),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+    void TestNumberParse::testPrefix (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        Assertion::assertTrue(level, integerIs("0x1F", 31), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, integerIs("0X1f", 31), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, integerIs("0b101", 5), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, integerIs("-0x10", -16), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, integerIs("010", 10), name, __func__, __FILE__, __LINE__);     // No octal.
+        Assertion::assertTrue(level, integerIs("0x7FFFFFFF", INT32_MAX), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == integerError("0x80000000"),
+                              name, __func__, __FILE__, __LINE__);
+        // A prefix with no digits after it.
+        Assertion::assertTrue(level, ParseError::INVALID_CHARACTER == integerError("0x"),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == integerError("0xG"), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == integerError("0b2"), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::INVALID_CHARACTER == integerError("0b102"),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+    void TestNumberParse::testUnsigned (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        Assertion::assertTrue(level, unsignedIs("4294967295", UINT32_MAX), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == unsignedError("4294967296"),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, unsignedIs("0xFFFFFFFFFFFFFFFF", UINT64_MAX, UINT64_MAX),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == unsignedError("0x10000000000000000", UINT64_MAX),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::INVALID_CHARACTER == unsignedError("-1"),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::INVALID_CHARACTER == unsignedError("+1"),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+    // Three decimals, as millivolts from volts.
+    void TestNumberParse::testFixed (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        Assertion::assertTrue(level, fixedIs("1.5", 1500), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, fixedIs("1.25", 1250), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, fixedIs("2", 2000), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, fixedIs("1.", 1000), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, fixedIs(".5", 500), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, fixedIs("-0.001", -1), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, fixedIs("12", 12, 0), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::TOO_MANY_DECIMALS == fixedError("1.2345"),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::TOO_MANY_DECIMALS == fixedError("1.0", 0),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == fixedError("."), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == fixedError("-"), name, __func__, __FILE__, __LINE__);
+
+        // int32 limits in scaled units.
+        Assertion::assertTrue(level, fixedIs("2147483.647", INT32_MAX), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, fixedIs("-2147483.648", INT32_MIN), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == fixedError("2147483.648"),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == fixedError("99999999999"),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::OUT_OF_RANGE == fixedError("5.001", 3, 0, 5000),
+                              name, __func__, __FILE__, __LINE__);
+
+        // Decimal only, and no exponent.
+        Assertion::assertTrue(level, ParseError::INVALID_CHARACTER == fixedError("0x10"),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::INVALID_CHARACTER == fixedError("1e3"),
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+    // The pointer forms stop at the first character that isn't part of the number; the token forms reject it.
+    void TestNumberParse::testWholeToken (const Assertion::verbosity level) {
+        const auto name = getClassName();
+        constexpr std::string_view text = "12 34";
+        int64_t value = 0;
+        const auto result = parseInteger(text.data(), text.data() + text.size(), value);
+        Assertion::assertTrue(level, ParseError::NONE == result.error && 12 == value && text.data() + 2 == result.ptr,
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::INVALID_CHARACTER == integerError(text),
+                              name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == integerError(""), name, __func__, __FILE__, __LINE__);
+        Assertion::assertTrue(level, ParseError::EMPTY == integerError(" 1"), name, __func__, __FILE__, __LINE__);
+
+        // A failed parse leaves the value alone.
+        value = 77;
+        Assertion::assertTrue(level, ParseError::NONE != parseInteger("x", value) && 77 == value,
+                              name, __func__, __FILE__, __LINE__);
+    }
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#ifndef TEST_NUMBER_PARSE_HPP_
+#define TEST_NUMBER_PARSE_HPP_
+
+#include "test.hpp"
+
+namespace CStest {
+
+    // Command argument parsing: overflow, sign, 0x and 0b prefixes, and fixed-point decimals.
+    class TestNumberParse final : public Test {
+
+    public:
+        explicit TestNumberParse (Assertion::verbosity level = Assertion::ON_FAILURE);
+
+    private:
+        void testIntegerLimits (Assertion::verbosity level);
+        void testSign (Assertion::verbosity level);
+        void testPrefix (Assertion::verbosity level);
+        void testUnsigned (Assertion::verbosity level);
+        void testFixed (Assertion::verbosity level);
+        void testWholeToken (Assertion::verbosity level);
+    };
+
+}
+
+#endif  // TEST_NUMBER_PARSE_HPP_
@@ -1,12 +1,18 @@
 
 // #include the hpp file for tests.
 #include "test.hpp"
+#include "test-frame-codec.hpp"
+#include "test-number-parse.hpp"
 
 
 namespace CStest {
 
     void runTests(const Assertion::verbosity level) {
 
+        TestNumberParse testNumberParse(level);
+        testNumberParse.doTests();
+        TestFrameCodec testFrameCodec(level);
+        testFrameCodec.doTests();
 
 //        TestEndian testEndian(level);
 //        testEndian.doTests();
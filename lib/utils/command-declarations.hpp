@@ -1,14 +1,33 @@
 #pragma once
 #ifndef COMMAND_DECLARATIONS_HPP_
 
+#include <cstddef>
 #include <cstdint>
-#include <string>
+#include <string_view>
+
+#include "number-parse.hpp"
 
 namespace CSutils {
 
+    constexpr size_t COMMAND_INPUT_LINE_SIZE = 128;    // One input line. It can hold several commands split by ';'.
+    constexpr size_t COMMAND_LINE_SIZE = 64;           // One command, after the split.
+    constexpr size_t COMMAND_RING_DEPTH = 8;           // Commands waiting to run. A power of two.
+    constexpr size_t COMMAND_MAX_PARAMETERS = 3;
+    constexpr size_t COMMAND_TAG_SIZE = 8;             // Longest correlation tag, without its '#'.
+    static_assert(0 == (COMMAND_RING_DEPTH & (COMMAND_RING_DEPTH - 1)), "COMMAND_RING_DEPTH must be a power of 2");
+
     enum class CommandWord : uint8_t {
         HELP    = 0,
         SHOW_INFO,          // Display product and version info.
+        LOG_GROUPS,         // Show or change the logger's group mask.
+        LOG_SINKS,          // Show the log queue and per-sink counters.
+        LOG_TAIL,           // Show the newest log text held in RAM.
+        FRAMED,             // Switch the serial link to the framed binary protocol.
+        TEXT,               // Switch it back to text. A TEXT_MODE frame queues this.
+        SAMPLES,            // Send the latest measurement and output of every supply.
+        SUBSCRIBE,          // Start, change or stop the telemetry stream.
+        QUERY,              // Read a list of values in one snapshot, or store the list under a name.
+        SETPOINT,           // Show or set a control block's setpoint, in millivolts.
         UNKNOWN
     };
 
@@ -26,20 +45,35 @@ namespace CSutils {
         UNKNOWN,
         HELP,
         SHOW_INFO,
+        LOG_GROUPS,
+        LOG_SINKS,
+        LOG_TAIL,
+        FRAMED,
+        TEXT,
+        SAMPLES,
+        SUBSCRIBE,
+        QUERY,
+        SETPOINT,
     };
 
+    // The string views point into the owning Command's text, NUL terminated there. Numbers are parsed from the
+    // views themselves (number-parse.hpp), which needs no terminator. They are only good while that Command is.
     struct TokenValue {
         LanguageTokenId tokenId{LanguageTokenId::UNKNOWN};
-        std::string     tokenString;
+        std::string_view tokenString;
         CommandWord     commandWord{CommandWord::UNKNOWN};    // If it is a command token this gets filled in.
-        float           tokenValue{0};     // If it needs to be an integer, we just lround it.
+        int32_t         tokenValue{0};     // Exact. See CommandStructure::numbers.
     };
 
     struct CommandStructure {
         TokenValue      commandToken;  // The command token that was found.
+        std::string_view tag;          // The correlation tag, without its '#'. Empty if the command had none.
         CommandStatus   status{CommandStatus::NOT_VALID_STATUS};    // The status of the command.
-        float           numbers[3]{0,0,0};     // Holds 3 numeric parameters
-        std::string     strings[3]{"","", ""};     // Holds 3 string parameters
+        int32_t         numbers[COMMAND_MAX_PARAMETERS]{0,0,0};     // INTEGER parsed, WORD 0.
+        std::string_view strings[COMMAND_MAX_PARAMETERS]{};         // Every parameter, as typed.
+        uint8_t         parameterCount{0};
+        uint8_t         errorParameter{0};                          // 1 based. 0 if no parameter failed.
+        CScore::ParseError parseError{CScore::ParseError::NONE};    // Why it failed.
     };
 
 }
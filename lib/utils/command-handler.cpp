@@ -1,61 +1,416 @@
 
-#include <iostream>
+#include <cstdint>
 
 #include "commands.hpp"
 #include "command-handler.hpp"
+#include "command-registry.hpp"
+#include "communication.hpp"
+#include "driversContainer.hpp"
+#include "log-queue.hpp"
+#include "logger.hpp"
+#include "product-info.hpp"
+#include "utilities.hpp"
+#include "serial-comm.hpp"
 #include "pico/time.h"
 
+using namespace CScore;
+
 namespace CSutils {
+    CommandHandler::CommandHandler() {
+        CSdrivers::getEEProm0().setWriteCompleteCallback(onWriteComplete, this);
+    }
+
+    void CommandHandler::onWriteComplete(CSdevices::EEPromPageId pageId, const bool success, void *context) {
+        if (!success) {
+            ++static_cast<CommandHandler*>(context)->writeFailures_;
+        }
+    }
+
     bool CommandHandler::doCommand() {
         auto retValue = false;
 
-        if (const auto optCmd = Command::getNextCommand()) {
-            // access command object from the optional wrapper
-            const std::unique_ptr<Command>& cmdPtr = optCmd.value();
-
-#ifdef LOG_GROUP_COMMANDS
+        const auto parseStart = get_absolute_time();
+        if (Command::getNextCommand(command_)) {
             const auto startTime = get_absolute_time();
-#endif
-            // Now retrieve the command struct that also has the parse status.
-            if (setCommandStruct(cmdPtr->getCommandStruct());
-                CommandStatus::CMD_OK == getCommandStruct().status && handleCommand()) {
+            if (const auto parseUs = static_cast<uint32_t>(absolute_time_diff_us(parseStart, startTime));
+                parseUs > maxParseUs_) {
+                maxParseUs_ = parseUs;
+            }
+
+            // Every line of the answer carries the tag, the error line too.
+            Communication::setResponseTag(getCommandStruct().tag);
+            completion_ = CommandCompletion::IMMEDIATE;
+
+            // The command struct also has the parse status.
+            if (CommandStatus::CMD_OK == getCommandStruct().status && handleCommand()) {
                     retValue = true;
+                    completeCommand();
                 } else {
                     // Report the bad news.
-#ifdef LOG_GROUP_COMMANDS
-                    logger_.log(LogLevel::Error, std::string("CommandHandler::doCommand(): Command error!"));
-                    logger_.log(LogLevel::Error,
-                                             getCommandStruct().message + " in " +
-                                                     getCommandStruct().commandString);
-#endif
+                    if (logger_.isGroupEnabled(LogGroup::COMMANDS)) {
+                        logger_.log(LogLevel::Error, std::string("CommandHandler::doCommand(): Command error!"));
+                        logger_.log(LogLevel::Error, "Status " +
+                                    std::to_string(static_cast<int>(getCommandStruct().status)) + " in " +
+                                    std::string(getCommandStruct().commandToken.tokenString));
+                    }
                     //  TODO:               ResponseHandler::recordResponse(ResponseCode::F500_INVALID_COMMAND_ERROR);
-                    std::cout << "CommandHandler::doCommand(): Command error! commandString: " <<
-                                                getCommandStruct().commandToken.tokenString << std::endl;
+                    const auto& command = getCommandStruct();
+                    Communication::serialOutputLine("CommandHandler::doCommand(): Command error! commandString: " +
+                                                    std::string(command.commandToken.tokenString) +
+                                                    (0 == command.errorParameter ? std::string() :
+                                                        ", parameter " + std::to_string(command.errorParameter) +
+                                                        ": " + parseErrorToLabel(command.parseError)));
                 }
-#ifdef LOG_GROUP_COMMANDS
-            const auto endTime = get_absolute_time();
-            const auto elapsedTime = absolute_time_diff_us(startTime, endTime);
-            logger_.log(LogLevel::Info, std::string("Command time: ") + std::to_string(elapsedTime) + " us");
-#endif
+            Communication::setResponseTag({});
+            if (logger_.isGroupEnabled(LogGroup::COMMANDS)) {
+                const auto elapsedTime = absolute_time_diff_us(startTime, get_absolute_time());
+                logger_.log(LogLevel::Info, std::string("Command time: ") + std::to_string(elapsedTime) + " us");
+            }
 
-        }   // Notice if getNextCommand returns null (nullopt) we just ignore it.
+        }   // Notice if there is no command waiting we just ignore it.
 
 
         return retValue;
     }
 
-    bool CommandHandler::handleCommand() {
-        auto retValue = false;
+    void CommandHandler::completeCommand() {
+        const auto tag = getCommandStruct().tag;
+        if (tag.empty() || CommandCompletion::SENT == completion_) {
+            return;
+        }
 
-        switch (getCommandStruct().commandToken.commandWord) {
-            default:
-                break;
+        // A full table just means this one's OK goes now, without waiting for the write.
+        if (CommandCompletion::ON_WRITE == completion_ && pendingCount_ < COMMAND_PENDING_COUNT) {
+            auto& pending = pending_[pendingCount_++];
+            pending.tagLength = static_cast<uint8_t>(tag.size());
+            std::copy_n(tag.data(), tag.size(), pending.tag.data());
+            pending.writeFailures = writeFailures_;
+            return;
+        }
+        Communication::serialOutputLine(STANDARD_F500_SUCCESS);
+    }
+
+    void CommandHandler::completePending() {
+        // The queue drains in order, so idle means every write queued so far is done. In write-back mode a write
+        // may still be a dirty page in the cache that the next flush queues, so that has to be gone too.
+        if (0 == pendingCount_) {
+            return;
+        }
+        if (const auto& eeprom = CSdrivers::getEEProm0(); !eeprom.isWriteIdle() || 0 != eeprom.getDirtyPageCount()) {
+            return;
+        }
+
+        for (uint8_t ix = 0; ix < pendingCount_; ix++) {
+            const auto& pending = pending_[ix];
+            Communication::setResponseTag(std::string_view(pending.tag.data(), pending.tagLength));
+            Communication::serialOutputLine(writeFailures_ == pending.writeFailures ? STANDARD_F500_SUCCESS
+                                                                                    : "EEPROM write failed");
+        }
+        Communication::setResponseTag({});
+        pendingCount_ = 0;
+    }
+
+    uint32_t CommandHandler::doCommands() {
+        uint32_t commandsRun = 0;
+        const auto startTime = get_absolute_time();
 
-            case CommandWord::HELP:
-                retValue = true;
+        completePending();
+
+        while (Command::hasPendingCommands()) {
+            // The TX ring drops what doesn't fit. A command whose reply might not fit waits for a later pass.
+            SerialComm::serviceOutput();
+            if (SerialComm::getTxFree() < COMMAND_REPLY_RESERVE) {
+                ++outputWaits_;
+                break;
+            }
+            doCommand();
+            ++commandsRun;
+            if (absolute_time_diff_us(startTime, get_absolute_time()) >= budgetUs_) {
                 break;
+            }
         }
+        return commandsRun;
+    }
 
-        return retValue;
+    bool CommandHandler::handleCommand() {
+        const auto* spec = getCommandSpec(getCommandStruct().commandToken.commandWord);
+        return nullptr != spec && (this->*spec->handler)();
+    }
+
+    bool CommandHandler::handleHelp() {
+        const auto& command = getCommandStruct();
+        if (command.parameterCount > 0) {
+            const auto* spec = findCommand(command.strings[0]);
+            if (nullptr == spec) {
+                return false;
+            }
+            Communication::serialOutputLine(std::string(spec->usage));
+            Communication::serialOutputLine("  " + std::string(spec->help));
+            return true;
+        }
+
+        for (const auto& spec : CommandRegistry::COMMANDS) {
+            Communication::serialOutputLine(std::string(spec.usage));
+            Communication::serialOutputLine("  " + std::string(spec.help));
+        }
+        Communication::serialOutputLine("Any command can start with #tag: each line of the answer starts with it too,");
+        Communication::serialOutputLine("  and the answer ends with OK or the error.");
+        return true;
+    }
+
+    bool CommandHandler::handleShowInfo() {
+        Communication::serialOutputLine(getProductName() + ", " + getCompanyName());
+        Communication::serialOutputLine("Firmware: " + getFirmwareVersion());
+        Communication::serialOutputLine("Board: " + std::string(CURRENT_BOARD_NAME) + ", id " + getPicoBoardId());
+        return true;
+    }
+
+    bool CommandHandler::handleLogGroups() {
+        auto mask = logger_.getGroupMask();
+        auto changed = false;
+
+        for (const auto& parameter : getCommandStruct().strings) {
+            if (parameter.empty()) {
+                continue;
+            }
+
+            if (PLUS == parameter.front() || MINUS == parameter.front()) {
+                const auto group = Logger::labelToLogGroup(std::string(parameter.substr(1)));
+                if (LogGroup::GROUP_COUNT == group) {
+                    return false;
+                }
+                mask = PLUS == parameter.front() ? (mask | logGroupBit(group)) : (mask & ~logGroupBit(group));
+            } else {
+                if (ParseError::NONE != parseUnsigned(parameter, mask, UINT64_MAX)) {
+                    return false;
+                }
+            }
+            changed = true;
+        }
+
+        if (changed) {
+            logger_.setGroupMask(mask);
+            if (!CSdrivers::getEEProm0().saveLogGroupMask(mask)) {
+                Communication::serialOutputLine("Log groups changed but not saved.");
+            } else {
+                completion_ = CommandCompletion::ON_WRITE;
+            }
+        }
+
+        std::string enabled;
+        for (uint8_t ix = 0; ix < LOG_GROUP_COUNT; ix++) {
+            if (const auto group = static_cast<LogGroup>(ix); logger_.isGroupEnabled(group)) {
+                enabled += " " + Logger::logGroupToLabel(group);
+            }
+        }
+        Communication::serialOutputLine("Log groups: " + int_to_hex(logger_.getGroupMask()) +
+                                        (enabled.empty() ? " (none)" : enabled));
+        return true;
+    }
+
+    bool CommandHandler::handleLogSinks() {
+        Communication::serialOutputLine("Log queue: " + std::to_string(logQueue_.getPendingCount()) + " pending, " +
+                                        std::to_string(logQueue_.getDroppedCount()) + " dropped, " +
+                                        std::to_string(logQueue_.getTruncatedCount()) + " truncated");
+
+        for (uint8_t ix = 0; ix < logQueue_.getSinkCount(); ix++) {
+            const auto* sink = logQueue_.getSink(ix);
+            Communication::serialOutputLine(std::string("  ") + sink->getName() + ": " +
+                                            std::to_string(sink->getLinesWritten()) + " lines, " +
+                                            std::to_string(sink->getBytesWritten()) + " bytes, " +
+                                            std::to_string(sink->getLinesDropped()) + " dropped" +
+                                            (sink->isReady() ? "" : ", not ready"));
+        }
+        return true;
+    }
+
+    bool CommandHandler::handleLogTail() {
+        if (nullptr == ramLogSink_) {
+            return false;
+        }
+
+        const auto& command = getCommandStruct();
+        const size_t bytes = command.parameterCount > 0 ? command.numbers[0] : LOG_TAIL_DEFAULT_BYTES;
+        const auto text = ramLogSink_->getText();
+
+        // Start at a line boundary. A cut line at the front is skipped rather than shown half.
+        size_t at = text.size() > bytes ? text.size() - bytes : 0;
+        if (at > 0 && '\n' != text[at - 1]) {
+            const auto newline = text.find('\n', at);
+            at = std::string::npos == newline ? text.size() : newline + 1;
+        }
+
+        while (at < text.size()) {
+            auto end = text.find('\n', at);
+            end = std::string::npos == end ? text.size() : end;
+            if (end > at) {
+                Communication::serialOutputLine(text.substr(at, end - at));
+            }
+            at = end + 1;
+        }
+        return true;
+    }
+
+    bool CommandHandler::handleFramed() {
+        // The reply is queued before the switch, so it still goes out as text.
+        Communication::serialOutputLine(STANDARD_F500_SUCCESS);
+        completion_ = CommandCompletion::SENT;
+        SerialComm::setFramed(true);
+        return true;
+    }
+
+    bool CommandHandler::handleText() {
+        SerialComm::setFramed(false);
+        Communication::serialOutputLine(STANDARD_F500_SUCCESS);
+        completion_ = CommandCompletion::SENT;
+        return true;
+    }
+
+    bool CommandHandler::handleSamples() {
+        if (nullptr == controlLoop_) {
+            return false;
+        }
+
+        int32_t measurements[CSdrivers::POWER_SUPPLY_COUNT];
+        int32_t outputs[CSdrivers::POWER_SUPPLY_COUNT];
+        for (uint8_t ix = 0; ix < CSdrivers::POWER_SUPPLY_COUNT; ix++) {
+            const auto psId = static_cast<CSdrivers::PowerSupplyId>(ix);
+            measurements[ix] = controlLoop_->getMeasurement(psId);
+            outputs[ix] = controlLoop_->getOutput(psId);
+        }
+        Communication::sendSamples(0, measurements, CSdrivers::POWER_SUPPLY_COUNT);
+        Communication::sendSamples(1, outputs, CSdrivers::POWER_SUPPLY_COUNT);
+        return true;
+    }
+
+    bool CommandHandler::handleSubscribe() {
+        if (nullptr == telemetry_) {
+            return false;
+        }
+
+        const auto& command = getCommandStruct();
+        if (command.parameterCount > 0) {
+            if ("off" == command.strings[0]) {
+                telemetry_->unsubscribe();
+            } else {
+                uint32_t mask = 0;
+                if (!telemetry_->parseChannels(command.strings[0], mask)) {
+                    return false;
+                }
+                const auto rateHz = command.parameterCount > 1 ? static_cast<uint32_t>(command.numbers[1])
+                                                               : telemetry_->getRateHz();
+                if (!telemetry_->subscribe(mask, rateHz)) {
+                    return false;
+                }
+            }
+        }
+
+        std::string channels;
+        for (uint8_t ix = 0; ix < TELEMETRY_CHANNEL_COUNT; ix++) {
+            if (const auto channel = static_cast<TelemetryChannel>(ix);
+                0 != (telemetry_->getMask() & telemetryChannelBit(channel))) {
+                channels += " " + Telemetry::channelToLabel(channel);
+            }
+        }
+        Communication::serialOutputLine("Telemetry:" + (channels.empty() ? std::string(" off") : channels) +
+                                        " at " + std::to_string(telemetry_->getRateHz()) + " Hz, sequence " +
+                                        std::to_string(telemetry_->getSequence()) + ", " +
+                                        std::to_string(telemetry_->getDroppedFrames()) + " frames dropped, " +
+                                        std::to_string(telemetry_->getSkippedTicks()) + " ticks skipped");
+        return true;
+    }
+
+    bool CommandHandler::handleQuery() {
+        const auto& command = getCommandStruct();
+        if (nullptr == telemetry_ || 0 == command.parameterCount) {
+            return false;
+        }
+
+        if ("save" == command.strings[0]) {
+            uint32_t mask = 0;
+            uint8_t slot = 0;
+            if (3 != command.parameterCount || "save" == command.strings[1] || "sets" == command.strings[1] ||
+                !telemetry_->parseChannels(command.strings[2], mask) ||
+                !telemetry_->saveSet(command.strings[1], mask, slot)) {
+                return false;
+            }
+            if (!CSdrivers::getEEProm0().saveTelemetrySet(slot, command.strings[1], mask)) {
+                Communication::serialOutputLine("Set saved but not stored.");
+            } else {
+                completion_ = CommandCompletion::ON_WRITE;
+            }
+            Communication::serialOutputLine(std::string("  ") + std::string(command.strings[1]) + ": " +
+                                            int_to_hex_0x(mask));
+            return true;
+        }
+
+        if ("sets" == command.strings[0]) {
+            for (const auto& set : telemetry_->getSets()) {
+                if (0 != set.mask) {
+                    Communication::serialOutputLine(std::string("  ") + set.name + ": " + int_to_hex_0x(set.mask));
+                }
+            }
+            return true;
+        }
+
+        uint32_t mask = 0;
+        if (!telemetry_->parseChannels(command.strings[0], mask) || 0 == mask) {
+            return false;
+        }
+
+        // Read first, format after, so formatting time doesn't spread the samples out.
+        const auto iteration = nullptr == controlLoop_ ? 0 : controlLoop_->getStats().iterations;
+        const auto uptimeUs = time_us_64();
+        int32_t values[TELEMETRY_CHANNEL_COUNT];
+        telemetry_->snapshot(mask, values);
+
+        std::string line = "Q " + std::to_string(iteration) + " " + std::to_string(uptimeUs) + ":";
+        uint8_t count = 0;
+        for (uint8_t ix = 0; ix < TELEMETRY_CHANNEL_COUNT; ix++) {
+            if (const auto channel = static_cast<TelemetryChannel>(ix); 0 != (mask & telemetryChannelBit(channel))) {
+                line += " " + Telemetry::channelToLabel(channel) + "=" + std::to_string(values[count++]);
+            }
+        }
+        Communication::serialOutputLine(line);
+        return true;
+    }
+
+    bool CommandHandler::handleSetpoint() {
+        const auto& command = getCommandStruct();
+        if (nullptr == controlLoop_) {
+            return false;
+        }
+
+        auto only = CSdrivers::PowerSupplyId::NOT_A_SUPPLY;
+        if (command.parameterCount > 0) {
+            only = CScontrol::labelToPowerSupplyId(command.strings[0]);
+            if (!controlLoop_->hasBlock(only)) {
+                return false;
+            }
+        }
+        if (command.parameterCount > 1) {
+            const auto value = command.strings[1];
+            if ("on" == value || "off" == value) {
+                if (!controlLoop_->setBlockEnabled(only, "on" == value)) {
+                    return false;
+                }
+            } else if (int64_t millivolts = 0; ParseError::NONE != parseInteger(value, millivolts) ||
+                                               !controlLoop_->setSetpoint(only, static_cast<int32_t>(millivolts))) {
+                return false;
+            }
+        }
+
+        for (uint8_t ix = 0; ix < CSdrivers::POWER_SUPPLY_COUNT; ix++) {
+            const auto psId = static_cast<CSdrivers::PowerSupplyId>(ix);
+            if (!controlLoop_->hasBlock(psId) || (CSdrivers::PowerSupplyId::NOT_A_SUPPLY != only && psId != only)) {
+                continue;
+            }
+            const auto setpoint = controlLoop_->hasSetpoint(psId) ?
+                    std::to_string(controlLoop_->getSetpointMillivolts(psId)) + " mV, " +
+                    std::to_string(controlLoop_->getSetpoint(psId)) + " counts" : std::string("none");
+            Communication::serialOutputLine(std::string(CScontrol::POWER_SUPPLY_LABELS[ix]) + ": " + setpoint +
+                                            (controlLoop_->isBlockEnabled(psId) ? ", running" : ", stopped"));
+        }
+        return true;
     }
 }
@@ -1,26 +1,153 @@
 #pragma once
 #ifndef COMMAND_HANDLER_HPP_
 
+#include <array>
+#include <cstdint>
+
 #include "command-declarations.hpp"
+#include "commands.hpp"
+#include "control-loop.hpp"
+#include "log-sink.hpp"
+#include "serial-comm.hpp"
+#include "telemetry.hpp"
 
 namespace CSutils {
 
+    constexpr uint32_t COMMAND_BUDGET_US = 500;    // Time doCommands() may spend per main loop pass.
+    constexpr uint8_t COMMAND_PENDING_COUNT = 4;    // Tagged commands that can wait on EEPROM writes at once.
+    constexpr uint16_t LOG_TAIL_DEFAULT_BYTES = 512;
+    constexpr uint16_t COMMAND_REPLY_RESERVE = 1280;   // TX ring room a command needs to start. help is the longest.
+    static_assert(COMMAND_REPLY_RESERVE < CScore::TX_RING_SIZE, "COMMAND_REPLY_RESERVE must fit in the TX ring");
+
+    // When a tagged command's OK goes out.
+    enum class CommandCompletion : uint8_t {
+        IMMEDIATE,      // As soon as the handler returns.
+        SENT,           // The handler's own reply was the OK.
+        ON_WRITE        // Once the EEPROM writes the handler queued are on the chip.
+    };
+
+    struct CommandRegistry;
+
     class CommandHandler final {
 
     public:
-        CommandHandler() = default;
+        using Handler = bool (CommandHandler::*)();
+
+        CommandHandler();
 
         bool doCommand ();
 
+        /**
+         * @brief Sends the OK of every waiting tagged command whose EEPROM writes are done, then runs queued
+         * commands until the queue is empty or the budget is spent. At least one runs if there is TX room, so a
+         * command that takes longer than the budget can't stall the queue. Call once per main loop pass.
+         * A command only starts with COMMAND_REPLY_RESERVE bytes free in the TX ring. Otherwise it waits for the
+         * output to drain, rather than have its reply cut short.
+         * @return Commands run.
+         */
+        uint32_t doCommands ();
+
+        void setBudgetUs (const uint32_t budgetUs) {budgetUs_ = budgetUs;}
+        [[nodiscard]] uint32_t getBudgetUs () const {return budgetUs_;}
+
+        // The samples and setpoint commands use it. Without one, they fail.
+        void setControlLoop (CScontrol::ControlLoop* controlLoop) {controlLoop_ = controlLoop;}
+        // The subscribe and query commands use it. Without one, they fail.
+        void setTelemetry (Telemetry* telemetry) {telemetry_ = telemetry;}
+        // The logtail command reads it. Without one, logtail fails.
+        void setRamLogSink (const CScore::RamLogSink* ramLogSink) {ramLogSink_ = ramLogSink;}
+
+        // The slowest ring-to-parsed-command step so far. It has no allocation in it, so this stays small and flat.
+        [[nodiscard]] uint32_t getMaxParseUs () const {return maxParseUs_;}
+        // Passes that stopped early for want of TX room.
+        [[nodiscard]] uint32_t getOutputWaits () const {return outputWaits_;}
+
     private:
+        friend struct CommandRegistry;     // Its table holds the handlers.
+
+        Command command_;       // Reused for every command. Its struct views its own text, so it isn't copied.
+        uint32_t budgetUs_ = COMMAND_BUDGET_US;
+        uint32_t maxParseUs_ = 0;
+        uint32_t outputWaits_ = 0;
+        CScontrol::ControlLoop* controlLoop_ = nullptr;
+        Telemetry* telemetry_ = nullptr;
+        const CScore::RamLogSink* ramLogSink_ = nullptr;
+        const CommandStructure& getCommandStruct () { return command_.getCommandStruct(); }
+
+        /*
+         * Correlation tags. "#7 query g1" answers with lines that start "#7 ", then "#7 OK" or the error line.
+         * So a host can have several commands in flight and match up the answers. A command that queued an EEPROM
+         * write (a loggroups change) holds its OK until the write is on the chip; the commands after it don't wait,
+         * so their answers can come first. Untagged commands answer as they always have, with no OK.
+         */
+        struct PendingCommand {
+            std::array<char, COMMAND_TAG_SIZE> tag{};
+            uint8_t  tagLength = 0;
+            uint32_t writeFailures = 0;     // writeFailures_ when it started. More by the end is a failed write.
+        };
 
-        CommandStructure commandStruct_{};
-        const CommandStructure& getCommandStruct () { return commandStruct_; }
-        void setCommandStruct (const CommandStructure& commandStruct) {commandStruct_ = commandStruct; }
+        std::array<PendingCommand, COMMAND_PENDING_COUNT> pending_{};
+        uint8_t pendingCount_ = 0;
+        uint32_t writeFailures_ = 0;
+        CommandCompletion completion_ = CommandCompletion::IMMEDIATE;   // Handlers change it for the current command.
+
+        void completeCommand ();
+        void completePending ();
+        static void onWriteComplete (CSdevices::EEPromPageId pageId, bool success, void* context);
 
         // Handler function declarations follow:
 
-        bool handleCommand ();  // dispatches based on the commandStruct command word.
+        bool handleCommand ();  // Dispatches through the registry (command-registry.hpp) on the command word.
+
+        // help                     every command, its usage and what it does.
+        // help query               just that one.
+        bool handleHelp ();
+
+        // info                     product, company, firmware version, board id and board name.
+        bool handleShowInfo ();
+
+        // loggroups                shows the mask and the groups that are on.
+        // loggroups 0x200          sets the whole mask (decimal or 0x hex).
+        // loggroups +adc -dac      switches single groups.
+        // A change is stored in EEPROM 0 and applied again at startup.
+        bool handleLogGroups ();
+
+        // logsinks                 queue depth and drops, then lines, bytes and drops for each sink.
+        bool handleLogSinks ();
+
+        // logtail                  the newest LOG_TAIL_DEFAULT_BYTES of log text kept in RAM, whole lines only.
+        // logtail 2048             as much as that. For what was logged while nothing was attached.
+        bool handleLogTail ();
+
+        // framed                   replies OK in text, then the link is framed (frame-codec.hpp) until the host
+        //                          sends a TEXT_MODE frame.
+        bool handleFramed ();
+
+        // text                     the link goes back to text, then OK in text. A TEXT_MODE frame is queued as
+        //                          this command, so the commands framed before it still get framed replies.
+        bool handleText ();
+
+        // samples                  measurements as series 0 and outputs as series 1, in PowerSupplyId order.
+        //                          SAMPLES frames when framed, S0:/S1: lines otherwise.
+        bool handleSamples ();
+
+        // subscribe                shows the channels, rate, next sequence number and losses.
+        // subscribe meas,loop 50   streams those channels at 50 Hz. Channel names, set names or a 0x mask.
+        // subscribe off            stops the stream.
+        bool handleSubscribe ();
+
+        // query g1,g2,hv,temps     one line: the loop iteration, uptime in us, then label=value for each channel.
+        //                          Channels as for subscribe, all read in the same pass.
+        // query save psu meas,temps  stores the list as psu, in EEPROM too, so it is still there after a reset.
+        //                          Then "query psu" (or "subscribe psu") uses it.
+        // query sets               lists the stored sets.
+        bool handleQuery ();
+
+        // setpoint                 every block: its setpoint in mV and ADC counts, and whether it is running.
+        // setpoint g1 1500         G1 regulates to 1500 mV, converted through the calibration. A block with usable
+        //                          gains starts on its first setpoint. Not stored: it is lost at a reset.
+        // setpoint g1 off          stops the block; its DAC channel keeps the last output. "on" starts it again.
+        bool handleSetpoint ();
     };
 }
 
@@ -0,0 +1,166 @@
+#pragma once
+#ifndef COMMAND_REGISTRY_HPP_
+#define COMMAND_REGISTRY_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "command-declarations.hpp"
+#include "command-handler.hpp"
+
+/**
+ * Every command, in one constexpr table: its name, how many parameters it takes and of what kind, the handler,
+ * and its help text. The table and its strings are constant data, so they stay in flash.
+ * The name lookup is a perfect hash built at compile time. A command word costs one hash, one slot read and one
+ * compare to rule out a word that isn't a command but lands on a used slot.
+ * Adding a command: a CommandWord, a LanguageTokenId, a handler, and a row here, in CommandWord order.
+ */
+namespace CSutils {
+
+    enum class ArgType : uint8_t {
+        NONE = 0,       // Not taken.
+        WORD,           // Any token. The handler makes sense of it.
+        INTEGER         // Decimal, 0x or 0b. Exact.
+    };
+
+    // min and max bound an INTEGER. Other types ignore them.
+    struct ArgSpec {
+        ArgType type    = ArgType::NONE;
+        int32_t min     = INT32_MIN;
+        int32_t max     = INT32_MAX;
+    };
+
+    struct CommandSpec {
+        std::string_view    name;           // Lower case.
+        CommandWord         commandWord;
+        LanguageTokenId     tokenId;
+        uint8_t             minParameters;
+        uint8_t             maxParameters;
+        std::array<ArgSpec, COMMAND_MAX_PARAMETERS> args;
+        CommandHandler::Handler handler;
+        std::string_view    usage;
+        std::string_view    help;
+    };
+
+    struct CommandRegistry {
+        using enum ArgType;
+
+        static constexpr CommandSpec COMMANDS[] {
+            {"help", CommandWord::HELP, LanguageTokenId::HELP, 0, 1, {{{WORD}}},
+             &CommandHandler::handleHelp,
+             "help [command]", "Lists the commands, or shows how to use one."},
+            {"info", CommandWord::SHOW_INFO, LanguageTokenId::SHOW_INFO, 0, 0, {},
+             &CommandHandler::handleShowInfo,
+             "info", "Product, firmware version and board."},
+            {"loggroups", CommandWord::LOG_GROUPS, LanguageTokenId::LOG_GROUPS, 0, 3, {{{WORD}, {WORD}, {WORD}}},
+             &CommandHandler::handleLogGroups,
+             "loggroups [mask | +group -group ...]", "Shows or changes the log groups. Saved in EEPROM."},
+            {"logsinks", CommandWord::LOG_SINKS, LanguageTokenId::LOG_SINKS, 0, 0, {},
+             &CommandHandler::handleLogSinks,
+             "logsinks", "Log queue depth and drops, then lines, bytes and drops for each sink."},
+            {"logtail", CommandWord::LOG_TAIL, LanguageTokenId::LOG_TAIL, 0, 1,
+             {{{INTEGER, 1, CScore::RAM_LOG_SINK_SIZE}}},
+             &CommandHandler::handleLogTail,
+             "logtail [bytes]", "The newest log lines kept in RAM, whole lines only. Default 512 bytes."},
+            {"framed", CommandWord::FRAMED, LanguageTokenId::FRAMED, 0, 0, {},
+             &CommandHandler::handleFramed,
+             "framed", "Replies OK, then switches the link to COBS frames until a TEXT_MODE frame."},
+            {"text", CommandWord::TEXT, LanguageTokenId::TEXT, 0, 0, {},
+             &CommandHandler::handleText,
+             "text", "Switches a framed link back to text and replies OK in text. Same as a TEXT_MODE frame."},
+            {"samples", CommandWord::SAMPLES, LanguageTokenId::SAMPLES, 0, 0, {},
+             &CommandHandler::handleSamples,
+             "samples", "Measurements as series 0 and outputs as series 1, in supply order."},
+            {"subscribe", CommandWord::SUBSCRIBE, LanguageTokenId::SUBSCRIBE, 0, 2,
+             {{{WORD}, {INTEGER, 1, TELEMETRY_MAX_RATE_HZ}}},
+             &CommandHandler::handleSubscribe,
+             "subscribe [channels [hz] | off]", "Streams channels at a fixed rate, or shows the stream."},
+            {"query", CommandWord::QUERY, LanguageTokenId::QUERY, 1, 3, {{{WORD}, {WORD}, {WORD}}},
+             &CommandHandler::handleQuery,
+             "query channels | save name channels | sets", "Reads channels in one snapshot, or names a list."},
+            {"setpoint", CommandWord::SETPOINT, LanguageTokenId::SETPOINT, 0, 2, {{{WORD}, {WORD}}},
+             &CommandHandler::handleSetpoint,
+             "setpoint [supply [mV | on | off]]", "Shows the setpoints, or sets one in mV. Starts that block."},
+        };
+    };
+
+    constexpr size_t COMMAND_COUNT = std::size(CommandRegistry::COMMANDS);
+    constexpr size_t COMMAND_HASH_SLOTS = 32;      // A power of two. About 4x the commands finds a seed quickly.
+    static_assert(0 == (COMMAND_HASH_SLOTS & (COMMAND_HASH_SLOTS - 1)), "COMMAND_HASH_SLOTS must be a power of 2");
+    static_assert(COMMAND_COUNT == static_cast<size_t>(CommandWord::UNKNOWN), "Every CommandWord needs a command");
+
+    constexpr bool isInCommandWordOrder () {
+        for (size_t i = 0; i < COMMAND_COUNT; i++) {
+            if (static_cast<size_t>(CommandRegistry::COMMANDS[i].commandWord) != i) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(isInCommandWordOrder(), "COMMANDS must be in CommandWord order");
+
+    // FNV-1a with the seed folded into the offset basis.
+    constexpr uint32_t commandHash (const std::string_view name, const uint32_t seed) {
+        uint32_t hash = 2166136261U ^ seed;
+        for (const auto ch : name) {
+            hash ^= static_cast<uint8_t>(ch);
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+
+    constexpr uint32_t NO_COMMAND_SEED = UINT32_MAX;
+
+    constexpr uint32_t findCommandSeed () {
+        for (uint32_t seed = 0; seed < 10000; seed++) {
+            bool used[COMMAND_HASH_SLOTS]{};
+            auto collision = false;
+            for (const auto& spec : CommandRegistry::COMMANDS) {
+                auto& slot = used[commandHash(spec.name, seed) & (COMMAND_HASH_SLOTS - 1)];
+                collision |= slot;
+                slot = true;
+            }
+            if (!collision) {
+                return seed;
+            }
+        }
+        return NO_COMMAND_SEED;
+    }
+
+    constexpr uint32_t COMMAND_HASH_SEED = findCommandSeed();
+    static_assert(NO_COMMAND_SEED != COMMAND_HASH_SEED, "No perfect hash seed. Make COMMAND_HASH_SLOTS bigger.");
+
+    // Index into COMMANDS plus one. 0 is an empty slot.
+    constexpr std::array<uint8_t, COMMAND_HASH_SLOTS> COMMAND_HASH_TABLE = [] {
+        std::array<uint8_t, COMMAND_HASH_SLOTS> table{};
+        for (size_t i = 0; i < COMMAND_COUNT; i++) {
+            table[commandHash(CommandRegistry::COMMANDS[i].name, COMMAND_HASH_SEED) & (COMMAND_HASH_SLOTS - 1)] =
+                    static_cast<uint8_t>(i + 1);
+        }
+        return table;
+    }();
+
+    /**
+     * @param name Lower case, as Command::load leaves it.
+     * @return nullptr if it isn't a command.
+     */
+    constexpr const CommandSpec* findCommand (const std::string_view name) {
+        const auto slot = COMMAND_HASH_TABLE[commandHash(name, COMMAND_HASH_SEED) & (COMMAND_HASH_SLOTS - 1)];
+        if (0 == slot || CommandRegistry::COMMANDS[slot - 1].name != name) {
+            return nullptr;
+        }
+        return &CommandRegistry::COMMANDS[slot - 1];
+    }
+
+    constexpr const CommandSpec* getCommandSpec (const CommandWord commandWord) {
+        const auto ix = static_cast<size_t>(commandWord);
+        return ix < COMMAND_COUNT ? &CommandRegistry::COMMANDS[ix] : nullptr;
+    }
+
+    static_assert(nullptr != findCommand("query") && CommandWord::QUERY == findCommand("query")->commandWord);
+    static_assert(nullptr == findCommand("quer"));
+}
+
+#endif  // COMMAND_REGISTRY_HPP_
@@ -1,51 +1,185 @@
 
-#include <queue>
+#include <cstring>
 
 #include "command-declarations.hpp"
+#include "command-registry.hpp"
 #include "commands.hpp"
-#include "pystring.h"
 
 
+using namespace CScore;
+
 namespace CSutils {
 
-    std::queue<std::string> Command::commandStrings_;    // definition of the private queue.
+    std::array<Command::CommandLine, COMMAND_RING_DEPTH> Command::ring_{};  // definition of the private ring.
+    uint32_t Command::ringHead_ = 0;
+    uint32_t Command::ringTail_ = 0;
+    uint32_t Command::droppedCount_ = 0;
+    uint32_t Command::tooLongCount_ = 0;
 
-    std::optional<std::unique_ptr<Command>> Command::getNextCommand() {
-        std::optional<std::unique_ptr<Command>> uniqueCmdPtr = std::nullopt;
-        std::string nextCommandString; // initialized here. If the vector is empty, this will be empty.
+    namespace {
+        constexpr bool isSpace (const char ch) {
+            return ' ' == ch || '\t' == ch || '\r' == ch || '\n' == ch;
+        }
 
-        if (!commandStrings_.empty()) {
-            nextCommandString = commandStrings_.front();
-            commandStrings_.pop();
+        constexpr bool isTagChar (const char ch) {
+            return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+                   '-' == ch || '_' == ch;
         }
 
-        if (!nextCommandString.empty()) {
-            uniqueCmdPtr = create(nextCommandString);
+        constexpr char toLower (const char ch) {
+            return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch - 'A' + 'a') : ch;
         }
 
-        return uniqueCmdPtr;
+        constexpr std::string_view trim (std::string_view text) {
+            while (!text.empty() && isSpace(text.front())) {
+                text.remove_prefix(1);
+            }
+            while (!text.empty() && isSpace(text.back())) {
+                text.remove_suffix(1);
+            }
+            return text;
+        }
     }
 
-    Command::Command(const std::string& commandString) {
-        // The rest of the command structure has a default initialization.
-        // See its declaration in command-declarations.hpp
+    bool Command::recordCommandString(const std::string_view commandString) {
+        const auto trimmed = trim(commandString);
+        if (trimmed.empty()) {
+            return true;    // Nothing to do isn't a drop.
+        }
+        if (trimmed.size() > COMMAND_LINE_SIZE) {
+            ++tooLongCount_;
+            return false;
+        }
+        if (ringHead_ - ringTail_ >= COMMAND_RING_DEPTH) {
+            ++droppedCount_;
+            return false;
+        }
 
-        // Parse the commandString and build the command.
-        const auto cmdString = pystring::strip(pystring::lower(commandString)); // trim and lower
-        commandStruct_.commandToken.tokenString = cmdString;    // That's all for now - string is in the struct.
+        auto& line = ring_[ringHead_ & (COMMAND_RING_DEPTH - 1)];
+        std::memcpy(line.text, trimmed.data(), trimmed.size());
+        line.length = static_cast<uint8_t>(trimmed.size());
+        ++ringHead_;
+        return true;
+    }
 
-        parseCommand(); // Return value doesn't really matter. The commandStruct_.status is what counts.
+    bool Command::getNextCommand(Command &command) {
+        if (!hasPendingCommands()) {
+            return false;
+        }
+
+        const auto& line = ring_[ringTail_ & (COMMAND_RING_DEPTH - 1)];
+        command.load(std::string_view(line.text, line.length));
+        ++ringTail_;
+        return true;
     }
 
-    std::unique_ptr<Command> Command::create(const std::string &commandString) {
-        return std::make_unique<Command>(commandString);
+    bool Command::load(const std::string_view commandString) {
+        commandStruct_ = CommandStructure{};
+
+        const auto trimmed = trim(commandString);
+        const auto length = trimmed.size() < COMMAND_LINE_SIZE ? trimmed.size() : COMMAND_LINE_SIZE;
+
+        // A correlation tag goes back to the host as it came, so it keeps its case. Only the command is lowered.
+        size_t i = 0;
+        if (length > 0 && '#' == trimmed[0]) {
+            for (; i < length && !isSpace(trimmed[i]); i++) {
+                text_[i] = trimmed[i];
+            }
+        }
+        for (; i < length; i++) {
+            text_[i] = toLower(trimmed[i]);
+        }
+        text_[length] = '\0';
+        commandStruct_.commandToken.tokenString = std::string_view(text_.data(), length);
+
+        return parseCommand(); // Return value doesn't really matter. The commandStruct_.status is what counts.
     }
 
     bool Command::parseCommand() {
-        return false;
-    }
+        commandStruct_.status = CommandStatus::UNKNOWN_COMMAND;
+
+        // Split on whitespace in place. Each token gets a NUL after it, which costs the whitespace nothing.
+        std::string_view tokens[1 + COMMAND_MAX_PARAMETERS];
+        size_t tokenCount = 0;
+        const auto length = commandStruct_.commandToken.tokenString.size();
+        size_t at = 0;
+
+        // An optional correlation tag first: '#' and up to COMMAND_TAG_SIZE letters of either case, digits, '-' or '_'.
+        if (length > 0 && '#' == text_[0]) {
+            at = 1;
+            while (at < length && isTagChar(text_[at])) {
+                ++at;
+            }
+            if (1 == at || at - 1 > COMMAND_TAG_SIZE || (at < length && !isSpace(text_[at]))) {
+                commandStruct_.status = CommandStatus::INVALID_PARAMETER;
+                return false;
+            }
+            commandStruct_.tag = std::string_view(&text_[1], at - 1);
+            text_[at] = '\0';
+            ++at;
+        }
+
+        while (at < length) {
+            while (at < length && isSpace(text_[at])) {
+                ++at;
+            }
+            if (at == length) {
+                break;
+            }
+            const auto start = at;
+            while (at < length && !isSpace(text_[at])) {
+                ++at;
+            }
+
+            if (tokenCount == 1 + COMMAND_MAX_PARAMETERS) {
+                commandStruct_.commandToken.tokenString = tokens[0];
+                commandStruct_.status = CommandStatus::INVALID_PARAMETER;
+                return false;
+            }
+            tokens[tokenCount++] = std::string_view(&text_[start], at - start);
+            text_[at] = '\0';   // Safe at the end too: text_ has room for the terminator.
+            ++at;
+        }
+
+        if (0 == tokenCount) {
+            return false;
+        }
+        commandStruct_.commandToken.tokenString = tokens[0];
+
+        const auto* spec = findCommand(tokens[0]);
+        if (nullptr == spec) {
+            return false;
+        }
+        commandStruct_.commandToken.tokenId = spec->tokenId;
+        commandStruct_.commandToken.commandWord = spec->commandWord;
+
+        const auto parameterCount = tokenCount - 1;
+        if (parameterCount < spec->minParameters || parameterCount > spec->maxParameters) {
+            commandStruct_.status = CommandStatus::INVALID_PARAMETER;
+            return false;
+        }
+
+        // Every parameter is kept as text. The numeric ones are parsed and range checked here too.
+        commandStruct_.parameterCount = static_cast<uint8_t>(parameterCount);
+        for (size_t i = 0; i < parameterCount; i++) {
+            const auto& arg = spec->args[i];
+            commandStruct_.strings[i] = tokens[i + 1];
+
+            auto error = ParseError::NONE;
+            if (ArgType::INTEGER == arg.type) {
+                int64_t value = 0;
+                error = parseInteger(tokens[i + 1], value, arg.min, arg.max);
+                commandStruct_.numbers[i] = static_cast<int32_t>(value);
+            }
+            if (ParseError::NONE != error) {
+                commandStruct_.parseError = error;
+                commandStruct_.errorParameter = static_cast<uint8_t>(i + 1);
+                commandStruct_.status = CommandStatus::INVALID_PARAMETER;
+                return false;
+            }
+        }
 
-    bool Command::parseCommand(const std::vector<std::string> &tokens) {
-        return false;
+        commandStruct_.status = CommandStatus::CMD_OK;
+        return true;
     }
 }
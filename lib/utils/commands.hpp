@@ -1,68 +1,75 @@
 #pragma once
 #ifndef COMMANDS_HPP_
 
-#include <memory>
-#include <optional>
-#include <queue>
-#include <vector>
+#include <array>
+#include <cstdint>
+#include <string_view>
 
 #include "command-declarations.hpp"
 
 namespace CSutils {
 
+    /**
+     * @brief One parsed command. The text is held in the object and the CommandStructure views point into it,
+     * so a Command can't be copied; CommandHandler keeps one and load()s each command into it.
+     * Nothing on the input or parse path allocates. Lines wait in a fixed ring of COMMAND_RING_DEPTH, and a line
+     * that doesn't fit (too long, or the ring is full) is dropped and counted.
+     */
     class Command final {
 
     public:
+        Command () = default;
+        ~Command() = default;
+
+        Command (const Command& other) = delete;
+        Command& operator=(const Command& other) = delete;
 
         CommandStructure& getCommandStruct () {
             return commandStruct_;
         }
 
         /**
- * @brief This is a public factory method to create a new Command instance.
- * @return Command instance
- */
-        static std::optional<std::unique_ptr<Command>> getNextCommand ();
+         * @brief Moves the oldest waiting command into command and parses it.
+         * @return false if none is waiting.
+         */
+        static bool getNextCommand (Command& command);
 
-        static void recordCommandString (const std::string& commandString) {
-            //            uint32_t irqState = spin_lock_blocking(CSutilities::spinLock1); // lock spinlock
-            commandStrings_.push(commandString); // toLower called on front call!
-            //            spin_unlock(CSutilities::spinLock1, irqState);    // unlock it!
+        /**
+         * @brief Copies one command into the ring. Called from Communication::handleInputBuffer.
+         * @return false if it was dropped.
+         */
+        static bool recordCommandString (std::string_view commandString);
 
+        [[nodiscard]] static bool hasPendingCommands () {
+            return ringHead_ != ringTail_;
         }
-
-        ~Command() = default;
+        [[nodiscard]] static size_t getFreeSlots () {return COMMAND_RING_DEPTH - (ringHead_ - ringTail_);}
+        [[nodiscard]] static uint32_t getDroppedCount () {return droppedCount_;}
+        [[nodiscard]] static uint32_t getTooLongCount () {return tooLongCount_;}
 
         /**
-         * @brief Constructs a Command from a command string.
-         * @note Prefer using getNextCommand() factory method for proper lifecycle management.
-         * Direct construction should only be used when you need explicit ownership control.
+         * @brief Trims, lowers and parses the command text. A leading #tag keeps its case. The parse status is in the command struct.
          */
-        explicit Command (const std::string& commandString);
-
+        bool load (std::string_view commandString);
 
     private:
-        /**
-         * @brief Custom factory method that is private.
-         * This is needed so the public factory method getNextCommand can make a call to a private method
-         * that has no macro (std::unique_ptr or std::make_unique) that does not have visibility from public to private.
-         * It's a weird step that's needed because of how those macros are implemented.
-         * @param commandString
-         * @return Command object
-         */
-        static std::unique_ptr<Command> create(const std::string& commandString);
+        struct CommandLine {
+            uint8_t length = 0;
+            char text[COMMAND_LINE_SIZE]{};
+        };
+
         bool parseCommand ();
-        bool parseCommand (const std::vector<std::string>& tokens);
 
         CommandStructure commandStruct_;
-        std::vector<TokenValue> tokenValues_{};
-
-        std::vector<TokenValue>& getTokenValues () { return tokenValues_; }
-
-        // This holds the command strings.
-        // Produced in CScommands::Command::recordCommandString(inputBuffer);
-        // Called from CScommunications::handleInputBuffer ()
-        static std::queue<std::string> commandStrings_; // Note it is static!
+        std::array<char, COMMAND_LINE_SIZE + 1> text_{};  // Lowered, tokens NUL terminated in place.
+
+        // Produced in Communication::handleInputBuffer, consumed by CommandHandler::doCommand.
+        // Main loop only, so plain indices are enough.
+        static std::array<CommandLine, COMMAND_RING_DEPTH> ring_;
+        static uint32_t ringHead_;
+        static uint32_t ringTail_;
+        static uint32_t droppedCount_;
+        static uint32_t tooLongCount_;
 
     };
 }
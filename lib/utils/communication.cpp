@@ -6,7 +6,6 @@
 #include "commands.hpp"
 #include "communication.hpp"
 #include "serial-comm.hpp"
-#include "pystring.h"
 
 using namespace CScore;
 
@@ -14,45 +13,42 @@ namespace CSutils {
 
     // Static member definitions
     DisplayMode Communication::displayMode_ = DisplayMode::GAMMA_DISPLAY;
+    Communication::InputLine Communication::inputLine_{};
+    uint32_t Communication::inputOverflows_ = 0;
+    std::array<uint8_t, FRAME_MAX_ENCODED> Communication::frameBuffer_{};
+    size_t Communication::frameLength_ = 0;
+    bool Communication::frameOverflowed_ = false;
+    uint32_t Communication::framesReceived_ = 0;
+    uint32_t Communication::frameErrors_ = 0;
+    std::array<char, COMMAND_TAG_SIZE> Communication::responseTag_{};
+    uint8_t Communication::responseTagLength_ = 0;
 
 
     /**
      * Extract potential commands from the buffer.
+     * Every complete line is queued, not just the first. CommandHandler::doCommands() works through the queue.
      */
     void Communication::handleInputBuffer() {
-        static std::string inputBuffer;
-        std::string commandString;
-
         switch (SerialComm::getActiveCommInterface()) {
 
-            case CommInterface::USB:
+            case CommInterface::USB: {
                 tud_task();
-                while (tud_cdc_available()) {
-                    // Because the while loop quits when no characters are in the tud input buffer,
-                    // we can use blocking read_char
-                    if (const char ch = tud_cdc_read_char(); processInputCharacter(ch, inputBuffer)) {
-                        // If we return true, we have a termination character.
-                        // We need to process the command string.
-                        commandString = inputBuffer;
-                        recordCommands(commandString);
-                        inputBuffer.clear();
-                        return; // Process one command at a time.
-                    }
+                // A byte that has to wait stays in the CDC FIFO. When that fills, TinyUSB stops taking
+                // packets and the host holds off: real flow control.
+                uint8_t byte;
+                while (tud_cdc_peek(&byte) && canTakeInputByte(static_cast<char>(byte))) {
+                    processInputByte(static_cast<char>(tud_cdc_read_char()));
                 }
+            }
                 break;
 
             case CommInterface::UART: {
-                uart_inst_t* uart_hw = SerialComm::getCommandUartHardware();  // Could be nullptr
-                // ReSharper disable once CppDFAConstantConditions
-                while (nullptr != uart_hw && uart_is_readable(uart_hw)) { // compiler options could make this nullptr
-                    if (const char ch = uart_getc(uart_hw); processInputCharacter(ch, inputBuffer)) {
-                        // If we return true, we have a termination character.
-                        // We need to process the command string.
-                        commandString = inputBuffer;
-                        recordCommands(commandString);
-                        inputBuffer.clear();
-                        return; // Process one command at a time.
-                    }
+                // The RX interrupt has already taken the characters off the FIFO. Whatever isn't used
+                // this pass stays in the ring for the next one.
+                char ch;
+                while (SerialComm::peekUartChar(ch) && canTakeInputByte(ch)) {
+                    SerialComm::readUartChar(ch);
+                    processInputByte(ch);
                 }
             }
                 break;
@@ -62,8 +58,118 @@ namespace CSutils {
         }
     }
 
+    bool Communication::canTakeInputByte(const char ch) {
+        if (SerialComm::isFramed()) {
+            // What a frame carries isn't known until it's decoded. It may be a batch, so it waits for an empty ring.
+            return FRAME_DELIMITER != static_cast<uint8_t>(ch) || !Command::hasPendingCommands();
+        }
+        if (LF != ch && CR != ch) {
+            return true;
+        }
+
+        // A line with more commands than the ring holds could never go in whole. It waits for an empty ring.
+        size_t commands = 0;
+        if (!inputLine_.overflowed) {
+            auto inCommand = false;
+            for (size_t i = 0; i < inputLine_.length; i++) {
+                const auto c = inputLine_.text[i];
+                commands += !inCommand && SEMICOLON != c && SP != c ? 1 : 0;
+                inCommand = SEMICOLON != c && (inCommand || SP != c);
+            }
+        }
+        return Command::getFreeSlots() >= (commands < COMMAND_RING_DEPTH ? commands : COMMAND_RING_DEPTH);
+    }
+
+    void Communication::processInputByte(const char ch) {
+        if (SerialComm::isFramed()) {
+            processFrameByte(static_cast<uint8_t>(ch));
+        } else if (processInputCharacter(ch, inputLine_)) {
+            // If we return true, we have a termination character.
+            // We need to process the command string.
+            completeInputLine();
+        }
+    }
+
+    void Communication::processFrameByte(const uint8_t byte) {
+        if (FRAME_DELIMITER != byte) {
+            if (frameLength_ < frameBuffer_.size()) {
+                frameBuffer_[frameLength_++] = byte;
+            } else {
+                frameOverflowed_ = true;
+            }
+            return;
+        }
+
+        if (frameOverflowed_) {
+            sendFrameError(FrameError::TOO_LONG);
+        } else if (frameLength_ > 0) {     // Back to back delimiters are allowed; hosts use them to resync.
+            FrameType type;
+            const uint8_t* payload = nullptr;
+            size_t payloadLength = 0;
+            if (FrameError error; parseFrame(frameBuffer_.data(), frameLength_, type, payload, payloadLength, error)) {
+                ++framesReceived_;
+                handleFrame(type, payload, payloadLength);
+            } else {
+                sendFrameError(error);
+            }
+        }
+        frameLength_ = 0;
+        frameOverflowed_ = false;
+    }
+
+    void Communication::handleFrame(const FrameType type, const uint8_t *payload, const size_t length) {
+        switch (type) {
+            case FrameType::COMMANDS:
+                // The same path as a typed line, so one frame can carry a batch of commands.
+                recordCommands(std::string_view(reinterpret_cast<const char*>(payload), length));
+                break;
+
+            case FrameType::TEXT_MODE:
+                // In line behind the commands already queued. They ran framed, so they answer framed.
+                if (!Command::recordCommandString("text")) {
+                    sendFrameError(FrameError::BUSY);
+                }
+                break;
+
+            default:
+                sendFrameError(FrameError::UNKNOWN_TYPE);
+                break;
+        }
+    }
+
+    void Communication::sendFrameError(const FrameError error) {
+        ++frameErrors_;
+        const auto code = static_cast<uint8_t>(error);
+        SerialComm::queueFrame(FrameType::FRAME_ERROR, &code, 1);
+    }
+
+    void Communication::sendSamples(const uint8_t channel, const int32_t *values, const size_t count) {
+        if (SerialComm::isFramed()) {
+            uint8_t payload[FRAME_MAX_PAYLOAD];
+            SerialComm::queueFrame(FrameType::SAMPLES, payload,
+                                   encodeSampleSeries(channel, values, count, payload, sizeof(payload)));
+            return;
+        }
+
+        std::string line = "S" + std::to_string(channel) + ":";
+        for (size_t i = 0; i < count; i++) {
+            line += " " + std::to_string(values[i]);
+        }
+        serialOutputLine(line);
+    }
+
+    void Communication::completeInputLine() {
+        if (inputLine_.overflowed) {
+            ++inputOverflows_;      // Part of a command is worse than none.
+        } else {
+            recordCommands(std::string_view(inputLine_.text.data(), inputLine_.length));
+        }
+        inputLine_.length = 0;
+        inputLine_.overflowed = false;
+    }
+
     // If a termination character was found, we return true, else false.
-    bool Communication::processInputCharacter(const char ch, std::string& inputBuffer) {
+    bool Communication::processInputCharacter(const char ch, InputLine& inputLine) {
         bool retVal = false;
 
         switch (ch) {
@@ -72,16 +178,20 @@ namespace CSutils {
                 retVal = true;
                 break;
             case BS:  // backspace
-                if (!inputBuffer.empty()) {
-                    inputBuffer.pop_back();
+                if (inputLine.length > 0) {
+                    --inputLine.length;
                 }
                 break;
             default:
                 if (ch == SP || ch == PLUS || ch == MINUS || ch == PERIOD || ch == SEMICOLON ||
-                    ch == EQUALS || ch == UNDERSCORE ||
+                    ch == EQUALS || ch == UNDERSCORE || ch == HASH || ch == COMMA ||
                     (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
                     (ch >= '0' && ch <= '9')) {
-                        inputBuffer += ch;
+                        if (inputLine.length < inputLine.text.size()) {
+                            inputLine.text[inputLine.length++] = ch;
+                        } else {
+                            inputLine.overflowed = true;
+                        }
                     }
                 break;
         }
@@ -89,18 +199,36 @@ namespace CSutils {
     }
 
     void Communication::serialOutput(const std::string &output) {
-        // Send to USB if connected - ie if UART is not enabled.
+        // Queued, not written: the UART TX interrupt or SerialComm::serviceOutput() sends it.
+
+        if (SerialComm::isFramed()) {
+            // Same text, in TEXT frames. No CRLF translation: the host gets exactly what was written.
+            for (size_t at = 0; at < output.size(); at += FRAME_MAX_PAYLOAD) {
+                const auto chunk = output.size() - at < FRAME_MAX_PAYLOAD ? output.size() - at : FRAME_MAX_PAYLOAD;
+                SerialComm::queueFrame(FrameType::TEXT, reinterpret_cast<const uint8_t*>(output.data() + at), chunk);
+            }
+            return;
+        }
 
         switch (SerialComm::getActiveCommInterface()) {
-            case CommInterface::USB:
-                std::cout << output << std::flush;
+            case CommInterface::USB: {
+                // stdio used to turn LF into CRLF on USB. Keep doing that for a bare LF.
+                std::string translated;
+                translated.reserve(output.size() + 8);
+                char previous = NULL_CHAR;
+                for (const auto ch : output) {
+                    if (LF == ch && CR != previous) {
+                        translated += CR;
+                    }
+                    translated += ch;
+                    previous = ch;
+                }
+                SerialComm::queueOutput(translated.data(), translated.size());
+            }
                 break;
 
             case CommInterface::UART:
-                // ReSharper disable once CppDFAConstantConditions
-                if (uart_inst_t* uart_hw = SerialComm::getCommandUartHardware(); nullptr != uart_hw) {
-                    uart_puts(uart_hw, output.c_str());
-                }
+                SerialComm::queueOutput(output.data(), output.size());
                 break;
 
             case CommInterface::NONE:
@@ -109,8 +237,16 @@ namespace CSutils {
         }
     }
 
+    void Communication::setResponseTag(const std::string_view tag) {
+        responseTagLength_ = static_cast<uint8_t>(tag.size() < responseTag_.size() ? tag.size() : responseTag_.size());
+        std::copy_n(tag.data(), responseTagLength_, responseTag_.data());
+    }
+
     void Communication::serialOutputLine(const std::string& output) {
         std::stringstream ss;
+        if (responseTagLength_ > 0) {
+            ss << '#' << std::string_view(responseTag_.data(), responseTagLength_) << ' ';
+        }
         ss << output << sCR << sLF;
         serialOutput(ss.str());
     }
@@ -153,11 +289,15 @@ namespace CSutils {
         serialOutputGamma(STANDARD_GAMMA_SUCCESS);
     }
 
-    void Communication::recordCommands(const std::string &commandString) {
-        std::vector<std::string> tokens;
-        pystring::split(commandString, tokens, sSEMI);
-        for (const auto& token : tokens) {
-            Command::recordCommandString(token);
+    void Communication::recordCommands(std::string_view commandString) {
+        // Split on ';' without copying. Each piece is copied once, into the command ring.
+        while (!commandString.empty()) {
+            const auto end = commandString.find(SEMICOLON);
+            Command::recordCommandString(commandString.substr(0, end));
+            if (std::string_view::npos == end) {
+                break;
+            }
+            commandString.remove_prefix(end + 1);
         }
     }
 }
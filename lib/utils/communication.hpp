@@ -3,8 +3,11 @@
 #ifndef COMM_HPP_
 #define COMM_HPP_
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <bits/stdc++.h>
+#include "command-declarations.hpp"
 #include "serial-comm.hpp"
 
 namespace CSutils {
@@ -52,6 +55,7 @@ namespace CSutils {
     static constexpr auto UNDERSCORE = '_'; // 0x5f
     static constexpr auto QUESTION = '?';   // 0x3f
     static constexpr auto AT = '@';         // 0x40
+    static constexpr auto HASH = '#';       // 0x23
     
     // Comment out the following to disable debug mode within the comm stuff.
     // #define COMM_DEBUG_MODE
@@ -95,6 +99,24 @@ namespace CSutils {
 
         static void handleInputBuffer();
 
+        // Input lines longer than COMMAND_INPUT_LINE_SIZE. They are discarded whole.
+        static uint32_t getInputOverflows() { return inputOverflows_; }
+
+        static uint32_t getFramesReceived() { return framesReceived_; }
+        static uint32_t getFrameErrors() { return frameErrors_; }
+
+        /**
+         * @brief Sends a series of values. Framed mode: one SAMPLES frame of zigzag varint deltas.
+         * Text mode: a line of decimal values.
+         */
+        static void sendSamples(uint8_t channel, const int32_t* values, size_t count);
+
+        /**
+         * @brief While set, every serialOutputLine starts with "#tag ". CommandHandler sets it around a tagged
+         * command, so each line of the reply says which request it answers.
+         */
+        static void setResponseTag(std::string_view tag);
+
         // Output functions - automatically route to the active interface
         static void serialOutput(const std::string &output);
         static void serialOutputLine(const std::string& output);
@@ -104,8 +126,40 @@ namespace CSutils {
         static void displayStandardGammaPositiveResponse();
 
     private:
-        static void recordCommands(const std::string& commandString);
-        static bool processInputCharacter(char ch, std::string &inputBuffer);
+        struct InputLine {
+            std::array<char, COMMAND_INPUT_LINE_SIZE> text{};
+            size_t length = 0;
+            bool overflowed = false;
+        };
+
+        static void recordCommands(std::string_view commandString);
+        static bool processInputCharacter(char ch, InputLine& inputLine);
+        static void completeInputLine();
+
+        // Framed mode input. Bytes collect until the delimiter, then the frame is checked and handled.
+        static void processFrameByte(uint8_t byte);
+        static void handleFrame(CScore::FrameType type, const uint8_t* payload, size_t length);
+        static void sendFrameError(CScore::FrameError error);
+        static void processInputByte(char ch);
+
+        /**
+         * @brief Back-pressure for a full command ring. The byte that would end a line or a frame is only taken once
+         * the ring has room for the commands it completes. Until then it and everything after it stay in the UART
+         * RX ring or the CDC FIFO, instead of being read and dropped.
+         */
+        static bool canTakeInputByte(char ch);
+
+        static InputLine inputLine_;        // The line being typed. Fixed size: no allocation per character.
+        static uint32_t inputOverflows_;
+
+        static std::array<uint8_t, CScore::FRAME_MAX_ENCODED> frameBuffer_;
+        static size_t frameLength_;
+        static bool frameOverflowed_;
+        static uint32_t framesReceived_;
+        static uint32_t frameErrors_;
+
+        static std::array<char, COMMAND_TAG_SIZE> responseTag_;
+        static uint8_t responseTagLength_;
 
         // State tracking
         static DisplayMode displayMode_;    // run silent, run deep.
@@ -0,0 +1,389 @@
+
+#include <cstring>
+
+#include "communication.hpp"
+#include "devicesContainer.hpp"
+#include "frame-codec.hpp"
+#include "number-parse.hpp"
+#include "pico/time.h"
+#include "serial-comm.hpp"
+#include "telemetry.hpp"
+
+using namespace CScore;
+using CSdrivers::PowerSupplyId;
+
+namespace CSutils {
+
+    namespace {
+        constexpr double KELVIN_OFFSET = 273.15;   // The external thermistors report kelvin.
+
+        // Indexed by TelemetryChannel. Lower case: the command string is lowered before parsing.
+        constexpr std::string_view CHANNEL_LABELS[] {
+            "g1", "g2", "g3", "heater", "hv",
+            "g1out", "g2out", "g3out", "heaterout", "hvout",
+            "g1sp", "g2sp", "g3sp", "heatersp", "hvsp",
+            "cpu", "therm0", "therm1", "therm2",
+            "loopexec", "loopjitter", "loopmisses", "looperrors",
+            "g1mv", "g2mv", "g3mv", "heatermv", "hvmv"
+        };
+        static_assert(sizeof(CHANNEL_LABELS) / sizeof(CHANNEL_LABELS[0]) == TELEMETRY_CHANNEL_COUNT,
+                      "Every TelemetryChannel needs a label");
+
+        constexpr uint32_t channelRange (const TelemetryChannel first, const TelemetryChannel last) {
+            return (telemetryChannelBit(last) << 1) - telemetryChannelBit(first);
+        }
+
+        constexpr uint32_t ALL_CHANNELS = (1U << TELEMETRY_CHANNEL_COUNT) - 1;
+
+        struct ChannelSet {
+            std::string_view name;
+            uint32_t         mask;
+        };
+
+        constexpr ChannelSet CHANNEL_SETS[] {
+            {"meas",    channelRange(TelemetryChannel::MEASUREMENT_G1, TelemetryChannel::MEASUREMENT_HV)},
+            {"mv",      channelRange(TelemetryChannel::MILLIVOLTS_G1, TelemetryChannel::MILLIVOLTS_HV)},
+            {"out",     channelRange(TelemetryChannel::OUTPUT_G1, TelemetryChannel::OUTPUT_HV)},
+            {"sp",      channelRange(TelemetryChannel::SETPOINT_G1, TelemetryChannel::SETPOINT_HV)},
+            {"temps",   channelRange(TelemetryChannel::ONBOARD_TEMPERATURE, TelemetryChannel::THERMISTOR_2)},
+            {"loop",    channelRange(TelemetryChannel::LOOP_EXECUTION_US, TelemetryChannel::LOOP_STEP_ERRORS)},
+            {"all",     ALL_CHANNELS},
+        };
+
+        constexpr uint32_t LOOP_CHANNELS = channelRange(TelemetryChannel::LOOP_EXECUTION_US,
+                                                        TelemetryChannel::LOOP_STEP_ERRORS);
+
+        // readChannel gives these in ADC counts. The callers convert them.
+        constexpr uint32_t MILLIVOLT_CHANNELS = channelRange(TelemetryChannel::MILLIVOLTS_G1,
+                                                             TelemetryChannel::MILLIVOLTS_HV);
+
+        constexpr PowerSupplyId millivoltChannelToSupply (const uint8_t ix) {
+            return static_cast<PowerSupplyId>(ix - static_cast<uint8_t>(TelemetryChannel::MILLIVOLTS_G1));
+        }
+
+        int32_t toCentiDegrees (const double degrees) {
+            return static_cast<int32_t>(degrees * 100.0 + (degrees < 0 ? -0.5 : 0.5));
+        }
+
+        void putLittleEndian (uint8_t* destination, const uint32_t value, const uint8_t bytes) {
+            for (uint8_t i = 0; i < bytes; i++) {
+                destination[i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+    }
+
+    std::string Telemetry::channelToLabel(const TelemetryChannel channel) {
+        const auto ix = static_cast<uint8_t>(channel);
+        return ix < TELEMETRY_CHANNEL_COUNT ? std::string(CHANNEL_LABELS[ix]) : "none";
+    }
+
+    bool Telemetry::parseChannels(std::string_view text, uint32_t &mask) const {
+        if (!text.empty() && text.front() >= '0' && text.front() <= '9') {
+            uint64_t value = 0;
+            if (ParseError::NONE != parseUnsigned(text, value, ALL_CHANNELS)) {
+                return false;
+            }
+            mask = static_cast<uint32_t>(value);
+            return true;
+        }
+
+        mask = 0;
+        while (!text.empty()) {
+            const auto comma = text.find(',');
+            const auto name = text.substr(0, comma);
+            text = std::string_view::npos == comma ? std::string_view{} : text.substr(comma + 1);
+
+            auto found = false;
+            for (const auto& set : CHANNEL_SETS) {
+                if (name == set.name) {
+                    mask |= set.mask;
+                    found = true;
+                }
+            }
+            if (const auto* named = findSet(name); nullptr != named) {
+                mask |= named->mask;
+                found = true;
+            }
+            for (uint8_t ix = 0; ix < TELEMETRY_CHANNEL_COUNT && !found; ix++) {
+                if (name == CHANNEL_LABELS[ix]) {
+                    mask |= telemetryChannelBit(static_cast<TelemetryChannel>(ix));
+                    found = true;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const TelemetrySet* Telemetry::findSet(const std::string_view name) const {
+        for (const auto& set : sets_) {
+            if (0 != set.mask && name == set.name) {
+                return &set;
+            }
+        }
+        return nullptr;
+    }
+
+    bool Telemetry::isValidSet(const std::string_view name, const uint32_t mask) {
+        if (name.empty() || name.size() >= TELEMETRY_SET_NAME_SIZE || 0 == mask || 0 != (mask & ~ALL_CHANNELS) ||
+            (name.front() >= '0' && name.front() <= '9') || std::string_view::npos != name.find(',')) {
+            return false;
+        }
+        for (const auto& label : CHANNEL_LABELS) {
+            if (name == label) {
+                return false;
+            }
+        }
+        for (const auto& set : CHANNEL_SETS) {
+            if (name == set.name) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Telemetry::saveSet(const std::string_view name, const uint32_t mask, uint8_t& slot) {
+        if (!isValidSet(name, mask)) {
+            return false;
+        }
+
+        // The same name again replaces it. Otherwise the first free slot.
+        slot = TELEMETRY_NAMED_SET_COUNT;
+        for (uint8_t ix = 0; ix < TELEMETRY_NAMED_SET_COUNT; ix++) {
+            if (0 != sets_[ix].mask && name == sets_[ix].name) {
+                slot = ix;
+            }
+        }
+        for (uint8_t ix = 0; ix < TELEMETRY_NAMED_SET_COUNT && TELEMETRY_NAMED_SET_COUNT == slot; ix++) {
+            if (0 == sets_[ix].mask) {
+                slot = ix;
+            }
+        }
+        if (TELEMETRY_NAMED_SET_COUNT == slot) {
+            return false;
+        }
+
+        std::memcpy(sets_[slot].name, name.data(), name.size());
+        sets_[slot].name[name.size()] = NULL_CHAR;
+        sets_[slot].mask = mask;
+        return true;
+    }
+
+    uint8_t Telemetry::loadSets(CSdrivers::EeProm0& eeProm0) {
+        static_assert(TELEMETRY_NAMED_SET_COUNT <= CSdrivers::TELEMETRY_SET_RECORD_COUNT, "A set slot has no record");
+        static_assert(TELEMETRY_SET_NAME_SIZE - 1 <= CSdrivers::TELEMETRY_SET_RECORD_NAME_SIZE,
+                      "A set name doesn't fit its record");
+
+        // Each set goes back in the slot it was saved from, so saving it again replaces the same record.
+        uint8_t loaded = 0;
+        for (uint8_t ix = 0; ix < TELEMETRY_NAMED_SET_COUNT; ix++) {
+            std::string name;
+            uint32_t mask = 0;
+            if (!eeProm0.loadTelemetrySet(ix, name, mask) || !isValidSet(name, mask)) {
+                continue;
+            }
+            std::memcpy(sets_[ix].name, name.data(), name.size());
+            sets_[ix].name[name.size()] = NULL_CHAR;
+            sets_[ix].mask = mask;
+            ++loaded;
+        }
+        return loaded;
+    }
+
+    uint8_t Telemetry::snapshot(const uint32_t mask, int32_t *values) const {
+        const auto stats = readStats(mask);
+
+        uint8_t count = 0;
+        for (uint8_t ix = 0; ix < TELEMETRY_CHANNEL_COUNT; ix++) {
+            const auto bit = telemetryChannelBit(static_cast<TelemetryChannel>(ix));
+            if (0 == (mask & bit)) {
+                continue;
+            }
+            values[count] = readChannel(static_cast<TelemetryChannel>(ix), stats);
+            if (0 != (MILLIVOLT_CHANNELS & bit)) {
+                values[count] = nullptr == calibration_ ? 0 :
+                                calibration_->toMillivolts(millivoltChannelToSupply(ix), values[count]);
+            }
+            ++count;
+        }
+        return count;
+    }
+
+    CScontrol::LoopStats Telemetry::readStats(const uint32_t mask) const {
+        if (nullptr != controlLoop_ && 0 != (mask & LOOP_CHANNELS)) {
+            return controlLoop_->getStats();
+        }
+        return {};
+    }
+
+    bool Telemetry::subscribe(const uint32_t mask, const uint32_t rateHz) {
+        if (0 == rateHz || rateHz > TELEMETRY_MAX_RATE_HZ || 0 != (mask & ~ALL_CHANNELS)) {
+            return false;
+        }
+
+        mask_ = mask;
+        rateHz_ = rateHz;
+        periodUs_ = 1000000 / rateHz;
+        nextSampleUs_ = time_us_64() + periodUs_;
+        tick_ = 0;
+        sampleCount_ = 0;
+        return true;
+    }
+
+    void Telemetry::service() {
+        if (0 == mask_) {
+            return;
+        }
+
+        const auto now = time_us_64();
+        if (now < nextSampleUs_) {
+            return;
+        }
+
+        // More than a period late: the ticks in between are lost. The batch so far still has evenly spaced samples.
+        if (const auto missed = static_cast<uint32_t>((now - nextSampleUs_) / periodUs_); missed > 0) {
+            skippedTicks_ += missed;
+            tick_ += missed;
+            nextSampleUs_ += missed * periodUs_;
+            sendBatch();
+        }
+
+        takeSample();
+        nextSampleUs_ += periodUs_;
+        ++tick_;
+
+        if (TELEMETRY_BATCH_SAMPLES == sampleCount_) {
+            sendBatch();
+        }
+    }
+
+    void Telemetry::takeSample() {
+        if (0 == sampleCount_) {
+            firstTick_ = tick_;
+        }
+
+        const auto stats = readStats(mask_);
+
+        for (uint8_t ix = 0; ix < TELEMETRY_CHANNEL_COUNT; ix++) {
+            if (const auto channel = static_cast<TelemetryChannel>(ix); 0 != (mask_ & telemetryChannelBit(channel))) {
+                history_[ix][sampleCount_] = readChannel(channel, stats);
+            }
+        }
+        ++sampleCount_;
+    }
+
+    int32_t Telemetry::readChannel(const TelemetryChannel channel, const CScontrol::LoopStats &stats) const {
+        const auto ix = static_cast<uint8_t>(channel);
+
+        switch (channel) {
+            case TelemetryChannel::MEASUREMENT_G1:
+            case TelemetryChannel::MEASUREMENT_G2:
+            case TelemetryChannel::MEASUREMENT_G3:
+            case TelemetryChannel::MEASUREMENT_HEATER:
+            case TelemetryChannel::MEASUREMENT_HV:
+                return nullptr == controlLoop_ ? 0 : controlLoop_->getMeasurement(static_cast<PowerSupplyId>(ix));
+
+            case TelemetryChannel::OUTPUT_G1:
+            case TelemetryChannel::OUTPUT_G2:
+            case TelemetryChannel::OUTPUT_G3:
+            case TelemetryChannel::OUTPUT_HEATER:
+            case TelemetryChannel::OUTPUT_HV:
+                return nullptr == controlLoop_ ? 0 : controlLoop_->getOutput(
+                        static_cast<PowerSupplyId>(ix - static_cast<uint8_t>(TelemetryChannel::OUTPUT_G1)));
+
+            case TelemetryChannel::SETPOINT_G1:
+            case TelemetryChannel::SETPOINT_G2:
+            case TelemetryChannel::SETPOINT_G3:
+            case TelemetryChannel::SETPOINT_HEATER:
+            case TelemetryChannel::SETPOINT_HV:
+                return nullptr == controlLoop_ ? 0 : controlLoop_->getSetpoint(
+                        static_cast<PowerSupplyId>(ix - static_cast<uint8_t>(TelemetryChannel::SETPOINT_G1)));
+
+            case TelemetryChannel::MILLIVOLTS_G1:
+            case TelemetryChannel::MILLIVOLTS_G2:
+            case TelemetryChannel::MILLIVOLTS_G3:
+            case TelemetryChannel::MILLIVOLTS_HEATER:
+            case TelemetryChannel::MILLIVOLTS_HV:
+                // Still counts. A whole batch goes through the calibration at once in sendBatch.
+                return nullptr == controlLoop_ ? 0 : controlLoop_->getMeasurement(millivoltChannelToSupply(ix));
+
+            case TelemetryChannel::ONBOARD_TEMPERATURE: {
+                auto& sensor = CSdevices::getOnboardTemperatureSensor();
+                sensor.convert();
+                return toCentiDegrees(sensor.getTemperature());
+            }
+
+            case TelemetryChannel::THERMISTOR_0:
+            case TelemetryChannel::THERMISTOR_1:
+            case TelemetryChannel::THERMISTOR_2: {
+                auto& thermistor = CSdevices::getExternalThermistor(static_cast<CSdevices::PicoAin>(
+                        ix - static_cast<uint8_t>(TelemetryChannel::THERMISTOR_0)));
+                thermistor.convert();
+                return toCentiDegrees(thermistor.getTemperature() - KELVIN_OFFSET);
+            }
+
+            case TelemetryChannel::LOOP_EXECUTION_US:       return static_cast<int32_t>(stats.lastExecutionUs);
+            case TelemetryChannel::LOOP_JITTER_US:          return static_cast<int32_t>(stats.lastJitterUs);
+            case TelemetryChannel::LOOP_DEADLINE_MISSES:    return static_cast<int32_t>(stats.deadlineMisses);
+            case TelemetryChannel::LOOP_STEP_ERRORS:        return static_cast<int32_t>(stats.stepErrors);
+
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    void Telemetry::sendBatch() {
+        if (0 == sampleCount_) {
+            return;
+        }
+
+        // The MILLIVOLTS rows hold counts until now. One call converts each of them.
+        for (uint8_t ix = 0; ix < TELEMETRY_CHANNEL_COUNT; ix++) {
+            if (0 == (mask_ & MILLIVOLT_CHANNELS & telemetryChannelBit(static_cast<TelemetryChannel>(ix)))) {
+                continue;
+            }
+            if (nullptr == calibration_) {
+                history_[ix].fill(0);
+            } else {
+                calibration_->toMillivolts(millivoltChannelToSupply(ix), history_[ix].data(), history_[ix].data(),
+                                           sampleCount_);
+            }
+        }
+
+        for (uint8_t ix = 0; ix < TELEMETRY_CHANNEL_COUNT; ix++) {
+            const auto channel = static_cast<TelemetryChannel>(ix);
+            if (0 == (mask_ & telemetryChannelBit(channel))) {
+                continue;
+            }
+
+            const auto sequence = sequence_++;
+            if (SerialComm::isFramed()) {
+                uint8_t payload[FRAME_MAX_PAYLOAD];
+                putLittleEndian(payload, sequence, 2);
+                putLittleEndian(payload + 2, firstTick_, 4);
+                const auto length = 6 + encodeSampleSeries(ix, history_[ix].data(), sampleCount_,
+                                                           payload + 6, sizeof(payload) - 6);
+                if (!SerialComm::queueFrame(FrameType::TELEMETRY, payload, length)) {
+                    ++droppedFrames_;
+                }
+                continue;
+            }
+
+            std::string line = "T" + std::to_string(sequence) + " " + std::to_string(firstTick_) + " " +
+                               std::string(CHANNEL_LABELS[ix]) + ":";
+            for (uint8_t i = 0; i < sampleCount_; i++) {
+                line += " " + std::to_string(history_[ix][i]);
+            }
+            // Whole lines only. Under TxOverflowPolicy::DROP a line cut short would run into the next one.
+            if (line.size() + 2 > SerialComm::getTxFree()) {     // Plus CR LF.
+                ++droppedFrames_;
+                continue;
+            }
+            Communication::serialOutputLine(line);
+        }
+        sampleCount_ = 0;
+    }
+}
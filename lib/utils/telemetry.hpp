@@ -0,0 +1,164 @@
+#pragma once
+#ifndef TELEMETRY_HPP_
+#define TELEMETRY_HPP_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "calibration.hpp"
+#include "control-loop.hpp"
+#include "eeprom0.hpp"
+
+namespace CSutils {
+
+    constexpr uint32_t TELEMETRY_DEFAULT_RATE_HZ = 10;
+    constexpr uint32_t TELEMETRY_MAX_RATE_HZ = 1000;
+    constexpr uint8_t TELEMETRY_BATCH_SAMPLES = 16;    // Samples of each channel per frame.
+    constexpr uint8_t TELEMETRY_NAMED_SET_COUNT = 4;
+    constexpr size_t TELEMETRY_SET_NAME_SIZE = 12;     // Terminator included.
+
+    // Units: ADC and DAC counts for the supplies, hundredths of a degree C, and microseconds or counts for the loop.
+    // The MILLIVOLTS channels are the measurements through the calibration; they follow the rest so that adding them
+    // left the other channel numbers alone.
+    enum class TelemetryChannel : uint8_t {
+        MEASUREMENT_G1 = 0,
+        MEASUREMENT_G2,
+        MEASUREMENT_G3,
+        MEASUREMENT_HEATER,
+        MEASUREMENT_HV,
+        OUTPUT_G1,
+        OUTPUT_G2,
+        OUTPUT_G3,
+        OUTPUT_HEATER,
+        OUTPUT_HV,
+        SETPOINT_G1,
+        SETPOINT_G2,
+        SETPOINT_G3,
+        SETPOINT_HEATER,
+        SETPOINT_HV,
+        ONBOARD_TEMPERATURE,
+        THERMISTOR_0,
+        THERMISTOR_1,
+        THERMISTOR_2,
+        LOOP_EXECUTION_US,
+        LOOP_JITTER_US,
+        LOOP_DEADLINE_MISSES,
+        LOOP_STEP_ERRORS,
+        MILLIVOLTS_G1,
+        MILLIVOLTS_G2,
+        MILLIVOLTS_G3,
+        MILLIVOLTS_HEATER,
+        MILLIVOLTS_HV,
+        CHANNEL_COUNT
+    };
+    constexpr uint8_t TELEMETRY_CHANNEL_COUNT = static_cast<uint8_t>(TelemetryChannel::CHANNEL_COUNT);
+    static_assert(TELEMETRY_CHANNEL_COUNT <= 32, "The subscription mask is 32 bits");
+
+    constexpr uint32_t telemetryChannelBit (const TelemetryChannel channel) {
+        return 1U << static_cast<uint8_t>(channel);
+    }
+
+    // A channel list a host stored under a short name, so it can ask for it again with just the name.
+    struct TelemetrySet {
+        char     name[TELEMETRY_SET_NAME_SIZE]{};
+        uint32_t mask = 0;
+    };
+
+    /**
+     * @brief Streams the subscribed channels at a fixed rate, so a host doesn't have to poll value by value.
+     * Each sample tick reads every subscribed channel into the history. When TELEMETRY_BATCH_SAMPLES are in, each
+     * channel goes out as one TELEMETRY frame (framed mode, frame-codec.hpp) or one line (text mode).
+     * Every frame or line gets the next sequence number, dropped ones included, so a host sees a gap as a gap.
+     * The first sample's tick goes with it: sample n of a batch was taken at (tick + n) / rate seconds.
+     * A late main loop skips ticks rather than bunching samples up, and the batch is cut there to keep that true.
+     */
+    class Telemetry final {
+
+    public:
+        Telemetry () = default;
+
+        Telemetry (const Telemetry& other) = delete;
+        Telemetry& operator=(const Telemetry& other) = delete;
+
+        void setControlLoop (CScontrol::ControlLoop* controlLoop) {controlLoop_ = controlLoop;}
+        // The MILLIVOLTS channels read 0 without one.
+        void setCalibration (const CScontrol::Calibration* calibration) {calibration_ = calibration;}
+
+        /**
+         * @brief Replaces the subscription. The history starts over; the sequence doesn't.
+         * @param mask telemetryChannelBit()s. 0 stops the stream.
+         * @return false if the rate is 0 or over TELEMETRY_MAX_RATE_HZ, or the mask has unknown channels.
+         */
+        bool subscribe (uint32_t mask, uint32_t rateHz);
+        void unsubscribe () {subscribe(0, rateHz_);}
+
+        /**
+         * @brief Takes the sample that is due, if any, and sends a batch when it is full. Call from the main loop.
+         */
+        void service ();
+
+        [[nodiscard]] uint32_t getMask () const {return mask_;}
+        [[nodiscard]] uint32_t getRateHz () const {return rateHz_;}
+        [[nodiscard]] uint16_t getSequence () const {return sequence_;}
+        [[nodiscard]] uint32_t getDroppedFrames () const {return droppedFrames_;}
+        [[nodiscard]] uint32_t getSkippedTicks () const {return skippedTicks_;}
+
+        static std::string channelToLabel (TelemetryChannel channel);
+
+        /**
+         * @brief Names to a mask. Channel labels, set names ("meas", "mv", "out", "sp", "temps", "loop", "all") and named
+         * sets can be mixed, comma separated. A number (decimal or 0x hex) is taken as the mask itself.
+         */
+        bool parseChannels (std::string_view text, uint32_t& mask) const;
+
+        /**
+         * @brief Reads every channel in mask, in channel order, in one pass. The control loop steps from the main
+         * loop too, so nothing moves while this runs: the supply values all come from the same step.
+         * @param values Needs room for every channel in mask.
+         * @return Values read.
+         */
+        uint8_t snapshot (uint32_t mask, int32_t* values) const;
+
+        /**
+         * @brief Stores or replaces a named set. The caller keeps it over a reset with EeProm0::saveTelemetrySet.
+         * @param slot Receives the set's slot, the record it goes in.
+         * @return false if the name is taken by a channel or built in set, is too long, or there is no room.
+         */
+        bool saveSet (std::string_view name, uint32_t mask, uint8_t& slot);
+
+        /// @brief Puts back the sets stored in the record log. Call once at startup. Returns the sets loaded.
+        uint8_t loadSets (CSdrivers::EeProm0& eeProm0);
+        [[nodiscard]] const std::array<TelemetrySet, TELEMETRY_NAMED_SET_COUNT>& getSets () const {return sets_;}
+
+    private:
+        int32_t readChannel (TelemetryChannel channel, const CScontrol::LoopStats& stats) const;
+        [[nodiscard]] CScontrol::LoopStats readStats (uint32_t mask) const;
+        [[nodiscard]] const TelemetrySet* findSet (std::string_view name) const;
+        static bool isValidSet (std::string_view name, uint32_t mask);
+        void takeSample ();
+        void sendBatch ();
+
+        CScontrol::ControlLoop* controlLoop_ = nullptr;
+        const CScontrol::Calibration* calibration_ = nullptr;
+
+        uint32_t mask_ = 0;
+        uint32_t rateHz_ = TELEMETRY_DEFAULT_RATE_HZ;
+        uint64_t periodUs_ = 1000000 / TELEMETRY_DEFAULT_RATE_HZ;
+        uint64_t nextSampleUs_ = 0;
+        uint32_t tick_ = 0;             // Sample ticks since the subscription started.
+
+        std::array<std::array<int32_t, TELEMETRY_BATCH_SAMPLES>, TELEMETRY_CHANNEL_COUNT> history_{};
+        uint8_t sampleCount_ = 0;
+        uint32_t firstTick_ = 0;        // Tick of history_[...][0].
+
+        std::array<TelemetrySet, TELEMETRY_NAMED_SET_COUNT> sets_{};
+
+        uint16_t sequence_ = 0;
+        uint32_t droppedFrames_ = 0;    // Frames, or text lines, that found no room in the TX ring.
+        uint32_t skippedTicks_ = 0;
+    };
+}
+
+#endif  // TELEMETRY_HPP_
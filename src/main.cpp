@@ -8,9 +8,13 @@
 
 // Local project includes
 
+#include "command-handler.hpp"
 #include "communication.hpp"
+#include "driversContainer.hpp"
 #include "packed-datetime.hpp"
+#include "log-queue.hpp"
 #include "logger.hpp"
+#include "post-mortem.hpp"
 #include "product-info.hpp"
 #include "worker.hpp"
 #include "utilities.hpp"
@@ -22,11 +26,24 @@ int main()
 {
 
 
+    PostMortem::init();     // Before anything logs. Keeps what the previous run left.
+
     // Ignore the return value. We are neither displaying it nor executing logic based on it.
     // This call will also initialize the UART0.
     if (!boardInit()) {
+        PostMortem::recordCause(PostMortemCause::INIT_FAILED);
         exit(1000); // bad day!
     }
+    // Log sinks. Lines logged before this are held in the queue and go out to these.
+    static UsbLogSink usbLogSink;
+    static RamLogSink ramLogSink;
+    static UartLogSink uartLogSink{SerialComm::getCommandUartHardware()};
+    logQueue_.attach(usbLogSink);
+    logQueue_.attach(ramLogSink);
+    if (SerialComm::isUartEnabled()) {
+        logQueue_.attach(uartLogSink);
+    }
+
     auto connectTime = SerialComm::getUsbConnectTime(); // If disabled, should be 0.
     auto uartActualBaudRate = SerialComm::getCommandUartBaudRate();
 
@@ -85,10 +102,30 @@ int main()
     Communication::serialOutputLine(s);
 #endif
 
+    for (const auto& line : PostMortem::formatReport()) {
+        Communication::serialOutputLine(line);
+    }
+
     // Setup the application code
     logger_.setLogLevel(LogLevel::Error);   // For prod set this to Fatal.
 
     CSworkers::Worker worker;
+    if (!worker.init()) {
+        logger_.log(LogLevel::Error, "main: worker initialization incomplete.");
+    }
+
+    CommandHandler commandHandler;
+    commandHandler.setControlLoop(&worker.getControlLoop());
+    commandHandler.setRamLogSink(&ramLogSink);
+
+    Telemetry telemetry;
+    telemetry.setControlLoop(&worker.getControlLoop());
+    telemetry.setCalibration(&worker.getCalibration());
+    telemetry.loadSets(CSdrivers::getEEProm0());
+    commandHandler.setTelemetry(&telemetry);
+
+    // Startup output waited for room in the TX queue. From here on the loop must not wait on the host.
+    SerialComm::setTxOverflowPolicy(TxOverflowPolicy::DROP);
 
     // TODO: Setup and handle watchdog
 
@@ -98,6 +135,9 @@ int main()
         constexpr uint16_t artificialLoopDelayMs = 0;
 
         Communication::handleInputBuffer();
+        commandHandler.doCommands();
+        telemetry.service();
+        SerialComm::serviceOutput();
 
         workOk = worker.doWork();
 
@@ -106,16 +146,15 @@ int main()
         /*
         if (const StatusCode localStatus = focus500.doWork(); StatusCode::READY != localStatus) {
 
-#if defined (LOG_GROUP_MAIN)
-            logger_.log(LogLevel::Info,
-                                     "main: localStatus: " + statusToLabel(localStatus) +
-                                     "\n" + "globalStatus: " +
-                                     statusToLabel(getGlobalStatusCode()) +
-                                     "\n" + "globalMessage: " +
-                                     getGlobalErrorMessage()
-                                     );
-
-#endif
+            if (logger_.isGroupEnabled(LogGroup::MAIN)) {
+                logger_.log(LogLevel::Info,
+                                         "main: localStatus: " + statusToLabel(localStatus) +
+                                         "\n" + "globalStatus: " +
+                                         statusToLabel(getGlobalStatusCode()) +
+                                         "\n" + "globalMessage: " +
+                                         getGlobalErrorMessage()
+                                         );
+            }
 
         }
         */
@@ -130,6 +169,8 @@ int main()
     ResponseHandler::showAllResponses();    // Display queued-up client messages.
     */
     logger_.log(LogLevel::Info, "Exiting Focus Rack 500. Goodbye!\n\n");
+    logQueue_.pump();
+    SerialComm::serviceOutput();
 
     return 0;
 
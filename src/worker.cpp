@@ -1,9 +1,74 @@
 
+#include "binary-log.hpp"
+#include "devicesContainer.hpp"
+#include "driversContainer.hpp"
+#include "log-queue.hpp"
+#include "post-mortem.hpp"
 #include "worker.hpp"
 
+using namespace CSdevices;
+using CSdrivers::PowerSupplyId;
+
 namespace CSworkers {
 
+    bool Worker::init() {
+        auto& eeProm0 = CSdrivers::getEEProm0();
+        auto retCode = eeProm0.init();
+
+        // Field diagnostics: the log groups someone switched on with the loggroups command.
+        if (uint64_t groupMask = 0; eeProm0.loadLogGroupMask(groupMask)) {
+            CScore::logger_.setGroupMask(groupMask);
+        }
+        CScore::logQueue_.attach(CSdrivers::getFaultLogSink());
+
+        // The RAM copy is gone after a power cycle. Keep the gist of why the last run ended.
+        if (CScore::PostMortem::hasReport()) {
+            const auto& previous = CScore::PostMortem::getPrevious();
+            eeProm0.savePostMortem(static_cast<uint8_t>(CScore::PostMortem::getPreviousCause()),
+                                   previous.hasFault ? previous.fault.pc : 0, previous.uptimeMs);
+        }
+
+        eeProm0.setFormatCompleteCallback(onFormatComplete, this);
+        controlLoop_.setCalibration(&calibration_);
+
+        // Grid supplies: voltage sense on the ADS1115s, drive on the MCP4728 channels.
+        retCode &= controlLoop_.addBlock({PowerSupplyId::G1, &getAdc0(), Ads1115Channel::AIN2_SINGLE_SHOT,
+                                          &getDac0(), DacChannelIds::CHANNEL_A});
+        retCode &= controlLoop_.addBlock({PowerSupplyId::G2, &getAdc1(), Ads1115Channel::AIN0_SINGLE_SHOT,
+                                          &getDac0(), DacChannelIds::CHANNEL_B});
+        retCode &= controlLoop_.addBlock({PowerSupplyId::G3, &getAdc1(), Ads1115Channel::AIN2_SINGLE_SHOT,
+                                          &getDac0(), DacChannelIds::CHANNEL_C});
+
+        // A format in progress is rewriting the control data pages. The blocks stay disabled until it is done and
+        // onFormatComplete loads what it wrote.
+        if (!eeProm0.isFormatting()) {
+            loadControlData();
+        }
+
+        retCode &= controlLoop_.start();
+
+        return retCode;
+    }
+
+    void Worker::loadControlData() {
+        auto& eeProm0 = CSdrivers::getEEProm0();
+
+        // All supplies are converted once here. Nothing on the sample path touches the float pages after this.
+        calibration_.load(eeProm0);
+
+        // Missing gains just leave a block disabled. That's not a reason to stop the firmware.
+        controlLoop_.loadGains(eeProm0);
+    }
+
+    void Worker::onFormatComplete(void *context) {
+        static_cast<Worker*>(context)->loadControlData();
+    }
+
     bool Worker::doWork() {
+        controlLoop_.service();
+        CSdrivers::getEEProm0().service();     // Queued page writes. Never blocks on the write cycle.
+        CScore::binaryLog_.drain(BINARY_LOG_RECORDS_PER_PASS);    // Last: log output is the lowest priority.
+        CScore::logQueue_.pump(LOG_QUEUE_BYTES_PER_PASS);
         return true;
     }
 }
@@ -1,17 +1,36 @@
+
 #pragma once
 #ifndef WORKER_HPP_
 #define WORKER_HPP_
-#include "csi2c.hpp"
+#include "calibration.hpp"
+#include "control-loop.hpp"
 
 namespace CSworkers {
 
+    constexpr uint32_t BINARY_LOG_RECORDS_PER_PASS = 4;    // Bounds the time one doWork pass spends on log output.
+    constexpr size_t LOG_QUEUE_BYTES_PER_PASS = 256;        // The same for Logger text.
+
     class Worker final {
     public:
         Worker () = default;
         ~Worker() = default;
 
+        // Brings up the EEPROM, loads calibration, binds the control blocks, and starts the control loop.
+        bool init();
+
         bool doWork();
 
+        [[nodiscard]] CScontrol::ControlLoop& getControlLoop () {return controlLoop_;}
+        [[nodiscard]] const CScontrol::Calibration& getCalibration () const {return calibration_;}
+
+    private:
+        // Calibration and control gains from EEPROM 0. At startup, or once a background format has rewritten them.
+        void loadControlData();
+        static void onFormatComplete(void* context);
+
+        CScontrol::Calibration calibration_;
+        CScontrol::ControlLoop controlLoop_;
+
     };
 };
 